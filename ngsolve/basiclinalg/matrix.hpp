@@ -136,6 +136,9 @@ namespace ngbla
       return *this;
     }
 
+    /// the data pointer
+    INLINE T * Data () const throw() { return data; }
+
     /// copy size and pointers
     INLINE FlatMatrix & Assign (const FlatMatrix & m) throw()
     {
@@ -312,6 +315,9 @@ namespace ngbla
       return *this;
     }
 
+    /// the data pointer
+    INLINE T * Data () const throw() { return data; }
+
     /// copy size and pointers
     INLINE FlatMatrix & Assign (const FlatMatrix & m) throw()
     {
@@ -653,6 +659,23 @@ namespace ngbla
     enum { IS_COMPLEX = mat_traits<TSCAL>::IS_COMPLEX };
   };
 
+  using ngstd::AtomicAdd;
+
+  /// atomic x += y, real and imaginary part are updated separately
+  INLINE void AtomicAdd (Complex & x, Complex y)
+  {
+    double * px = reinterpret_cast<double*> (&x);
+    AtomicAdd (px[0], y.real());
+    AtomicAdd (px[1], y.imag());
+  }
+
+  /// atomic x += y, entry by entry
+  template <int H, int W, typename T>
+  INLINE void AtomicAdd (Mat<H,W,T> & x, const Mat<H,W,T> & y)
+  {
+    for (int i = 0; i < H*W; i++)
+      AtomicAdd (x(i), y(i));
+  }
 
 
 
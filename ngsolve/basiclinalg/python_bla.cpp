@@ -255,6 +255,8 @@ void NGS_DLL_HEADER ExportNgbla() {
         .def(PyDefToString<FVD >())
         .def("Range",    static_cast</* const */ FVD (FVD::*)(int,int) const> (&FVD::Range ) )
         .def(bp::init<int, double *>())
+        .add_property("__array_interface__", FunctionPointer( [](FVD &self)
+                      { return PyArrayInterface (self.Data(), bp::make_tuple (self.Size())); }))
         .def(bp::self+=bp::self)
         .def(bp::self-=bp::self)
         .def(bp::self*=double())
@@ -325,6 +327,8 @@ void NGS_DLL_HEADER ExportNgbla() {
         .def("__mul__" , FunctionPointer( [](FMD &self, FVD &v) { return Vector<double>(self*v); }) )
         .def("__mul__" , FunctionPointer( [](FMD &self, double s) { return Matrix<double>(s*self); }) )
         .def("__rmul__" , FunctionPointer( [](FMD &self, double s) { return Matrix<double>(s*self); }) )
+        .add_property("__array_interface__", FunctionPointer( [](FMD &self)
+                      { return PyArrayInterface (self.Data(), bp::make_tuple (self.Height(), self.Width())); }))
         .def("Height", &FMD::Height )
         .def("Width", &FMD::Width )
         .add_property("h", &FMD::Height )
@@ -345,6 +349,8 @@ void NGS_DLL_HEADER ExportNgbla() {
         .def(PyDefToString<FVC >())
         .def("Range",    static_cast</* const */ FVC (FVC::*)(int,int) const> (&FVC::Range ) )
         .def(bp::init<int, Complex *>())
+        .add_property("__array_interface__", FunctionPointer( [](FVC &self)
+                      { return PyArrayInterface (self.Data(), bp::make_tuple (self.Size())); }))
         .def(bp::self+=bp::self)
         .def(bp::self-=bp::self)
         .def(bp::self*=Complex())
@@ -421,6 +427,8 @@ void NGS_DLL_HEADER ExportNgbla() {
         .def("__rmul__" , FunctionPointer( [](FMC &self, Complex s) { return Matrix<Complex>(s*self); }) )
         .def("__mul__" , FunctionPointer( [](FMC &self, double s) { return Matrix<Complex>(s*self); }) )
         .def("__rmul__" , FunctionPointer( [](FMC &self, double s) { return Matrix<Complex>(s*self); }) )
+        .add_property("__array_interface__", FunctionPointer( [](FMC &self)
+                      { return PyArrayInterface (self.Data(), bp::make_tuple (self.Height(), self.Width())); }))
         .def("Height", &FMC::Height )
         .def("Width", &FMC::Width )
         .def("__len__", FunctionPointer( []( FMC& self) { return self.Height();} ) )
@@ -458,6 +466,39 @@ void NGS_DLL_HEADER ExportNgbla() {
             boost::python::arg("complex")=false)
            );
 
+    // views of numpy arrays, the array is kept alive as long as the view
+    bp::def("FlatVector",
+            FunctionPointer( [] (bp::object array) {
+                Array<int> dims;
+                if (PyArrayIsComplex (array))
+                  {
+                    Complex * data = PyArrayData<Complex> (array, dims);
+                    if (dims.Size() != 1) throw Exception ("FlatVector needs a 1D array");
+                    return bp::object(FlatVector<Complex>(dims[0], data));
+                  }
+                double * data = PyArrayData<double> (array, dims);
+                if (dims.Size() != 1) throw Exception ("FlatVector needs a 1D array");
+                return bp::object(FlatVector<double>(dims[0], data));
+                }),
+            bp::with_custodian_and_ward_postcall<0,1>()
+           );
+
+    bp::def("FlatMatrix",
+            FunctionPointer( [] (bp::object array) {
+                Array<int> dims;
+                if (PyArrayIsComplex (array))
+                  {
+                    Complex * data = PyArrayData<Complex> (array, dims);
+                    if (dims.Size() != 2) throw Exception ("FlatMatrix needs a 2D array");
+                    return bp::object(FlatMatrix<Complex>(dims[0], dims[1], data));
+                  }
+                double * data = PyArrayData<double> (array, dims);
+                if (dims.Size() != 2) throw Exception ("FlatMatrix needs a 2D array");
+                return bp::object(FlatMatrix<double>(dims[0], dims[1], data));
+                }),
+            bp::with_custodian_and_ward_postcall<0,1>()
+           );
+
     bp::def ("InnerProduct",
              FunctionPointer( [] (bp::object x, bp::object y) -> bp::object
                               { return x.attr("InnerProduct") (y); }));
@@ -19,9 +19,16 @@ namespace ngcomp
 
 
     Array<double> weight;
+    /// weights accumulated by every thread, summed up in Finalize
+    Array<Array<double>> thread_weight;
     
     bool block;
     bool hypre;
+    /// wirebasket solver: "direct", "cg" or "amg"
+    string coarsetype;
+    double coarsetol;
+    int coarsemaxsteps;
+    shared_ptr<BaseMatrix> coarse_pre;
 
     shared_ptr<BaseMatrix> inv;
     shared_ptr<BaseMatrix> inv_coarse;
@@ -34,6 +41,13 @@ namespace ngcomp
   public:
 
     void SetHypre (bool ah = true) { hypre = ah; }
+
+    void SetCoarseType (const string & type, double tol, int maxsteps)
+    {
+      coarsetype = type;
+      coarsetol = tol;
+      coarsemaxsteps = maxsteps;
+    }
     
     BDDCMatrix (const BilinearForm & abfa, 
 		const string & ainversetype, bool ablock, bool ahypre)
@@ -42,6 +56,9 @@ namespace ngcomp
       static Timer timer ("BDDC Constructor");
 
       hypre = ahypre;
+      coarsetype = "direct";
+      coarsetol = 1e-8;
+      coarsemaxsteps = 200;
 
       pwbmat = NULL;
       inv = NULL;
@@ -54,39 +71,46 @@ namespace ngcomp
       auto fes = bfa.GetFESpace();
       shared_ptr<MeshAccess> ma = fes->GetMeshAccess();
 
-      Array<int> wbdcnt(ma->GetNE()+ma->GetNSE());
-      Array<int> ifcnt(ma->GetNE()+ma->GetNSE());
+      int nel = ma->GetNE(), nsel = ma->GetNSE();
+      Array<int> wbdcnt(nel+nsel);
+      Array<int> ifcnt(nel+nsel);
       wbdcnt = 0;
       ifcnt = 0;
       const BitArray & freedofs = *fes->GetFreeDofs();
       
-      Array<int> dnums;
-      for (int bound = 0, ii = 0; bound <= 1; bound++)
-	for (int i = 0; i < (bound ? ma->GetNSE() : ma->GetNE()); i++, ii++)
-	  {
-            ElementId ei (bound ? BND : VOL, i);
-	    fes->GetDofNrs (ei, dnums);
-	    for (int j = 0; j < dnums.Size(); j++)
-	      {
-		if (dnums[j] == -1) continue;
-		if (!freedofs.Test(dnums[j])) continue;
-		COUPLING_TYPE ct = fes->GetDofCouplingType(dnums[j]);
-		if (ct == LOCAL_DOF && bfa.UsesEliminateInternal()) continue;
+#pragma omp parallel
+      {
+        Array<int> dnums;
+#pragma omp for
+        for (int ii = 0; ii < nel+nsel; ii++)
+          {
+            ElementId ei = (ii < nel) ? ElementId(VOL, ii) : ElementId(BND, ii-nel);
+            fes->GetDofNrs (ei, dnums);
+            for (int j = 0; j < dnums.Size(); j++)
+              {
+                if (dnums[j] == -1) continue;
+                if (!freedofs.Test(dnums[j])) continue;
+                COUPLING_TYPE ct = fes->GetDofCouplingType(dnums[j]);
+                if (ct == LOCAL_DOF && bfa.UsesEliminateInternal()) continue;
 		
-		if (ct == WIREBASKET_DOF)
-		  wbdcnt[ii]++;
-		else
-		  ifcnt[ii]++;
-	      }
-	  }
+                if (ct == WIREBASKET_DOF)
+                  wbdcnt[ii]++;
+                else
+                  ifcnt[ii]++;
+              }
+          }
+      }
       
       Table<int> el2wbdofs(wbdcnt);   // wirebasket dofs on each element
       Table<int> el2ifdofs(ifcnt);    // interface dofs on each element
       
-      for (int bound = 0, ii = 0; bound <= 1; bound++)
-	for (int i = 0; i < (bound ? ma->GetNSE() : ma->GetNE()); i++, ii++)
+#pragma omp parallel
+      {
+        Array<int> dnums;
+#pragma omp for
+        for (int ii = 0; ii < nel+nsel; ii++)
 	  {
-            ElementId ei (bound ? BND : VOL, i);
+            ElementId ei = (ii < nel) ? ElementId(VOL, ii) : ElementId(BND, ii-nel);
 	    fes->GetDofNrs (ei, dnums);
 	    
 	    int lifcnt = 0;
@@ -105,6 +129,7 @@ namespace ngcomp
 		  el2ifdofs[ii][lifcnt++] = dnums[j];
 	      } 
 	  }
+      }
       
       int ndof = fes->GetNDof();      
       
@@ -135,6 +160,7 @@ namespace ngcomp
       
       weight.SetSize (fes->GetNDof());
       weight = 0;
+      thread_weight.SetSize (omp_get_max_threads());
     }
 
     
@@ -242,22 +268,42 @@ namespace ngcomp
                << "schur = " << endl << a << endl;
       */
 
-      // critical can be removed when everything is colored
-      // #pragma omp critical(bddcaddelmat)
-      {
+      // weights go to the thread's own array
+      int tid = omp_get_thread_num();
+      if (tid < thread_weight.Size())
+        {
+          Array<double> & tw = thread_weight[tid];
+          if (tw.Size() != weight.Size())
+            {
+              tw.SetSize (weight.Size());
+              tw = 0.0;
+            }
+          for (int j = 0; j < intdofs.Size(); j++)
+            tw[intdofs[j]] += el2ifweight[j];
+        }
+      else
         for (int j = 0; j < intdofs.Size(); j++)
-          weight[intdofs[j]] += el2ifweight[j];
-        
-        sparse_harmonicext->AddElementMatrix(intdofs,wbdofs,he);
-        
-        if (!bfa.IsSymmetric())
-          sparse_harmonicexttrans->AddElementMatrix(wbdofs,intdofs,het);
-        
-        sparse_innersolve -> AddElementMatrix(intdofs,intdofs,d);
-	
-        dynamic_cast<SparseMatrix<SCAL,TV,TV>*>(pwbmat)
-          ->AddElementMatrix(wbdofs,wbdofs,a);
-      }
+          AtomicAdd (weight[intdofs[j]], el2ifweight[j]);
+
+      // concurrent callers need not be colored, entries are added atomically
+      if (omp_in_parallel())
+        {
+          sparse_harmonicext->AddElementMatrixAtomic(intdofs,wbdofs,he);
+          if (!bfa.IsSymmetric())
+            sparse_harmonicexttrans->AddElementMatrixAtomic(wbdofs,intdofs,het);
+          sparse_innersolve -> AddElementMatrixAtomic(intdofs,intdofs,d);
+          dynamic_cast<SparseMatrix<SCAL,TV,TV>*>(pwbmat)
+            ->AddElementMatrixAtomic(wbdofs,wbdofs,a);
+        }
+      else
+        {
+          sparse_harmonicext->AddElementMatrix(intdofs,wbdofs,he);
+          if (!bfa.IsSymmetric())
+            sparse_harmonicexttrans->AddElementMatrix(wbdofs,intdofs,het);
+          sparse_innersolve -> AddElementMatrix(intdofs,intdofs,d);
+          dynamic_cast<SparseMatrix<SCAL,TV,TV>*>(pwbmat)
+            ->AddElementMatrix(wbdofs,wbdofs,a);
+        }
     }
 
 
@@ -270,11 +316,20 @@ namespace ngcomp
       auto fes = bfa.GetFESpace();
       int ndof = fes->GetNDof();      
 
+#pragma omp parallel for
+      for (int i = 0; i < ndof; i++)
+        for (int k = 0; k < thread_weight.Size(); k++)
+          if (thread_weight[k].Size())
+            weight[i] += thread_weight[k][i];
+      thread_weight.SetSize(0);
 
 #ifdef PARALLEL
-      AllReduceDofData (weight, MPI_SUM, fes->GetParallelDofs());
+      // the weights of dofs shared by several ranks are the sums over all subdomains
+      if (fes->IsParallel())
+        AllReduceDofData (weight, MPI_SUM, fes->GetParallelDofs());
 #endif
 
+#pragma omp parallel for
       for (int i = 0; i < sparse_innersolve->Height(); i++)
 	{
 	  FlatArray<int> cols = sparse_innersolve -> GetRowIndices(i);
@@ -283,13 +338,14 @@ namespace ngcomp
 	      sparse_innersolve->GetRowValues(i)(j) /= (weight[i] * weight[cols[j]]);
 	}
       
-      
+#pragma omp parallel for
       for (int i = 0; i < sparse_harmonicext->Height(); i++)
 	if (weight[i])
 	  sparse_harmonicext->GetRowValues(i) /= weight[i];
       
       if (!bfa.IsSymmetric())
         {
+#pragma omp parallel for
           for (int i = 0; i < sparse_harmonicexttrans->Height(); i++)
             {
               FlatArray<int> rowind = sparse_harmonicexttrans->GetRowIndices(i);
@@ -324,6 +380,12 @@ namespace ngcomp
 	if (free_dofs->Test(i)) cntfreedofs++;
 
 
+      if (block && fes->IsParallel())
+        {
+          cout << IM(3) << "BDDC: block smoother not available in parallel, using wirebasket solver" << endl;
+          block = false;
+        }
+
       if (block)
 	{
 	  //Smoothing Blocks
@@ -358,34 +420,100 @@ namespace ngcomp
       else
 	{
 #ifdef PARALLEL
-	  if (bfa.GetFESpace()->IsParallel())
+	  if (fes->IsParallel())
 	    {
-	      ParallelDofs * pardofs = &bfa.GetFESpace()->GetParallelDofs();
+	      ParallelDofs * pardofs = &fes->GetParallelDofs();
 
-	      pwbmat = new ParallelMatrix (shared_ptr<BaseMatrix> (pwbmat, NOOP_Deleter), pardofs);
+	      // every rank holds its subdomain contributions, the parallel matrices
+	      // add them up over the shared dofs. They own the local matrices.
+	      BaseSparseMatrix * spwbmat = dynamic_cast<BaseSparseMatrix*> (pwbmat);
+	      spwbmat -> SetParallelDofs (pardofs);
+	      pwbmat = new ParallelMatrix (shared_ptr<BaseMatrix> (pwbmat), pardofs);
 	      pwbmat -> SetInverseType (inversetype);
+	      innersolve = new ParallelMatrix (shared_ptr<BaseMatrix> (innersolve), pardofs);
+	      harmonicext = new ParallelMatrix (shared_ptr<BaseMatrix> (harmonicext), pardofs);
+	      if (harmonicexttrans)
+		harmonicexttrans = new ParallelMatrix (shared_ptr<BaseMatrix> (harmonicexttrans), pardofs);
 
+	      int nglob = 0;
+	      for (int i = 0; i < ndof; i++)
+		if (free_dofs->Test(i) && pardofs->IsMasterDof(i)) nglob++;
+	      nglob = MyMPI_AllReduce (nglob);
+	      
+	      if ((coarsetype == "cg" || coarsetype == "amg") && bfa.IsSymmetric() && !hypre)
+		{
+		  // no parallel amg, CG with Jacobi on the distributed wirebasket matrix
+		  if (coarsetype == "amg")
+		    cout << IM(3) << "BDDC: no parallel amg, using jacobi preconditioned cg" << endl;
+		  cout << IM(3) << "wirebasket parallel cg-solver ( with " << nglob 
+		       << " free dofs )" << endl;
+
+		  coarse_pre = spwbmat -> CreateJacobiPrecond (free_dofs);
+		  auto cg = make_shared<CGSolver<TV>> (*pwbmat, *coarse_pre);
+		  cg -> SetPrecision (coarsetol);
+		  cg -> SetMaxSteps (coarsemaxsteps);
+		  cg -> SetPrintRates (0);
+		  inv = cg;
+		}
 #ifdef HYPRE
-	      if (hypre)
-		inv = new HyprePreconditioner (*pwbmat, free_dofs);
-	      else
+	      else if (hypre)
+		inv = make_shared<HyprePreconditioner> (*pwbmat, free_dofs);
 #endif
-		inv = pwbmat -> InverseMatrix (free_dofs);
+	      else
+		{
+		  // "distributed" (opt-in, spd forms): CG with block Cholesky on sqrt(P) ranks,
+		  // throws if it does not converge. Otherwise the inverse type decides (master inverse, mumps)
+		  if (coarsetype == "distributed")
+		    {
+		      if (bfa.IsSymmetric() && !hypre && is_same<SCAL,TV>::value)
+			pwbmat -> SetInverseType (DISTRIBUTEDINVERSE);
+		      else
+			cout << IM(3) << "BDDC: distributed coarse solver needs a symmetric form of matching scalar type, using " 
+			     << inversetype << endl;
+		    }
+		  cout << IM(3) << "call parallel wirebasket inverse, type " 
+		       << GetInverseName (pwbmat->GetInverseType()) 
+		       << " ( with " << nglob << " free dofs )" << endl;
+		  inv = pwbmat -> InverseMatrix (free_dofs);
+		}
 
 	      tmp = new ParallelVVector<TV>(ndof, pardofs);
-	      innersolve = new ParallelMatrix (shared_ptr<BaseMatrix> (innersolve, NOOP_Deleter), pardofs);
-	      harmonicext = new ParallelMatrix (shared_ptr<BaseMatrix> (harmonicext, NOOP_Deleter), pardofs);
-	      if (harmonicexttrans)
-		harmonicexttrans = new ParallelMatrix (shared_ptr<BaseMatrix> (harmonicexttrans, NOOP_Deleter), pardofs);
 	    }
 	  else
 #endif
 	    {
-	      cout << "call wirebasket inverse ( with " << cntfreedofs 
-		   << " free dofs out of " << pwbmat->Height() << " )" << endl;
-
-	      inv = pwbmat->InverseMatrix(free_dofs);
-	      cout << "has inverse" << endl;
+	      if ((coarsetype == "cg" || coarsetype == "amg") && bfa.IsSymmetric())
+		{
+		  // inexact wirebasket solve, CG on the free dofs, 
+		  // preconditioned by Jacobi or smoothed aggregation AMG
+		  cout << IM(3) << "wirebasket " << coarsetype << "-solver ( with " << cntfreedofs 
+		       << " free dofs out of " << pwbmat->Height() << " )" << endl;
+		  if (coarsetype == "amg" && is_same<TV,double>::value)
+		    {
+		      auto amg = make_shared<SmoothedAggregationAMG> 
+			(dynamic_cast<const BaseSparseMatrix&> (*pwbmat), free_dofs);
+		      amg -> Setup();
+		      coarse_pre = amg;
+		    }
+		  else
+		    coarse_pre = dynamic_cast<BaseSparseMatrix*> (pwbmat)->CreateJacobiPrecond(free_dofs);
+		  auto cg = make_shared<CGSolver<TV>> (*pwbmat, *coarse_pre);
+		  cg -> SetPrecision (coarsetol);
+		  cg -> SetMaxSteps (coarsemaxsteps);
+		  cg -> SetPrintRates (0);
+		  inv = cg;
+		}
+	      else
+		{
+		  if (coarsetype != "direct" && coarsetype != "distributed")
+		    cout << IM(3) << "BDDC: coarsetype '" << coarsetype 
+			 << "' not available, using direct solver" << endl;
+		  cout << "call wirebasket inverse ( with " << cntfreedofs 
+		       << " free dofs out of " << pwbmat->Height() << " )" << endl;
+
+		  inv = pwbmat->InverseMatrix(free_dofs);
+		  cout << "has inverse" << endl;
+		}
 	      tmp = new VVector<TV>(ndof);
 	    }
 	}
@@ -490,6 +618,7 @@ namespace ngcomp
     const S_BilinearForm<SCAL> * bfa;
     BDDCMatrix<SCAL,TV> * pre;
     string inversetype;
+    string coarsetype;
     bool block, hypre;
   public:
     BDDCPreconditioner (const PDE & pde, const Flags & aflags, const string & aname)
@@ -501,6 +630,7 @@ namespace ngcomp
       if (flags.GetDefineFlag("refelement")) Exception ("refelement - BDDC not supported");
       block = flags.GetDefineFlag("block");
       hypre = flags.GetDefineFlag("usehypre");
+      coarsetype = flags.GetStringFlag("coarsetype", "direct");
       pre = NULL;
     }
     
@@ -514,6 +644,7 @@ namespace ngcomp
       if (flags.GetDefineFlag("refelement")) Exception ("refelement - BDDC not supported");
       block = flags.GetDefineFlag("block");
       hypre = flags.GetDefineFlag("usehypre");
+      coarsetype = flags.GetStringFlag("coarsetype", "direct");
       pre = NULL;
     }
 
@@ -528,6 +659,8 @@ namespace ngcomp
       delete pre;
       pre = new BDDCMatrix<SCAL,TV>(*bfa, inversetype, block, hypre);
       pre -> SetHypre (hypre);
+      pre -> SetCoarseType (coarsetype, flags.GetNumFlag ("coarsetol", 1e-8),
+                            int (flags.GetNumFlag ("coarsemaxsteps", 200)));
     }
 
     virtual void FinalizeLevel () 
@@ -63,6 +63,7 @@ namespace ngcomp
 
     SetGalerkin( flags.GetDefineFlag( "project" ) );
     SetNonAssemble (flags.GetDefineFlag ("nonassemble"));
+    SetMatrixFree (flags.GetDefineFlag ("matrixfree"));
     SetDiagonal (flags.GetDefineFlag ("diagonal"));
     if (flags.GetDefineFlag ("nonsym"))  SetSymmetric (0);
     if (flags.GetDefineFlag ("nonmultilevel")) SetMultiLevel (0);
@@ -80,6 +81,11 @@ namespace ngcomp
     SetStoreInner (flags.GetDefineFlag ("store_inner"));
     precompute = flags.GetDefineFlag ("precompute");
     checksum = flags.GetDefineFlag ("checksum");
+    elmat_cache = flags.GetDefineFlag ("elmatcache");
+    elmat_cache_size = int (flags.GetNumFlag ("elmatcache_size", 10000));
+    SetAssemblyMode (flags.GetStringFlag ("assembly", "colored"));
+    use_assembly_plan = flags.GetDefineFlag ("assemblyplan");
+    incremental = flags.GetDefineFlag ("incremental");
     spd = flags.GetDefineFlag ("spd");
     if (spd) symmetric = true;
   }
@@ -112,6 +118,7 @@ namespace ngcomp
 
     SetGalerkin( flags.GetDefineFlag( "project" ) );
     SetNonAssemble (flags.GetDefineFlag ("nonassemble"));
+    SetMatrixFree (flags.GetDefineFlag ("matrixfree"));
     SetDiagonal (flags.GetDefineFlag ("diagonal"));
     if (flags.GetDefineFlag ("nonsym"))  SetSymmetric (0);
     if (flags.GetDefineFlag ("nonmultilevel")) SetMultiLevel (0);
@@ -130,6 +137,11 @@ namespace ngcomp
 
     precompute = flags.GetDefineFlag ("precompute");
     checksum = flags.GetDefineFlag ("checksum");
+    elmat_cache = flags.GetDefineFlag ("elmatcache");
+    elmat_cache_size = int (flags.GetNumFlag ("elmatcache_size", 10000));
+    SetAssemblyMode (flags.GetStringFlag ("assembly", "colored"));
+    use_assembly_plan = flags.GetDefineFlag ("assemblyplan");
+    incremental = flags.GetDefineFlag ("incremental");
   }
 
 
@@ -137,6 +149,8 @@ namespace ngcomp
   void BilinearForm :: AddIntegrator (shared_ptr<BilinearFormIntegrator> bfi)
   {
     parts.Append (bfi);
+    assembly_plan_valid = false;
+    incremental_valid = false;
     if (low_order_bilinear_form)
       low_order_bilinear_form -> AddIntegrator (parts.Last());
   }
@@ -185,6 +199,19 @@ namespace ngcomp
       low_order_bilinear_form -> SetElmatEigenValues (ee);
   }
 
+  void BilinearForm :: SetAssemblyMode (const string & am)
+  {
+    if (am == "colored")
+      assembly_mode = ASSEMBLE_COLORED;
+    else if (am == "atomic")
+      assembly_mode = ASSEMBLE_ATOMIC;
+    else if (am == "buffered")
+      assembly_mode = ASSEMBLE_BUFFERED;
+    else
+      throw Exception ("BilinearForm::SetAssemblyMode: unknown mode '" + am + 
+                       "', use colored, atomic or buffered");
+  }
+
 
 
   MatrixGraph * BilinearForm :: GetGraph (int level, bool symmetric)
@@ -363,7 +390,17 @@ namespace ngcomp
 
     if (nonassemble)
       {
-        mats.Append (make_shared<BilinearFormApplication> (shared_ptr<BilinearForm>(this, NOOP_Deleter))); 
+        if (matrixfree)
+          {
+            if (fespace->IsComplex())
+              mats.Append (make_shared<MatrixFreeBilinearFormApplication<Complex>> 
+                           (shared_ptr<BilinearForm>(this, NOOP_Deleter))); 
+            else
+              mats.Append (make_shared<MatrixFreeBilinearFormApplication<double>> 
+                           (shared_ptr<BilinearForm>(this, NOOP_Deleter))); 
+          }
+        else
+          mats.Append (make_shared<BilinearFormApplication> (shared_ptr<BilinearForm>(this, NOOP_Deleter))); 
       
         if (precompute)
           {
@@ -489,10 +526,34 @@ namespace ngcomp
         throw;
       }
 
+    incremental_valid = false;
 
     DoAssemble(lh);
 
 
+    if (timing && !linearform && !preconditioners.Size())
+      {
+        // compare the parallel assembling strategies
+        ASSEMBLY_MODE usermode = assembly_mode;
+        const char * modenames[] = { "colored", "atomic", "buffered" };
+        for (int mode = ASSEMBLE_COLORED; mode <= ASSEMBLE_BUFFERED; mode++)
+          {
+            assembly_mode = ASSEMBLY_MODE(mode);
+            double starttime = WallTime();
+            int steps = 0;
+            do
+              {
+                DoAssemble(lh);
+                steps++;
+              }
+            while (WallTime()-starttime < 1.0);
+            cout << " assembling, " << modenames[mode] << ": " 
+                 << (WallTime()-starttime) / steps << " seconds" << endl;
+          }
+        assembly_mode = usermode;
+        DoAssemble(lh);
+      }
+
     if (timing)
       {
         double time;
@@ -548,14 +609,170 @@ namespace ngcomp
         return;
       }
 
-    GetMatrix() = 0.0;
-    DoAssemble(lh);
+    if (incremental && incremental_valid)
+      DoAssembleIncremental(lh);
+    else
+      {
+        GetMatrix() = 0.0;
+        DoAssemble(lh);
+      }
 
     if (galerkin)
       GalerkinProjection();
   }
 
 
+  void BilinearForm :: SetDirtyElement (ElementId ei)
+  {
+    VorB vb = VorB(ei);
+    BitArray & dirty = dirty_elements[vb];
+    int ne = ma->GetNE(vb);
+    if (dirty.Size() != ne)
+      {
+        dirty.SetSize (ne);
+        dirty.Clear();
+      }
+    dirty.Set (ei.Nr());
+
+    if (low_order_bilinear_form)
+      low_order_bilinear_form -> SetDirtyElement (ei);
+  }
+
+  void BilinearForm :: SetDirtyDomain (VorB vb, int index)
+  {
+    BitArray & dirty = dirty_domains[vb];
+    int ndom = (vb == VOL) ? ma->GetNDomains() : ma->GetNBoundaries();
+    if (dirty.Size() != ndom)
+      {
+        dirty.SetSize (ndom);
+        dirty.Clear();
+      }
+    dirty.Set (index);
+
+    if (low_order_bilinear_form)
+      low_order_bilinear_form -> SetDirtyDomain (vb, index);
+  }
+
+  void BilinearForm :: GetChangedDomains (VorB vb, BitArray & changed) const
+  {
+    int ndom = (vb == VOL) ? ma->GetNDomains() : ma->GetNBoundaries();
+    changed.SetSize (ndom);
+    changed.Clear();
+
+    for (int i = 0; i < ndom; i++)
+      {
+        if (i < dirty_domains[vb].Size() && dirty_domains[vb].Test(i))
+          changed.Set (i);
+
+        for (auto & bfi : parts)
+          {
+            bool used = (vb == VOL) ? bfi->VolumeForm() : 
+              (bfi->BoundaryForm() && !bfi->SkeletonForm());
+            if (used && bfi->DefinedOn (i) && bfi->ChangedSince (i, assembled_stamp))
+              changed.Set (i);
+          }
+      }
+  }
+
+
+
+  // the sequential sparse matrix of the bilinear-form, or NULL
+  static const BaseSparseMatrix * AssemblySparseMatrix (const BaseMatrix & mat)
+  {
+    const BaseMatrix * hmat = &mat;
+#ifdef PARALLEL
+    if (auto parmat = dynamic_cast<const ParallelMatrix*> (hmat))
+      hmat = &parmat->GetMatrix();
+#endif
+    return dynamic_cast<const BaseSparseMatrix*> (hmat);
+  }
+
+  void BilinearForm :: UpdateAssemblyPlan ()
+  {
+    if (!use_assembly_plan) return;
+
+    // a re-allocated matrix of the same space has the same graph, 
+    // so the plan stays valid
+    auto smat = AssemblySparseMatrix (GetMatrix());
+    size_t key[5] = { size_t(ma->GetNLevels()), size_t(fespace->GetNDof()),
+                      size_t(ma->GetNE(VOL)), size_t(ma->GetNE(BND)),
+                      smat ? smat->NZE() : 0 };
+
+    bool same = assembly_plan_valid;
+    for (int i = 0; i < 5; i++)
+      if (key[i] != assembly_plan_key[i]) same = false;
+    if (same) return;
+
+    BuildAssemblyPlan();
+    for (int i = 0; i < 5; i++)
+      assembly_plan_key[i] = key[i];
+  }
+
+  void BilinearForm :: BuildAssemblyPlan ()
+  {
+    static Timer timer ("BilinearForm::BuildAssemblyPlan");
+    RegionTimer reg (timer);
+
+    assembly_plan_valid = false;
+
+    auto smat = AssemblySparseMatrix (GetMatrix());
+    if (!smat || smat->NZE() >= size_t(numeric_limits<int>::max())) return;
+
+    // entries not in the graph (upper triangle of symmetric matrices, 
+    // condensed internal dofs) are marked by -1
+    for (VorB vb : { VOL, BND })
+      {
+        int ne = ma->GetNE(vb);
+        Array<int> cnt(ne);
+
+#pragma omp parallel
+        {
+          Array<int> dnums;
+#pragma omp for
+          for (int i = 0; i < ne; i++)
+            {
+              ElementId ei(vb, i);
+              cnt[i] = 0;
+              if (!fespace->DefinedOn (ei)) continue;
+              fespace->GetDofNrs (ei, dnums);
+              cnt[i] = sqr (dnums.Size());
+            }
+        }
+
+        Table<int> plan(cnt);
+
+#pragma omp parallel
+        {
+          Array<int> dnums;
+#pragma omp for
+          for (int i = 0; i < ne; i++)
+            {
+              if (cnt[i] == 0) continue;
+              fespace->GetDofNrs (ElementId(vb, i), dnums);
+
+              FlatArray<int> pos = plan[i];
+              for (int j = 0, k = 0; j < dnums.Size(); j++)
+                for (int l = 0; l < dnums.Size(); l++, k++)
+                  {
+                    pos[k] = -1;
+                    if (dnums[j] == -1 || dnums[l] == -1) continue;
+                    size_t p = smat->GetPositionTest (dnums[j], dnums[l]);
+                    if (p != numeric_limits<size_t>::max()) 
+                      pos[k] = p;
+                  }
+            }
+        }
+
+        assembly_plan[vb] = move(plan);
+      }
+
+    assembly_plan_valid = true;
+    cout << IM(3) << "assembly plan: " 
+         << assembly_plan[VOL].NElements() + assembly_plan[BND].NElements() 
+         << " positions" << endl;
+  }
+
+
 
   void BilinearForm :: PrintReport (ostream & ost) const
   {
@@ -563,6 +780,9 @@ namespace ngcomp
         << "symmetric   = " << symmetric << endl
         << "multilevel  = " << multilevel << endl
         << "nonassemble = " << nonassemble << endl
+        << "matrixfree  = " << matrixfree << endl
+        << "assembly    = " << assembly_mode << endl
+        << "incremental = " << incremental << endl
         << "printelmat = " << printelmat << endl
         << "elmatev    = " << elmat_ev << endl
         << "eliminate_internal = " << eliminate_internal << endl
@@ -585,11 +805,246 @@ namespace ngcomp
     for (int i = 0; i < mats.Size(); i++)
       if (mats[i]) mats[i]->MemoryUsage (mu);
 
+    if (assembly_plan_valid)
+      mu.Append (new MemoryUsageStruct ("AssemblyPlan", 
+                                        (assembly_plan[VOL].NElements() + 
+                                         assembly_plan[BND].NElements()) * sizeof(int), 2));
+
     for (int i = olds; i < mu.Size(); i++)
       mu[i]->AddName (string(" bf ")+GetName());
   }
 
 
+  /*
+    Element matrices of elements which coincide up to translation.
+    Key is element type, element index (integrators and piecewise 
+    constant coefficients), finite element (type, ndof, order), 
+    vertex orientation, the number of dofs per vertex, edge, face and
+    cell (the orders of variable order spaces) and the vertex 
+    coordinates relative to the first vertex. This determines the element if the geometry is the 
+    vertex (P1/Q1) map, which is checked for curved elements.
+    Lookup and insertion are lock-free, entries are never removed.
+   */
+  template <class SCAL>
+  class ElementMatrixCache
+  {
+  public:
+    class Entry
+    {
+    public:
+      size_t hash;
+      ELEMENT_TYPE et;
+      int index, ndof, order;
+      const type_info * feltype;
+      size_t orientation;
+      ArrayMem<int,30> nodedofs;
+      Vector<> geom;
+      Matrix<SCAL> mat;
+    };
+
+  private:
+    /// open addressing with linear probing, at most half full
+    atomic<Entry*> * slots;
+    size_t mask;
+    int maxsize;
+    atomic<int> reserved, stored;
+    
+  public:
+    atomic<int> hits, misses;
+
+    ElementMatrixCache (int amaxsize)
+      : maxsize(amaxsize), reserved(0), stored(0), hits(0), misses(0)
+    {
+      size_t nslots = 1024;
+      while (nslots < 2*size_t(max2(maxsize, 0))) nslots *= 2;
+      slots = new atomic<Entry*>[nslots];
+      for (size_t i = 0; i < nslots; i++) slots[i] = NULL;
+      mask = nslots-1;
+    }
+
+    ~ElementMatrixCache ()
+    {
+      for (size_t i = 0; i <= mask; i++) delete slots[i].load();
+      delete [] slots;
+    }
+
+    int Size() const { return stored; }
+
+    /// values of the vertex (P1/Q1) shape functions, false for other elements
+    static bool CalcVertexShape (ELEMENT_TYPE et, const IntegrationPoint & ip, 
+                                 SliceVector<> shape)
+    {
+      static FE_Segm1 segm;
+      static ScalarFE<ET_TRIG,1> trig;
+      static ScalarFE<ET_QUAD,1> quad;
+      static ScalarFE<ET_TET,1> tet;
+      static FE_Prism1 prism;
+      static FE_Hex1 hex;
+      switch (et)
+        {
+        case ET_SEGM:  segm.CalcShape (ip, shape); return true;
+        case ET_TRIG:  trig.CalcShape (ip, shape); return true;
+        case ET_QUAD:  quad.CalcShape (ip, shape); return true;
+        case ET_TET:   tet.CalcShape (ip, shape); return true;
+        case ET_PRISM: prism.CalcShape (ip, shape); return true;
+        case ET_HEX:   hex.CalcShape (ip, shape); return true;
+        default: return false;
+        }
+    }
+
+    /// fills the key of the element, returns false if not cacheable
+    static bool CalcKey (const FESpace & fes, const FiniteElement & fel, 
+                         const ElementTransformation & eltrans,
+                         const Ngs_Element & el, Entry & key, LocalHeap & lh)
+    {
+      ELEMENT_TYPE et = fel.ElementType();
+      int nv = ElementTopology::GetNVertices (et);
+      if (el.Vertices().Size() != nv) return false;
+
+      const POINT3D * verts = ElementTopology::GetVertices (et);
+      int sdim = eltrans.SpaceDim();
+
+      FlatMatrix<> pts(nv, sdim, lh);
+      for (int i = 0; i < nv; i++)
+        eltrans.CalcPoint (IntegrationPoint (verts[i][0], verts[i][1], verts[i][2], 0), pts.Row(i));
+
+      double h = 0;
+      for (int i = 1; i < nv; i++)
+        for (int j = 0; j < sdim; j++)
+          h = max2 (h, fabs (pts(i,j)-pts(0,j)));
+
+      // netgen marks all prisms and hexes as curved: compare with the 
+      // vertex map in the center and half way to the vertices
+      if (eltrans.IsCurvedElement())
+        {
+          FlatVector<> shape(nv, lh), p(sdim, lh), pv(sdim, lh);
+          Vec<3> center = 0.0;
+          for (int i = 0; i < nv; i++)
+            for (int k = 0; k < 3; k++)
+              center(k) += verts[i][k] / nv;
+
+          for (int i = -1; i < nv; i++)
+            {
+              Vec<3> x = center;
+              if (i >= 0)
+                for (int k = 0; k < 3; k++)
+                  x(k) = 0.5 * (center(k) + verts[i][k]);
+              IntegrationPoint ip(x(0), x(1), x(2), 0);
+              if (!CalcVertexShape (et, ip, shape)) return false;
+              eltrans.CalcPoint (ip, p);
+              pv = Trans (pts) * shape;
+              for (int j = 0; j < sdim; j++)
+                if (fabs (p(j)-pv(j)) > 1e-10 * h) return false;
+            }
+        }
+
+      key.et = et;
+      key.index = el.GetIndex();
+      key.ndof = fel.GetNDof();
+      key.order = fel.Order();
+      key.feltype = &typeid(fel);
+
+      // the dofs have to be distributed to the nodes, otherwise 
+      // the orders of the element are unknown
+      ArrayMem<int,100> dnums;
+      int sum = 0;
+      key.nodedofs.SetSize0();
+      auto count = [&] ()
+        {
+          key.nodedofs.Append (dnums.Size());
+          sum += dnums.Size();
+        };
+      for (int v : el.Vertices()) { fes.GetVertexDofNrs (v, dnums); count(); }
+      if (ElementTopology::GetSpaceDim (et) >= 2)
+        for (int e : el.Edges()) { fes.GetEdgeDofNrs (e, dnums); count(); }
+      if (ElementTopology::GetSpaceDim (et) == 3)
+        for (int f : el.Faces()) { fes.GetFaceDofNrs (f, dnums); count(); }
+      fes.GetInnerDofNrs (el.Nr(), dnums); count();
+      if (sum != key.ndof) return false;
+
+      key.orientation = 0;
+      auto vnums = el.Vertices();
+      for (int i = 0; i < nv; i++)
+        {
+          int rank = 0;
+          for (int j = 0; j < nv; j++)
+            if (vnums[j] < vnums[i]) rank++;
+          key.orientation = nv * key.orientation + rank;
+        }
+
+      key.geom.SetSize (sdim*(nv-1));
+      for (int i = 1; i < nv; i++)
+        for (int j = 0; j < sdim; j++)
+          key.geom((i-1)*sdim+j) = pts(i,j)-pts(0,j);
+
+      size_t hash = size_t(et) + 31 * (key.index + 31 * (key.ndof + 31 * (key.order + 31 * key.orientation)));
+      hash ^= key.feltype->hash_code();
+      for (int n : key.nodedofs)
+        hash = 31 * hash + n;
+      for (int i = 0; i < key.geom.Size(); i++)
+        hash = 1000003 * hash + size_t (long (floor (key.geom(i) / (1e-8*h) + 0.5)));
+      key.hash = hash;
+      return true;
+    }
+
+    static bool Equal (const Entry & a, const Entry & b)
+    {
+      if (a.hash != b.hash || a.et != b.et || a.index != b.index || a.ndof != b.ndof ||
+          a.order != b.order || a.feltype != b.feltype || a.orientation != b.orientation ||
+          a.nodedofs.Size() != b.nodedofs.Size() || a.geom.Size() != b.geom.Size())
+        return false;
+      for (int i = 0; i < a.nodedofs.Size(); i++)
+        if (a.nodedofs[i] != b.nodedofs[i]) return false;
+      double h = 0, diff = 0;
+      for (int i = 0; i < a.geom.Size(); i++)
+        {
+          h = max2 (h, fabs (a.geom(i)));
+          diff = max2 (diff, fabs (a.geom(i)-b.geom(i)));
+        }
+      return diff <= 1e-10 * h;
+    }
+
+    /// the cached matrix, or NULL
+    const Matrix<SCAL> * Lookup (const Entry & key)
+    {
+      for (size_t i = key.hash & mask; ; i = (i+1) & mask)
+        {
+          const Entry * entry = slots[i].load (memory_order_acquire);
+          if (!entry) break;
+          if (Equal (*entry, key))
+            {
+              hits.fetch_add (1, memory_order_relaxed);
+              return &entry->mat;
+            }
+        }
+      misses.fetch_add (1, memory_order_relaxed);
+      return NULL;
+    }
+
+    void Insert (const Entry & key, FlatMatrix<SCAL> mat)
+    {
+      if (reserved.fetch_add (1, memory_order_relaxed) >= maxsize) return;
+
+      Entry * entry = new Entry (key);
+      entry->mat.SetSize (mat.Height(), mat.Width());
+      entry->mat = mat;
+
+      // the entry is complete before it is published
+      for (size_t i = key.hash & mask; ; i = (i+1) & mask)
+        {
+          Entry * old = NULL;
+          if (slots[i].compare_exchange_strong (old, entry, memory_order_acq_rel))
+            {
+              stored++;
+              return;
+            }
+          if (Equal (*old, key)) break;   // inserted by another thread
+        }
+      delete entry;
+    }
+  };
+
+
   template <class SCAL>
   S_BilinearForm<SCAL> :: ~S_BilinearForm()
   {
@@ -600,6 +1055,32 @@ namespace ngcomp
   }
 
 
+  template <class SCAL>
+  void S_BilinearForm<SCAL> :: CompressCondensation ()
+  {
+    if (harmonicext) harmonicext -> Compress();
+    if (harmonicexttrans && !symmetric)
+      static_cast<ElementByElementMatrix<SCAL>*>(harmonicexttrans) -> Compress();
+    if (innersolve) innersolve -> Compress();
+    if (innermatrix) innermatrix -> Compress();
+  }
+
+
+  template <class SCAL>
+  void S_BilinearForm<SCAL> :: MemoryUsage (Array<MemoryUsageStruct*> & mu) const
+  {
+    BilinearForm::MemoryUsage (mu);
+
+    int olds = mu.Size();
+    if (harmonicext) harmonicext -> MemoryUsage (mu);
+    if (harmonicexttrans && !symmetric) harmonicexttrans -> MemoryUsage (mu);
+    if (innersolve) innersolve -> MemoryUsage (mu);
+    if (innermatrix) innermatrix -> MemoryUsage (mu);
+    for (int i = olds; i < mu.Size(); i++)
+      mu[i]->AddName (string(" bf ")+GetName());
+  }
+
+
 
 
   template <class SCAL>
@@ -618,6 +1099,9 @@ namespace ngcomp
     static Timer timer2 ("Matrix assembling - 2", 3);
     static Timer timer3 ("Matrix assembling - 3", 3);
     
+    static Timer timercachehit ("Matrix assembling - element matrix cache hit");
+    static Timer timercachemiss ("Matrix assembling - element matrix cache miss");
+
     static Timer timerb1 ("Matrix assembling bound - 1", 3);
     static Timer timerb2 ("Matrix assembling bound - 2", 3);
     static Timer timerb3 ("Matrix assembling bound - 3", 3);
@@ -703,6 +1187,8 @@ namespace ngcomp
 	    mat.SetZero();
 	    mattimerclear.Stop();
 
+            UpdateAssemblyPlan();
+
             bool hasbound = false;
             bool hasinner = false;
             bool hasskeletonbound = false;
@@ -743,6 +1229,34 @@ namespace ngcomp
             for (auto pre : preconditioners)
               pre -> InitLevel();
 
+            // keep the element matrices for incremental re-assembling
+            size_t stamp = ChangeTracker::Now();
+            bool store_elmats = incremental && !diagonal && !eliminate_internal &&
+              !hasskeletoninner && !hasskeletonbound && !preconditioners.Size();
+            incremental_valid = false;
+            // only the parts which are assembled below fill their tables
+            if (store_elmats)
+              for (VorB vb : { VOL, BND })
+                {
+                  bool haspart = (vb == VOL) ? hasinner : hasbound;
+                  int nel = haspart ? ma->GetNE(vb) : 0;
+                  Array<int> cnt(nel);
+#pragma omp parallel
+                  {
+                    Array<int> dnums;
+#pragma omp for
+                    for (int i = 0; i < nel; i++)
+                      {
+                        ElementId ei(vb, i);
+                        cnt[i] = 0;
+                        if (!fespace->DefinedOn (ei)) continue;
+                        fespace->GetDofNrs (ei, dnums);
+                        cnt[i] = sqr (dnums.Size()*fespace->GetDimension());
+                      }
+                  }
+                  stored_elmats[vb] = Table<SCAL> (cnt);
+                }
+
 	    mattimer1a.Stop();
 
             if (hasinner && !diagonal)
@@ -758,19 +1272,29 @@ namespace ngcomp
                     delete innersolve;
                     delete innermatrix;
 
-                    harmonicext = new ElementByElementMatrix<SCAL>(ndof, ne);
+                    // inner dofs belong to exactly one element
+                    harmonicext = new ElementByElementMatrix<SCAL>(ndof, ne, false, true, false);
                     if (!symmetric)
-                      harmonicexttrans = new ElementByElementMatrix<SCAL>(ndof, ne);
+                      harmonicexttrans = new ElementByElementMatrix<SCAL>(ndof, ne, false, false, true);
                     else
                       harmonicexttrans = new Transpose(*harmonicext);
-                    innersolve = new ElementByElementMatrix<SCAL>(ndof, ne);
+                    innersolve = new ElementByElementMatrix<SCAL>(ndof, ne, false, true, true);
                     if (store_inner)
-                      innermatrix = new ElementByElementMatrix<SCAL>(ndof, ne);
+                      innermatrix = new ElementByElementMatrix<SCAL>(ndof, ne, false, true, true);
                   }
 
+                shared_ptr<ElementMatrixCache<SCAL>> elmatcache;
+                if (elmat_cache)
+                  elmatcache = make_shared<ElementMatrixCache<SCAL>> (elmat_cache_size);
+
+                // colouring-free assembly needs exclusive access only to the matrix
+                bool concurrent = assembly_mode != ASSEMBLE_COLORED &&
+                  !preconditioners.Size() && !(eliminate_internal && linearform) &&
+                  StartConcurrentAssembly();
                 
-                IterateElements 
-                  (*fespace, VOL, clh,  [&] (FESpace::Element el, LocalHeap & lh)
+                active_plan = assembly_plan_valid ? &assembly_plan[VOL] : NULL;
+
+                auto assemble_element = [&] (FESpace::Element el, LocalHeap & lh)
                    {
                      if (elmat_ev) 
                        *testout << " Assemble Element " << el.Nr() << endl;  
@@ -782,6 +1306,13 @@ namespace ngcomp
                      const FiniteElement & fel = fespace->GetFE (el, lh);
                      const ElementTransformation & eltrans = ma->GetTrafo (el, lh);
                      FlatArray<int> dnums = el.GetDofs();
+                     if (eliminate_internal)
+                       {
+                         // inner dofs are marked by -1 below, don't touch stored dofs
+                         FlatArray<int> hdnums(dnums.Size(), lh);
+                         hdnums = dnums;
+                         dnums.Assign (hdnums);
+                       }
 
                      if (fel.GetNDof() != dnums.Size())
                        {
@@ -803,6 +1334,31 @@ namespace ngcomp
                      timer1.Stop();
                      timer2.Start();
 
+                     typename ElementMatrixCache<SCAL>::Entry cachekey;
+                     bool cacheable = false;
+                     if (elmatcache)
+                       {
+                         cacheable = !printelmat && !elmat_ev;
+                         for (int j = 0; j < NumIntegrators(); j++)
+                           if (parts[j]->VolumeForm() && parts[j]->DefinedOn (el.GetIndex()) &&
+                               !parts[j]->PiecewiseConstantCoefficients())
+                             cacheable = false;
+                         if (cacheable)
+                           cacheable = ElementMatrixCache<SCAL>::CalcKey (*fespace, fel, eltrans, el, cachekey, lh);
+                       }
+
+                     bool cachehit = false;
+                     if (cacheable)
+                       if (const Matrix<SCAL> * cached = elmatcache->Lookup (cachekey))
+                         {
+                           RegionTimer reg (timercachehit);
+                           sum_elmat = *cached;
+                           cachehit = true;
+                         }
+                     
+                     if (cacheable && !cachehit) timercachemiss.Start();
+
+                     if (!cachehit)
                      for (int j = 0; j < NumIntegrators(); j++)
                        {
                          HeapReset hr (lh);
@@ -859,6 +1415,12 @@ namespace ngcomp
                          sum_elmat += elmat;
                        }
 
+                     if (cacheable && !cachehit) 
+                       {
+                         elmatcache->Insert (cachekey, sum_elmat);
+                         timercachemiss.Stop();
+                       }
+
                      timer2.Stop();
                      timer3.Start();
                      fespace->TransformMat (el.Nr(), false, sum_elmat, TRANSFORM_MAT_LEFT_RIGHT);
@@ -1041,6 +1603,9 @@ namespace ngcomp
                        *testout<< "elem " << i << ", elmat = " << endl << sum_elmat << endl;
 
                      AddElementMatrix (dnums, dnums, sum_elmat, el, lh);
+
+                     if (store_elmats && elmat_size)
+                       FlatMatrix<SCAL> (elmat_size, elmat_size, &stored_elmats[VOL][i][0]) = sum_elmat;
                           
                      for (auto pre : preconditioners)
                        pre -> AddElementMatrix (dnums, sum_elmat, el, lh);
@@ -1049,9 +1614,27 @@ namespace ngcomp
                        if (d != -1) useddof[d] = true;
 
                      timer3.Stop();
-                   });
+                   };
 
+                if (concurrent)
+                  {
+                    IterateElementsUncolored (*fespace, VOL, clh, assemble_element,
+                                              [&] () { FlushConcurrentAssembly(); });
+                    FinishConcurrentAssembly();
+                  }
+                else
+                  IterateElements (*fespace, VOL, clh, assemble_element);
+
+                active_plan = NULL;
                 progress.Done();
+
+                if (eliminate_internal && keep_internal)
+                  CompressCondensation();
+
+                if (elmatcache)
+                  cout << IM(3) << "element matrix cache: " << elmatcache->hits << " hits, "
+                       << elmatcache->misses << " misses, " 
+                       << elmatcache->Size() << " matrices stored" << endl;
                 
                 /*
                 if (linearform && keep_internal)
@@ -1148,6 +1731,7 @@ namespace ngcomp
 		RegionTimer reg(mattimer_bound);
                 ProgressOutput progress (ma, "assemble surface element", ma->GetNSE());
 
+                active_plan = assembly_plan_valid ? &assembly_plan[BND] : NULL;
                 
                 IterateElements 
                   (*fespace, BND, clh, 
@@ -1229,6 +1813,9 @@ namespace ngcomp
                       timerb3.Start();
                       
                       AddElementMatrix (dnums, dnums, sumelmat, ei, lh);
+
+                      if (store_elmats && elmat_size)
+                        FlatMatrix<SCAL> (elmat_size, elmat_size, &stored_elmats[BND][i][0]) = sumelmat;
                       
                       for (auto pre : preconditioners)
                         pre -> AddElementMatrix (dnums, sumelmat, ei, lh);
@@ -1236,6 +1823,7 @@ namespace ngcomp
                       timerb3.Stop();
                    }); 
                 
+                active_plan = NULL;
                 progress.Done();
                 gcnt += nse;
 
@@ -1243,39 +1831,94 @@ namespace ngcomp
 
 
 	    RegionTimer reg(mattimer2);
+
+            // neighbouring volume elements and their local facet numbers,
+            // (el1, el2, facnr1, facnr2), el2 = -1 on the boundary
+            Array<INT<4>> facet_elements;
+            // surface element of a boundary facet, -1 else
+            Array<int> facet_selement;
+            // facets of one colour share no dofs
+            Table<int> all_facets;
+            const Table<int> * facet_colors = &fespace->FacetColoring();
+            bool facet_critical = false;
+            bool concurrent_facets = false;
+
+            if (hasskeletonbound || hasskeletoninner)
+              {
+                static Timer timerfacetels ("Matrix assembling - facet elements");
+                RegionTimer reg (timerfacetels);
+
+                facet_elements.SetSize (nf);
+                facet_selement.SetSize (nf);
+                facet_selement = -1;
+
+#pragma omp parallel
+                {
+                  Array<int> elnums, fnums;
+#pragma omp for
+                  for (int f = 0; f < nf; f++)
+                    {
+                      INT<4> & fe = facet_elements[f];
+                      fe = INT<4> (-1);
+                      ma->GetFacetElements (f, elnums);
+                      for (int k = 0; k < min2 (elnums.Size(), 2); k++)
+                        {
+                          fe[k] = elnums[k];
+                          ma->GetElFacets (elnums[k], fnums);
+                          fe[k+2] = fnums.Pos(f);
+                        }
+                    }
+
+#pragma omp for
+                  for (int i = 0; i < nse; i++)
+                    {
+                      ma->GetSElFacets (i, fnums);
+                      facet_selement[fnums[0]] = i;
+                    }
+                }
+
+                concurrent_facets = assembly_mode != ASSEMBLE_COLORED && 
+                  !preconditioners.Size() && StartConcurrentAssembly();
+
+                if (concurrent_facets || facet_colors->Size() == 0)
+                  {
+                    // one class with all facets, without a colouring 
+                    // (no -dgjumps) additions must be serialized
+                    facet_critical = !concurrent_facets;
+                    Array<int> cnt(1);
+                    cnt[0] = nf;
+                    all_facets = Table<int> (cnt);
+                    for (int f = 0; f < nf; f++)
+                      all_facets[0][f] = f;
+                    facet_colors = &all_facets;
+                  }
+              }
+
             if (hasskeletonbound)
               {
-                int cnt = 0;          
+                ProgressOutput progress (ma, "assemble facet surface element", nse);
 #pragma omp parallel
                 {
                   LocalHeap lh = clh.Split();
-                  Array<int> fnums, elnums, vnums, dnums;
+                  Array<int> vnums, dnums;
                 
-#pragma omp for 
-                  for (int i = 0; i < nse; i++)
+                  for (FlatArray<int> facets : *facet_colors)
+#pragma omp for schedule(dynamic)
+                  for (int fi = 0; fi < facets.Size(); fi++)
                     {
-#pragma omp critical(printmatasstatus2)
-                      {
-                        cnt++;
-                        gcnt++;
-                        if (cnt % 10 == 0)
-                          cout << "\rassemble facet surface element " << cnt << "/" << nse << flush;
-                        ma->SetThreadPercentage ( 100.0*(gcnt) / (loopsteps) );
-                      }
+                      int fac = facets[fi];
+                      int i = facet_selement[fac];
+                      if (i == -1) continue;
+
+                      progress.Update ();
                   
                       HeapReset hr(lh);
                       
                       if (!fespace->DefinedOnBoundary (ma->GetSElIndex (i))) continue;
-                      ma->GetSElFacets(i,fnums);
-                      int fac = fnums[0];
-                      ma->GetFacetElements(fac,elnums);
-                      int el = elnums[0];
-                      ma->GetElFacets(el,fnums);
+                      int el = facet_elements[fac][0];
+                      int facnr = facet_elements[fac][2];
                                   
                       const FiniteElement & fel = fespace->GetFE (el, lh);
-                      int facnr = 0;
-                      for (int k=0; k<fnums.Size(); k++)
-                        if(fac==fnums[k]) facnr = k;
                       ma->GetElVertices (el, vnums);     
 
                       ElementTransformation & eltrans = ma->GetTrafo (el, VOL, lh);
@@ -1349,72 +1992,43 @@ namespace ngcomp
                           //                    for(int k=0; k<elmat.Height(); k++)
                           //                      if(fabs(elmat(k,k)) < 1e-7 && dnums[k] != -1)
                           //                        cout << "dnums " << dnums << " elmat " << elmat << endl; 
+                          if (facet_critical)
+                            {
 #pragma omp critical(addelemfacbnd)
-                          {
+                              AddElementMatrix (dnums, dnums, elmat, ElementId(BND,i), lh);
+                            }
+                          else
                             AddElementMatrix (dnums, dnums, elmat, ElementId(BND,i), lh);
-                          }
                         }//end for (numintegrators)
                     }//end for nse                  
                 }//end of parallel
-                cout << "\rassemble facet surface element " << nse << "/" << nse << endl;         
+                progress.Done();
+                gcnt += nse;
               }//end of hasskeletonbound
+
             if (hasskeletoninner)
               {
-                int dim = ma->GetDimension();
-                BitArray fine_facet(nf);
-                fine_facet.Clear();
-                Array<int> elfacets;
-                for (int i = 0; i < ne; ++i)
-                  {
-                    if(dim==2)
-                      ma->GetElEdges(i,elfacets);
-                    else
-                      ma->GetElFaces(i,elfacets);
-                    for (int j=0;j<elfacets.Size();j++)
-                      fine_facet.Set(elfacets[j]);
-                  }
-
-                int cnt = 0;
+                ProgressOutput progress (ma, "assemble inner facet element", nf);
 #pragma omp parallel 
                 {
                   LocalHeap lh = clh.Split();
 
-                  // ElementTransformation eltrans1, eltrans2;
-                  Array<int> dnums, dnums1, dnums2, elnums, fnums, vnums1, vnums2;
-#pragma omp for 
-                  for (int i = 0; i < nf; i++)
-                    {
-                      if (!fine_facet.Test(i)) continue;
-                      HeapReset hr(lh);
-                      
-                      int el1 = -1;
-                      int el2 = -1;
-                      int facnr1 = -1;
-                      int facnr2 = -1;
-
-                      ma->GetFacetElements(i,elnums);
-                      el1 = elnums[0];
+                  Array<int> dnums, dnums1, dnums2, vnums1, vnums2;
 
-                      if(elnums.Size()<2) continue;
-                      el2 = elnums[1];
+                  for (FlatArray<int> facets : *facet_colors)
+#pragma omp for schedule(dynamic)
+                  for (int fi = 0; fi < facets.Size(); fi++)
+                    {
+                      int i = facets[fi];
+                      progress.Update ();
 
-                      ma->GetElFacets(el1,fnums);
-                      for (int k=0; k<fnums.Size(); k++)
-                        if(i==fnums[k]) facnr1 = k;
+                      int el1 = facet_elements[i][0];
+                      int el2 = facet_elements[i][1];
+                      int facnr1 = facet_elements[i][2];
+                      int facnr2 = facet_elements[i][3];
+                      if (el2 == -1) continue;
 
-                      ma->GetElFacets(el2,fnums);
-                      for (int k=0; k<fnums.Size(); k++)
-                        if(i==fnums[k]) facnr2 = k;
-                      
-#pragma omp critical(printmatasstatus2)
-                      {
-                        cnt++;
-                        gcnt++;
-                        if (cnt % 10 == 0)
-                          cout << "\rassemble inner facet element " << cnt << "/" << nf << flush;
-                        ma->SetThreadPercentage ( 100.0*(gcnt) / (loopsteps) );
-                      }
-                      
+                      HeapReset hr(lh);
                   
                       const FiniteElement & fel1 = fespace->GetFE (el1, lh);
                       const FiniteElement & fel2 = fespace->GetFE (el2, lh);
@@ -1430,7 +2044,7 @@ namespace ngcomp
                         dnums.Append(dnums2[d]);
                       ma->GetElVertices (el1, vnums1);
                       ma->GetElVertices (el2, vnums2);
-                      if(fel1.GetNDof() != dnums1.Size() || ((elnums.Size()>1) && (fel2.GetNDof() != dnums2.Size() )))
+                      if(fel1.GetNDof() != dnums1.Size() || (fel2.GetNDof() != dnums2.Size()))
                         {
                           cout << "facet, neighbouring fel(1): GetNDof() = " << fel1.GetNDof() << endl;
                           cout << "facet, neighbouring fel(2): GetNDof() = " << fel2.GetNDof() << endl;
@@ -1458,7 +2072,6 @@ namespace ngcomp
                             dynamic_cast<const FacetBilinearFormIntegrator&>(bfi);
                           fbfi.CalcFacetMatrix (fel1,facnr1,eltrans1,vnums1,
                                                 fel2,facnr2,eltrans2,vnums2, elmat, lh);
-                          *testout << "elmat : \n" << elmat << endl;
 
                           fespace->TransformMat (el1, false, elmat.Rows(0,dnums1.Size()), TRANSFORM_MAT_LEFT);
                           fespace->TransformMat (el2, false, elmat.Rows(dnums1.Size(),dnums2.Size()), TRANSFORM_MAT_LEFT);
@@ -1478,25 +2091,19 @@ namespace ngcomp
                               (*testout) << "elmat = " << endl << elmat << endl;
                             }
 
-                          Array<int> dnums;
-                          dnums.SetSize(0);
-                          dnums.Append(dnums1);
-                          dnums.Append(dnums2);
-                          
-                          ArrayMem<int, 50> map(dnums.Size());
+                          // dofs shared by both elements are merged
+                          FlatArray<int> map(dnums.Size(), lh);
                           for (int i = 0; i < map.Size(); i++) map[i] = i;
                           QuickSortI (dnums, map);
 
-                          Array<int> compressed_dnums;
-                          compressed_dnums.SetSize(0);
-                          
-                          Array<int> dnums_to_compressed(dnums.Size());
+                          FlatArray<int> compressed_dnums(dnums.Size(), lh);
+                          FlatArray<int> dnums_to_compressed(dnums.Size(), lh);
                           int compressed_dofs = 0;
                           for (int i = 0; i < dnums.Size(); ++i)
                           {
                             if (i==0 || (dnums[map[i]] != dnums[map[i-1]]))
                             {
-                              compressed_dnums.Append(dnums[map[i]]);
+                              compressed_dnums[compressed_dofs] = dnums[map[i]];
                               dnums_to_compressed[map[i]] = compressed_dofs++;
                             }
                             else
@@ -1504,6 +2111,7 @@ namespace ngcomp
                               dnums_to_compressed[map[i]] = dnums_to_compressed[map[i-1]];
                             }
                           }
+                          compressed_dnums.Assign (compressed_dnums.Range (0, compressed_dofs));
                           
                           FlatMatrix<SCAL> compressed_elmat(compressed_dofs * fespace->GetDimension(), lh);
                           compressed_elmat = 0.0;
@@ -1536,14 +2144,25 @@ namespace ngcomp
                           //                      if(fabs(elmat(k,k)) < 1e-7 && dnums[k] != -1)
                           //                        cout << "dnums " << dnums << " elmat " << elmat << endl; 
 
+                          if (facet_critical)
+                            {
 #pragma omp critical(addelemfacin)
-                          {
+                              AddElementMatrix (compressed_dnums, compressed_dnums, compressed_elmat, ElementId(BND,i), lh);
+                            }
+                          else
                             AddElementMatrix (compressed_dnums, compressed_dnums, compressed_elmat, ElementId(BND,i), lh);
-                          }
                         }
                     }
                 }
-                cout << "\rassemble inner facet element " << nf << "/" << nf << endl;     
+                progress.Done();
+                gcnt += nf;
+              }
+
+            if (concurrent_facets)
+              {
+#pragma omp parallel
+                FlushConcurrentAssembly();
+                FinishConcurrentAssembly();
               }
             ma->SetThreadPercentage ( 100.0 );
 
@@ -1633,6 +2252,16 @@ namespace ngcomp
             for (auto pre : preconditioners)
               pre -> FinalizeLevel();
 
+            if (store_elmats)
+              {
+                incremental_valid = true;
+                assembled_stamp = stamp;
+                dirty_elements[VOL].Clear();
+                dirty_elements[BND].Clear();
+                dirty_domains[VOL].Clear();
+                dirty_domains[BND].Clear();
+              }
+
             if (print)
               (*testout) << "mat = " << endl << GetMatrix() << endl;
 
@@ -1963,6 +2592,99 @@ namespace ngcomp
 
 
 
+  template <class SCAL>
+  void S_BilinearForm<SCAL> :: DoAssembleIncremental (LocalHeap & clh)
+  {
+    static Timer timer ("Matrix assembling incremental");
+    RegionTimer reg (timer);
+
+    size_t stamp = ChangeTracker::Now();
+    incremental_recomputed = 0;
+    incremental_total = 0;
+
+    for (VorB vb : { VOL, BND })
+      {
+        int nel = ma->GetNE(vb);
+        // no integrators for this part, nothing stored
+        if (stored_elmats[vb].Size() != nel) continue;
+
+        BitArray changed;
+        GetChangedDomains (vb, changed);
+
+        BitArray dirty(nel);
+        dirty.Clear();
+        const BitArray & dirty_els = dirty_elements[vb];
+        for (int i = 0; i < nel; i++)
+          {
+            if (stored_elmats[vb][i].Size() == 0) continue;
+            incremental_total++;
+            int index = (vb == VOL) ? ma->GetElIndex(i) : ma->GetSElIndex(i);
+            if (changed.Test(index) || (i < dirty_els.Size() && dirty_els.Test(i)))
+              {
+                dirty.Set (i);
+                incremental_recomputed++;
+              }
+          }
+
+        // add the difference of new and old element matrices
+        const Table<int> & element_coloring = fespace->ElementColoring(vb);
+        active_plan = assembly_plan_valid ? &assembly_plan[vb] : NULL;
+
+#pragma omp parallel
+        {
+          LocalHeap lh = clh.Split();
+          Array<int> temp_dnums;
+
+          for (FlatArray<int> els_of_col : element_coloring)
+#pragma omp for schedule(dynamic)
+            for (int i = 0; i < els_of_col.Size(); i++)
+              {
+                int nr = els_of_col[i];
+                if (!dirty.Test(nr)) continue;
+
+                HeapReset hr(lh);
+                FESpace::Element el(*fespace, ElementId (vb, nr), temp_dnums);
+                const FiniteElement & fel = fespace->GetFE (el, lh);
+                const ElementTransformation & eltrans = ma->GetTrafo (el, lh);
+                FlatArray<int> dnums = el.GetDofs();
+
+                int elmat_size = dnums.Size()*fespace->GetDimension();
+                FlatMatrix<SCAL> sum_elmat(elmat_size, lh);
+                FlatMatrix<SCAL> elmat(elmat_size, lh);
+                sum_elmat = SCAL(0.0);
+
+                for (auto & bfi : parts)
+                  {
+                    bool used = (vb == VOL) ? bfi->VolumeForm() : 
+                      (bfi->BoundaryForm() && !bfi->SkeletonForm());
+                    if (!used || !bfi->DefinedOn (el.GetIndex())) continue;
+                    
+                    bfi->CalcElementMatrix (fel, eltrans, elmat, lh);
+                    sum_elmat += elmat;
+                  }
+                fespace->TransformMat (nr, vb == BND, sum_elmat, TRANSFORM_MAT_LEFT_RIGHT);
+
+                FlatMatrix<SCAL> old_elmat(elmat_size, elmat_size, &stored_elmats[vb][nr][0]);
+                elmat = sum_elmat - old_elmat;
+                old_elmat = sum_elmat;
+
+                AddElementMatrix (dnums, dnums, elmat, el, lh);
+              }
+        }
+        active_plan = NULL;
+      }
+
+    assembled_stamp = stamp;
+    dirty_elements[VOL].Clear();
+    dirty_elements[BND].Clear();
+    dirty_domains[VOL].Clear();
+    dirty_domains[BND].Clear();
+
+    cout << IM(3) << "incremental assembling: recomputed " << incremental_recomputed 
+         << " of " << incremental_total << " elements" << endl;
+  }
+
+
   template <class SCAL>
   void S_BilinearForm<SCAL> :: AssembleLinearization (const BaseVector & lin,
                                                       LocalHeap & clh, 
@@ -1986,6 +2708,8 @@ namespace ngcomp
         mat = 0.0;
       
         cout << IM(3) << "Assemble linearization" << endl;
+
+        UpdateAssemblyPlan();
       
         Array<int> dnums;
       
@@ -2040,6 +2764,8 @@ namespace ngcomp
             */
 
 
+            active_plan = assembly_plan_valid ? &assembly_plan[VOL] : NULL;
+
             IterateElements 
               (*fespace, VOL, clh,  [&] (FESpace::Element el, LocalHeap & lh)
                {
@@ -2269,7 +2995,11 @@ namespace ngcomp
                    pre -> AddElementMatrix (dnums, sum_elmat, el, lh);
                });
             
+            active_plan = NULL;
             progress.Done();
+
+            if (eliminate_internal && keep_internal)
+              CompressCondensation();
           }
       
 
@@ -2301,7 +3031,8 @@ namespace ngcomp
 
             */
 
-            
+            active_plan = assembly_plan_valid ? &assembly_plan[BND] : NULL;
+
             IterateElements 
               (*fespace, BND, clh,  [&] (FESpace::Element el, LocalHeap & lh)
                {
@@ -2361,6 +3092,7 @@ namespace ngcomp
                  for (auto pre : preconditioners)
                    pre -> AddElementMatrix (dnums, sum_elmat, el, lh);
                });
+            active_plan = NULL;
             progress.Done();
           }
         
@@ -2437,6 +3169,7 @@ namespace ngcomp
       }
     catch (Exception & e)
       {
+        active_plan = NULL;
         stringstream ost;
         ost << "in Assemble BilinearForm" << endl;
         e.Append (ost.str());
@@ -2444,6 +3177,7 @@ namespace ngcomp
       }
     catch (exception & e)
       {
+        active_plan = NULL;
         throw (Exception (string(e.what()) +
                           string("\n in Assemble BilinearForm\n")));
       }
@@ -2974,7 +3708,48 @@ namespace ngcomp
 
     TMATRIX & mat = dynamic_cast<TMATRIX&> (*hmat);
 
-    mat.AddElementMatrix (dnums1, dnums2, elmat);
+    if (assembly_buffer)
+      assembly_buffer -> AddElementMatrix (dnums1, dnums2, elmat);
+    else if (this->active_plan && 
+             (*this->active_plan)[id.Nr()].Size() == dnums1.Size()*dnums2.Size())
+      mat.AddElementMatrixAt ((*this->active_plan)[id.Nr()], dnums1, dnums2, elmat, concurrent);
+    else if (concurrent)
+      mat.AddElementMatrixAtomic (dnums1, dnums2, elmat);
+    else
+      mat.AddElementMatrix (dnums1, dnums2, elmat);
+  }
+
+  template <class TM, class TV>
+  bool T_BilinearForm<TM,TV>::StartConcurrentAssembly ()
+  {
+    BaseMatrix * hmat = this->mats.Last().get();
+    
+#ifdef PARALLEL
+    ParallelMatrix * parmat = dynamic_cast<ParallelMatrix*> (hmat);
+    if (parmat) hmat = &parmat->GetMatrix();
+#endif   
+
+    TMATRIX * mat = dynamic_cast<TMATRIX*> (hmat);
+    if (!mat) return false;
+
+    concurrent = true;
+    if (this->assembly_mode == BilinearForm::ASSEMBLE_BUFFERED)
+      assembly_buffer = make_shared<SparseMatrixAssemblyBuffer<TM>> (*mat);
+    return true;
+  }
+
+  template <class TM, class TV>
+  void T_BilinearForm<TM,TV>::FlushConcurrentAssembly ()
+  {
+    if (assembly_buffer)
+      assembly_buffer -> Flush();
+  }
+
+  template <class TM, class TV>
+  void T_BilinearForm<TM,TV>::FinishConcurrentAssembly ()
+  {
+    concurrent = false;
+    assembly_buffer = NULL;
   }
 
 
@@ -3044,7 +3819,6 @@ namespace ngcomp
             elvecy *= val;
             y.AddIndirect (dnums, elvecy);  // coloring	      
           }
-        *testout << "||y|| = " << L2Norm(y) << endl;
       }
     else if (type == 2)
       {
@@ -3166,7 +3940,48 @@ namespace ngcomp
 
     TMATRIX & mat = dynamic_cast<TMATRIX&> (*hmat);
 
-    mat.AddElementMatrix (dnums1, elmat);
+    if (assembly_buffer)
+      assembly_buffer -> AddElementMatrix (dnums1, dnums2, elmat);
+    else if (this->active_plan && 
+             (*this->active_plan)[id.Nr()].Size() == dnums1.Size()*dnums2.Size())
+      mat.AddElementMatrixAt ((*this->active_plan)[id.Nr()], dnums1, dnums2, elmat, concurrent);
+    else if (concurrent)
+      mat.AddElementMatrixAtomic (dnums1, dnums2, elmat);
+    else
+      mat.AddElementMatrix (dnums1, elmat);
+  }
+
+  template <class TM, class TV>
+  bool T_BilinearFormSymmetric<TM,TV>::StartConcurrentAssembly ()
+  {
+    BaseMatrix * hmat = this->mats.Last().get();
+    
+#ifdef PARALLEL
+    ParallelMatrix * parmat = dynamic_cast<ParallelMatrix*> (hmat);
+    if (parmat) hmat = &parmat->GetMatrix();
+#endif   
+
+    TMATRIX * mat = dynamic_cast<TMATRIX*> (hmat);
+    if (!mat) return false;
+
+    concurrent = true;
+    if (this->assembly_mode == BilinearForm::ASSEMBLE_BUFFERED)
+      assembly_buffer = make_shared<SparseMatrixAssemblyBuffer<TM>> (*mat);
+    return true;
+  }
+
+  template <class TM, class TV>
+  void T_BilinearFormSymmetric<TM,TV>::FlushConcurrentAssembly ()
+  {
+    if (assembly_buffer)
+      assembly_buffer -> Flush();
+  }
+
+  template <class TM, class TV>
+  void T_BilinearFormSymmetric<TM,TV>::FinishConcurrentAssembly ()
+  {
+    concurrent = false;
+    assembly_buffer = NULL;
   }
 
 
@@ -3833,11 +4648,14 @@ namespace ngcomp
             Restrict( *prolMat, &( dynamic_cast< BaseSparseMatrix& >
             ( GetMatrix( i-1 ) ) ) ) );
           */
-          mats[i-1] =
-            shared_ptr<BaseMatrix>
-            ( dynamic_cast< const BaseSparseMatrix& >(GetMatrix(i) ).
-              Restrict( *prolMat, &( dynamic_cast< BaseSparseMatrix& >
-                                     (GetMatrix( i-1 ) ) ) ) );
+          // Restrict fills the existing coarse matrix and returns it,
+          // a new matrix (which we own) only if the types do not match
+          auto & cmat = dynamic_cast< BaseSparseMatrix& > (GetMatrix( i-1 ));
+          BaseSparseMatrix * rmat =
+            dynamic_cast< const BaseSparseMatrix& >(GetMatrix(i) ).
+            Restrict( *prolMat, &cmat );
+          if (rmat != &cmat)
+            mats[i-1] = shared_ptr<BaseMatrix> (rmat);
           
           delete prolMat;
         }
@@ -3903,6 +4721,148 @@ namespace ngcomp
     ;
   }
 
+  template <class SCAL>
+  MatrixFreeBilinearFormApplication<SCAL> :: 
+  MatrixFreeBilinearFormApplication (shared_ptr<BilinearForm> abf)
+    : BilinearFormApplication (abf)
+  {
+    if (bf->MixedSpaces())
+      throw Exception ("MatrixFreeBilinearFormApplication: mixed spaces not supported");
+
+    for (auto & bfi : bf->Integrators())
+      if (bfi->SkeletonForm())
+        throw Exception ("MatrixFreeBilinearFormApplication: no facet integrators yet");
+  }
+
+  template <class SCAL>
+  void MatrixFreeBilinearFormApplication<SCAL> :: 
+  Mult (const BaseVector & v, BaseVector & prod) const
+  {
+    v.Cumulate();
+
+    prod = 0;
+    T_MultAdd (1, v, prod);
+
+    prod.SetParallelStatus (DISTRIBUTED);
+  }
+
+  template <class SCAL>
+  void MatrixFreeBilinearFormApplication<SCAL> :: 
+  MultAdd (double val, const BaseVector & v, BaseVector & prod) const
+  {
+    v.Cumulate();
+    prod.Distribute();
+
+    T_MultAdd (val, v, prod);
+  }
+
+  template <class SCAL>
+  void MatrixFreeBilinearFormApplication<SCAL> :: 
+  MultAdd (Complex val, const BaseVector & v, BaseVector & prod) const
+  {
+    v.Cumulate();
+    prod.Distribute();
+
+    T_MultAdd (ConvertTo<SCAL> (val), v, prod);
+  }
+
+  template <class SCAL>
+  void MatrixFreeBilinearFormApplication<SCAL> :: 
+  MultTransAdd (double val, const BaseVector & v, BaseVector & prod) const
+  {
+    if (!bf->IsSymmetric())
+      throw Exception ("MatrixFreeBilinearFormApplication::MultTransAdd only for symmetric forms");
+    MultAdd (val, v, prod);
+  }
+
+  template <class SCAL>
+  void MatrixFreeBilinearFormApplication<SCAL> :: 
+  MultTransAdd (Complex val, const BaseVector & v, BaseVector & prod) const
+  {
+    if (!bf->IsSymmetric())
+      throw Exception ("MatrixFreeBilinearFormApplication::MultTransAdd only for symmetric forms");
+    MultAdd (val, v, prod);
+  }
+
+  template <class SCAL>
+  void MatrixFreeBilinearFormApplication<SCAL> :: 
+  T_MultAdd (SCAL val, const BaseVector & x, BaseVector & y) const
+  {
+    static Timer timer ("MatrixFree - apply");
+    RegionTimer reg (timer);
+
+    const FESpace & fes = *bf->GetFESpace();
+    const MeshAccess & ma = *fes.GetMeshAccess();
+    auto & parts = bf->Integrators();
+    int dim = fes.GetDimension();
+
+    static int lh_size = 5000000;
+
+    for (VorB vb : { VOL, BND })
+      {
+        bool needed = false;
+        for (auto & bfi : parts)
+          if (bfi->BoundaryForm() == (vb == BND)) needed = true;
+        if (!needed) continue;
+
+#ifdef _OPENMP
+        LocalHeap clh (lh_size*omp_get_max_threads(), "matrixfree - heap");
+#else
+        LocalHeap clh (lh_size, "matrixfree - heap");
+#endif
+        IterateElements 
+          (fes, vb, clh, [&] (FESpace::Element el, LocalHeap & lh)
+           {
+             const FiniteElement & fel = fes.GetFE (el, lh);
+             const ElementTransformation & eltrans = ma.GetTrafo (el, lh);
+             FlatArray<int> dnums = el.GetDofs();
+
+             FlatVector<SCAL> elx(dnums.Size()*dim, lh);
+             FlatVector<SCAL> ely(dnums.Size()*dim, lh);
+             FlatVector<SCAL> sumy(dnums.Size()*dim, lh);
+
+             x.GetIndirect (dnums, elx);
+             fes.TransformVec (el, elx, TRANSFORM_SOL);
+             
+             sumy = 0.0;
+             for (auto & bfi : parts)
+               {
+                 if (bfi->BoundaryForm() != (vb == BND)) continue;
+                 if (!bfi->DefinedOn (el.GetIndex())) continue;
+                 
+                 bfi->ApplyElementMatrix (fel, eltrans, elx, ely, 0, lh);
+                 sumy += ely;
+               }
+
+             fes.TransformVec (el, sumy, TRANSFORM_RHS);
+             sumy *= val;
+             y.AddIndirect (dnums, sumy);
+           });
+      }
+
+    if (fes.specialelements.Size())
+      {
+        LocalHeap lh (lh_size, "matrixfree - special elements");
+        Array<int> dnums;
+        for (auto sel : fes.specialelements)
+          {
+            HeapReset hr(lh);
+            sel->GetDofNrs (dnums);
+
+            FlatVector<SCAL> elx(dnums.Size()*dim, lh);
+            FlatVector<SCAL> ely(dnums.Size()*dim, lh);
+            x.GetIndirect (dnums, elx);
+            sel->Apply (elx, ely, lh);
+            ely *= val;
+            y.AddIndirect (dnums, ely);
+          }
+      }
+  }
+
+  template class MatrixFreeBilinearFormApplication<double>;
+  template class MatrixFreeBilinearFormApplication<Complex>;
+
+
   void  LinearizedBilinearFormApplication :: 
   Mult (const BaseVector & v, BaseVector & prod) const
   {
@@ -22,6 +22,15 @@ namespace ngcomp
   */
   class NGS_DLL_HEADER BilinearForm : public NGS_Object
   {
+  public:
+    /// scheduling of the parallel element loop in assembling
+    enum ASSEMBLY_MODE 
+      { 
+        ASSEMBLE_COLORED,    // elements of one colour in parallel
+        ASSEMBLE_ATOMIC,     // all elements in mesh order, atomic additions
+        ASSEMBLE_BUFFERED    // all elements in mesh order, thread-private buffers
+      };
+
   protected:
     /// Finite element space
     shared_ptr<FESpace> fespace;
@@ -30,6 +39,8 @@ namespace ngcomp
 
     /// don't assemble matrix
     bool nonassemble;
+    /// matrix-free operator application (implies nonassemble)
+    bool matrixfree;
     /// store only diagonal of matrix
     bool diagonal;
     /// store matrices on mesh hierarchy
@@ -89,6 +100,36 @@ namespace ngcomp
     Array<void*> precomputed_data;
     /// output of norm of matrix entries
     bool checksum;
+    /// reuse element matrices of geometrically identical elements
+    bool elmat_cache;
+    /// maximal number of stored element matrices
+    int elmat_cache_size;
+    /// how element matrices are added in parallel
+    ASSEMBLY_MODE assembly_mode;
+    /// precompute matrix positions of element matrix entries for re-assembly
+    bool use_assembly_plan;
+    /// matrix positions of the element matrix entries, per VOL/BND element
+    Table<int> assembly_plan[2];
+    /// plan is built, and no integrator was added since
+    bool assembly_plan_valid = false;
+    /// mesh level, dofs, elements and matrix entries of the plan
+    size_t assembly_plan_key[5];
+    /// plan used by AddElementMatrix, NULL if none
+    const Table<int> * active_plan = NULL;
+    /// re-assemble only elements with changed element matrices
+    bool incremental;
+    /// element matrices of the last assembling are stored
+    bool incremental_valid = false;
+    /// change stamp of the last assembling
+    size_t assembled_stamp = 0;
+    /// VOL/BND elements marked by SetDirtyElement
+    BitArray dirty_elements[2];
+    /// VOL/BND sub-domains marked by SetDirtyDomain
+    BitArray dirty_domains[2];
+    /// recomputed and total number of elements in the last re-assembling
+    int incremental_recomputed = 0, incremental_total = 0;
+    /// sub-domains where an integrator changed since the last assembling
+    void GetChangedDomains (VorB vb, BitArray & changed) const;
 
   public:
     /// generate a bilinear-form
@@ -279,6 +320,16 @@ namespace ngcomp
     /// don't assemble the matrix
     void SetNonAssemble (bool na = true) { nonassemble = na; }
 
+    /// apply the operator matrix-free, element by element
+    void SetMatrixFree (bool mf = true) 
+    { 
+      matrixfree = mf; 
+      if (mf) nonassemble = true;
+    }
+
+    ///
+    bool IsMatrixFree () const { return matrixfree; }
+
     ///
     void SetGalerkin (bool agalerkin = true) { galerkin = agalerkin; }
 
@@ -297,6 +348,13 @@ namespace ngcomp
     ///
     void SetTiming (bool at) { timing = at; }
 
+    ///
+    void SetAssemblyMode (ASSEMBLY_MODE am) { assembly_mode = am; }
+    /// "colored", "atomic" or "buffered"
+    void SetAssemblyMode (const string & am);
+    ///
+    ASSEMBLY_MODE GetAssemblyMode () const { return assembly_mode; }
+
     void SetEliminateInternal (bool eliminate) 
     { eliminate_internal = eliminate; }
 
@@ -313,6 +371,28 @@ namespace ngcomp
     /// computes low-order matrices from fines matrix
     void GalerkinProjection ();
 
+    /// precomputes the matrix positions of all VOL and BND element matrices
+    void BuildAssemblyPlan ();
+    /// rebuilds the plan if the mesh, the space or the integrators changed
+    void UpdateAssemblyPlan ();
+
+    /// re-assemble only changed elements in ReAssemble
+    void SetIncremental (bool inc = true) 
+    { 
+      incremental = inc; 
+      if (!inc) incremental_valid = false;
+    }
+    ///
+    bool IsIncremental () const { return incremental; }
+    /// element matrix has to be recomputed in the next ReAssemble
+    void SetDirtyElement (ElementId ei);
+    /// element matrices on sub-domain have to be recomputed 
+    void SetDirtyDomain (VorB vb, int index);
+    /// next ReAssemble recomputes all elements
+    void SetAllDirty () { incremental_valid = false; }
+    /// number of elements recomputed in the last incremental re-assembling
+    int GetNRecomputedElements () const { return incremental_recomputed; }
+
     /// reconstruct internal dofs
     virtual void ComputeInternal (BaseVector & u, const BaseVector & f, LocalHeap & lh) const = 0;
 
@@ -352,6 +432,9 @@ namespace ngcomp
     /// assemble matrix
     virtual void DoAssemble (LocalHeap & lh) = 0;
 
+    /// update matrix by changed element matrices 
+    virtual void DoAssembleIncremental (LocalHeap & lh) = 0;
+
     /// allocates (sparse) matrix data-structure
     virtual void AllocateMatrix () = 0;
   };
@@ -373,6 +456,11 @@ namespace ngcomp
     BaseMatrix * harmonicexttrans = NULL;
     ElementByElementMatrix<SCAL> * innersolve = NULL;
     ElementByElementMatrix<SCAL> * innermatrix = NULL;
+    /// element matrices of the last assembling, per VOL/BND element
+    Table<SCAL> stored_elmats[2];
+
+    /// compact storage of the static condensation matrices
+    void CompressCondensation ();
 
         
   public:
@@ -406,6 +494,8 @@ namespace ngcomp
 
     ~S_BilinearForm();
 
+    virtual void MemoryUsage (Array<MemoryUsageStruct*> & mu) const;
+
     ///
     void AddMatrix1 (SCAL val, const BaseVector & x,
 		     BaseVector & y) const;
@@ -460,6 +550,8 @@ namespace ngcomp
     ///
     virtual void DoAssemble (LocalHeap & lh);
     ///
+    virtual void DoAssembleIncremental (LocalHeap & lh);
+    ///
     // virtual void DoAssembleIndependent (BitArray & useddof, LocalHeap & lh);
     ///
     virtual void AssembleLinearization (const BaseVector & lin,
@@ -472,6 +564,13 @@ namespace ngcomp
 				   ElementId id, 
 				   LocalHeap & lh) = 0;
 
+    /// switches AddElementMatrix to concurrent mode, returns false if not supported
+    virtual bool StartConcurrentAssembly () { return false; }
+    /// called by every thread after its last AddElementMatrix
+    virtual void FlushConcurrentAssembly () { ; }
+    /// back to sequential AddElementMatrix
+    virtual void FinishConcurrentAssembly () { ; }
+
     virtual void ApplyElementMatrix(const BaseVector & x,
 				    BaseVector & y,
 				    const SCAL & val,
@@ -525,6 +624,10 @@ namespace ngcomp
     typedef SparseMatrix<TM,TV,TV> TMATRIX;
     
   protected:
+    /// colouring-free AddElementMatrix is active
+    bool concurrent = false;
+    /// thread buffers for ASSEMBLE_BUFFERED
+    shared_ptr<SparseMatrixAssemblyBuffer<TM>> assembly_buffer;
 
   public:
     ///
@@ -553,6 +656,10 @@ namespace ngcomp
 				   ElementId id, 
 				   LocalHeap & lh);
 
+    virtual bool StartConcurrentAssembly ();
+    virtual void FlushConcurrentAssembly ();
+    virtual void FinishConcurrentAssembly ();
+
     virtual void ApplyElementMatrix(const BaseVector & x,
 				    BaseVector & y,
 				    const TSCAL & val,
@@ -583,6 +690,10 @@ namespace ngcomp
     typedef SparseMatrixSymmetric<TM,TV> TMATRIX;
     
   protected:
+    /// colouring-free AddElementMatrix is active
+    bool concurrent = false;
+    /// thread buffers for ASSEMBLE_BUFFERED
+    shared_ptr<SparseMatrixAssemblyBuffer<TM>> assembly_buffer;
     
 
   public:
@@ -600,6 +711,11 @@ namespace ngcomp
                                    FlatMatrix<TSCAL> elmat,
 				   ElementId id, 
 				   LocalHeap & lh);
+
+    virtual bool StartConcurrentAssembly ();
+    virtual void FlushConcurrentAssembly ();
+    virtual void FinishConcurrentAssembly ();
+
     virtual void ApplyElementMatrix(const BaseVector & x,
 				    BaseVector & y,
 				    const TSCAL & val,
@@ -734,6 +850,35 @@ namespace ngcomp
   };
 
 
+  /**
+     Matrix-free operator of a bilinear-form.
+     Applies B, D and B^T of the integrators element by element 
+     in the integration points (Evaluate / EvaluateTrans kernels),
+     parallel over the element coloring. Neither global nor element
+     matrices are stored.
+   */
+  template <class SCAL>
+  class NGS_DLL_HEADER MatrixFreeBilinearFormApplication : public BilinearFormApplication
+  {
+  public:
+    ///
+    MatrixFreeBilinearFormApplication (shared_ptr<BilinearForm> abf);
+    ///
+    virtual void Mult (const BaseVector & v, BaseVector & prod) const;
+    ///
+    virtual void MultAdd (double val, const BaseVector & v, BaseVector & prod) const;
+    ///
+    virtual void MultAdd (Complex val, const BaseVector & v, BaseVector & prod) const;
+    /// only for symmetric forms
+    virtual void MultTransAdd (double val, const BaseVector & v, BaseVector & prod) const;
+    /// only for symmetric forms
+    virtual void MultTransAdd (Complex val, const BaseVector & v, BaseVector & prod) const;
+
+  protected:
+    void T_MultAdd (SCAL val, const BaseVector & x, BaseVector & y) const;
+  };
+
+
   /**
      This bilinearform stores the element-matrices
    */
@@ -44,6 +44,7 @@ namespace ngcomp
     DefineNumFlag ("definedonbound");
     DefineStringListFlag ("definedonbound");
     DefineDefineFlag("dgjumps");
+    DefineDefineFlag("storedofs");
 
     order = int (flags.GetNumFlag ("order", 1));
     dimension = int (flags.GetNumFlag ("dim", 1));
@@ -52,6 +53,7 @@ namespace ngcomp
     timing = flags.GetDefineFlag("timing");
     print = flags.GetDefineFlag("print");
     dgjumps = flags.GetDefineFlag("dgjumps");
+    store_element_dofs = flags.GetDefineFlag("storedofs");
     no_low_order_space = flags.GetDefineFlag("no_low_order_space");
     if (dgjumps) 
       *testout << "ATTENTION: flag dgjumps is used!\n This leads to a \
@@ -274,6 +276,9 @@ lot of new non-zero entries in the matrix!\n" << endl;
       delete specialelements[i]; 
     specialelements.SetSize(0);
 
+    // dofs change, the table is rebuilt in FinalizeUpdate
+    element_dofs[VOL] = Table<int>();
+    element_dofs[BND] = Table<int>();
 
     int dim = ma->GetDimension();
     
@@ -319,6 +324,160 @@ lot of new non-zero entries in the matrix!\n" << endl;
       }
   }
 
+  /*
+    Parallel coloring by iterative conflict resolution: 
+    all uncolored items choose a color concurrently, among the colors 
+    not used by neighbours (items sharing a dof) the least used one. 
+    Items with a neighbour of smaller index and the same color are 
+    uncolored and recolored in the next round.
+    Colors and class sizes are read while other threads write them, 
+    so all accesses are atomic (relaxed, the barrier between choosing 
+    and conflict detection orders the rounds).
+   */
+  static Table<int> ParallelColoring (FlatArray<int> items, const Table<int> & item2dof, 
+                                      int ndof, Timer & timer, const string & name)
+  {
+    RegionTimer reg (timer);
+    int n = items.Size();
+
+    // dof -> items
+    Array<int> cnt(ndof);
+    cnt = 0;
+#pragma omp parallel for
+    for (int i = 0; i < n; i++)
+      for (int d : item2dof[i])
+        AtomicAdd (cnt[d], 1);
+
+    Table<int> dof2item(cnt);
+    cnt = 0;
+#pragma omp parallel for
+    for (int i = 0; i < n; i++)
+      for (int d : item2dof[i])
+        dof2item[d][AtomicAdd (cnt[d], 1)] = i;
+
+    // number of neighbours bounds the number of colors
+    int maxneighbours = 0;
+#pragma omp parallel
+    {
+      int mymax = 0;
+#pragma omp for
+      for (int i = 0; i < n; i++)
+        {
+          int sum = 0;
+          for (int d : item2dof[i])
+            sum += dof2item[d].Size();
+          mymax = max2 (mymax, sum);
+        }
+#pragma omp critical(parallelcoloring)
+      maxneighbours = max2 (maxneighbours, mymax);
+    }
+
+    Array<atomic<int>> col(n), colsize(maxneighbours+1);
+    Array<int> conflict(n);
+    for (auto & c : col) c.store (-1, memory_order_relaxed);
+    for (auto & s : colsize) s.store (0, memory_order_relaxed);
+    atomic<int> ncolors(0);
+
+    Array<int> work(n);
+    for (int i = 0; i < n; i++) work[i] = i;
+
+    while (work.Size())
+      {
+#pragma omp parallel
+        {
+          Array<int> forbidden(maxneighbours+1);
+          forbidden = -1;
+
+#pragma omp for schedule(dynamic, 256)
+          for (int k = 0; k < work.Size(); k++)
+            {
+              int i = work[k];
+              for (int d : item2dof[i])
+                for (int j : dof2item[d])
+                  {
+                    int c = col[j].load (memory_order_relaxed);
+                    if (j != i && c >= 0) forbidden[c] = i;
+                  }
+
+              int best = -1, bestsize = 0;
+              int nc = ncolors.load (memory_order_relaxed);
+              for (int c = 0; c < nc; c++)
+                if (forbidden[c] != i)
+                  {
+                    int size = colsize[c].load (memory_order_relaxed);
+                    if (best == -1 || size < bestsize)
+                      {
+                        best = c;
+                        bestsize = size;
+                      }
+                  }
+
+              if (best == -1)
+                {
+                  best = nc;
+                  while (forbidden[best] == i) best++;
+                  int old = nc;
+                  while (old <= best && 
+                         !ncolors.compare_exchange_weak (old, best+1, memory_order_relaxed))
+                    ;
+                }
+
+              col[i].store (best, memory_order_relaxed);
+              colsize[best].fetch_add (1, memory_order_relaxed);
+            }
+
+#pragma omp for
+          for (int k = 0; k < work.Size(); k++)
+            {
+              int i = work[k];
+              conflict[k] = 0;
+              int ci = col[i].load (memory_order_relaxed);
+              for (int d : item2dof[i])
+                for (int j : dof2item[d])
+                  if (j < i && col[j].load (memory_order_relaxed) == ci) conflict[k] = 1;
+            }
+        }
+
+        int nwork = 0;
+        for (int k = 0; k < work.Size(); k++)
+          if (conflict[k])
+            {
+              int i = work[k];
+              colsize[col[i]]--;
+              col[i] = -1;
+              work[nwork++] = i;
+            }
+        work.SetSize (nwork);
+      }
+
+    int nc = ncolors;
+    while (nc > 0 && colsize[nc-1] == 0) nc--;
+
+    Array<int> size(nc);
+    for (int c = 0; c < nc; c++) size[c] = colsize[c];
+    Table<int> coloring(size);
+    size = 0;
+    for (int i = 0; i < n; i++)
+      coloring[col[i]][size[col[i]]++] = items[i];
+
+    int minsize = n, maxsize = 0;
+    for (int c = 0; c < nc; c++)
+      {
+        minsize = min2 (minsize, coloring[c].Size());
+        maxsize = max2 (maxsize, coloring[c].Size());
+      }
+    
+    stringstream str;
+    str << name << ": " << nc << " colors, class sizes " 
+        << minsize << " - " << maxsize;
+    if (nc)
+      str << ", max/avg = " << double(maxsize) * nc / n;
+    timer.SetName (str.str());
+
+    return coloring;
+  }
+
+
   void FESpace :: FinalizeUpdate(LocalHeap & lh)
   {
     static Timer timer ("FESpace::FinalizeUpdate");
@@ -327,6 +486,45 @@ lot of new non-zero entries in the matrix!\n" << endl;
 
     RegionTimer reg (timer);
 
+    element_dofs[VOL] = Table<int>();
+    element_dofs[BND] = Table<int>();
+
+    if (store_element_dofs)
+      {
+        static Timer timerdofs ("FESpace::FinalizeUpdate - element dofs");
+        RegionTimer regdofs (timerdofs);
+
+        for (auto vb = VOL; vb <= BND; vb++)
+          {
+            int ne = ma->GetNE(vb);
+            Array<int> cnt(ne);
+#pragma omp parallel
+            {
+              Array<int> dnums;
+#pragma omp for
+              for (int i = 0; i < ne; i++)
+                {
+                  GetDofNrs (ElementId(vb, i), dnums);
+                  cnt[i] = dnums.Size();
+                }
+            }
+
+            Table<int> eldofs(cnt);
+#pragma omp parallel
+            {
+              Array<int> dnums;
+#pragma omp for
+              for (int i = 0; i < ne; i++)
+                {
+                  GetDofNrs (ElementId(vb, i), dnums);
+                  eldofs[i] = dnums;
+                }
+            }
+
+            element_dofs[vb] = move(eldofs);
+          }
+      }
+
     dirichlet_dofs.SetSize (GetNDof());
     dirichlet_dofs.Clear();
 
@@ -396,123 +594,106 @@ lot of new non-zero entries in the matrix!\n" << endl;
       *testout << "coloring ... " << flush;
 
 
+    static Timer timercol ("FESpace::FinalizeUpdate - coloring");
+    static Timer timervol ("coloring vol");
+    static Timer timerbnd ("coloring bnd");
+    static Timer timerfacet ("coloring facet");
+    RegionTimer regcol (timercol);
+
     for (auto vb = VOL; vb <= BND; vb++)
       {
-        Array<int> col(ma->GetNE(vb));
-        col = -1;
-        // bool found;
-        int maxcolor = 0;
-        
-        int basecol = 0;
-        Array<unsigned int> mask(GetNDof());
+        Array<int> items;
+        for (ElementId el : Elements(vb))
+          items.Append (el.Nr());
 
-        int cnt = 0, found = 0;
-        for (ElementId el : Elements(vb)) { cnt++; (void)el; } // no warning 
+        Array<int> cnt(items.Size());
+#pragma omp parallel
+        {
+          Array<int> dnums;
+#pragma omp for
+          for (int i = 0; i < items.Size(); i++)
+            {
+              GetDofNrs (ElementId(vb, items[i]), dnums);
+              cnt[i] = 0;
+              for (int d : dnums)
+                if (d != -1) cnt[i]++;
+            }
+        }
 
-        do
-          {
-            mask = 0;
+        Table<int> item2dof(cnt);
+#pragma omp parallel
+        {
+          Array<int> dnums;
+#pragma omp for
+          for (int i = 0; i < items.Size(); i++)
+            {
+              GetDofNrs (ElementId(vb, items[i]), dnums);
+              int k = 0;
+              for (int d : dnums)
+                if (d != -1) item2dof[i][k++] = d;
+            }
+        }
 
-            for (auto el : Elements(vb))
-              {
-                if (col[el.Nr()] >= 0) continue;
+        Table<int> & coloring = (vb == VOL) ? element_coloring : selement_coloring;
+        coloring = ParallelColoring (items, item2dof, GetNDof(), 
+                                     (vb == VOL) ? timervol : timerbnd,
+                                     (vb == VOL) ? "coloring vol" : "coloring bnd");
 
-                unsigned check = 0;
-                for (auto d : el.GetDofs())
-                  if (d != -1) check |= mask[d];
+        if (print)
+          *testout << "needed " << coloring.Size() << " colors" 
+                   << " for " << ((vb == VOL) ? "vol" : "bnd") << endl;
+      }
 
-                if (check != UINT_MAX) // 0xFFFFFFFF)
-                  {
-                    found++;
-                    unsigned checkbit = 1;
-                    int color = basecol;
-                    while (check & checkbit)
-                      {
-                        color++;
-                        checkbit *= 2;
-                      }
+    if (UsesDGCoupling())
+      {
+        // a facet couples the dofs of its neighbouring elements
+        int nf = ma->GetNFacets();
+        Array<int> items(nf), cnt(nf);
+        for (int f = 0; f < nf; f++) items[f] = f;
 
-                    col[el.Nr()] = color;
-                    if (color > maxcolor) maxcolor = color;
-		
-                    for (auto d : el.GetDofs())
-                      if (d != -1) mask[d] |= checkbit;
+#pragma omp parallel
+        {
+          Array<int> elnums, dnums;
+#pragma omp for
+          for (int f = 0; f < nf; f++)
+            {
+              ma->GetFacetElements (f, elnums);
+              cnt[f] = 0;
+              for (int el : elnums)
+                if (DefinedOn (ElementId(VOL, el)))
+                  {
+                    GetDofNrs (ElementId(VOL, el), dnums);
+                    for (int d : dnums)
+                      if (d != -1) cnt[f]++;
                   }
-              }
-            
-            basecol += 8*sizeof(unsigned int); // 32;
-          }
-        while (found < cnt);
-
-
-	/*
-	  // didn't help anything ...
-	cout << "have " << maxcolor+1 << " colors, try to reduce ***************** " << endl;
-
-	DynamicTable<int> dof2color(GetNDof());
-	for (auto el : Elements(vb))
-	  for (auto d : el.GetDofs())
-	    dof2color.Add(d, col[el.Nr()]);
-
-	*testout << "dof2color = " << endl << dof2color << endl;
-
-	for (int c = 0; c <= maxcolor; c++)
-	  {
-	    *testout << "try to reschedule color " << c << endl;
-	    
-	    bool remove_col = true;
-	    int cntmove = 0, cnttot = 0;
-	    
-	    for (auto el : Elements(vb))
-	      if (col[el.Nr()] == c)
-		{
-		  bool resched = false;
-
-		  for (int newcol = c+1; newcol <= maxcolor; newcol++)
-		    {
-		      bool possible = true;
-		      for (auto d : el.GetDofs())
-			if (dof2color[d].Contains(newcol))
-			  {
-			    possible = false; 
-			    break;
-			  }
-		      if (possible) resched = true;
-		    }
-
-		  if (resched) cntmove++;
-		  cnttot++;
-		  if (!resched) 
-		    {
-		      *testout << "cannot move el with dofs " << el.GetDofs() << endl;
-		      remove_col = false;
-		    }
-		}
-
-	    *testout << "could move " << cntmove << " out of " << cnttot << endl;
-	    if (remove_col) cout << "could remove color" << endl;
-	  }
-
-	*/
-
-
-
-        Array<int> cntcol(maxcolor+1);
-        cntcol = 0;
-        for (ElementId el : Elements(vb))
-          cntcol[col[el.Nr()]]++;
-
-        Table<int> & coloring = (vb == VOL) ? element_coloring : selement_coloring;
-        coloring = Table<int> (cntcol);
+            }
+        }
 
-	cntcol = 0;
-        for (ElementId el : Elements(vb))
-          coloring[col[el.Nr()]][cntcol[col[el.Nr()]]++] = el.Nr();
+        Table<int> facet2dof(cnt);
+#pragma omp parallel
+        {
+          Array<int> elnums, dnums;
+#pragma omp for
+          for (int f = 0; f < nf; f++)
+            {
+              ma->GetFacetElements (f, elnums);
+              int k = 0;
+              for (int el : elnums)
+                if (DefinedOn (ElementId(VOL, el)))
+                  {
+                    GetDofNrs (ElementId(VOL, el), dnums);
+                    for (int d : dnums)
+                      if (d != -1) facet2dof[f][k++] = d;
+                  }
+            }
+        }
 
-        if (print)
-          *testout << "needed " << maxcolor+1 << " colors" 
-                   << " for " << ((vb == VOL) ? "vol" : "bnd") << endl;
+        facet_coloring = ParallelColoring (items, facet2dof, GetNDof(), 
+                                           timerfacet, "coloring facet");
       }
+    else
+      facet_coloring = Table<int>();
+
 
 
     level_updated = ma->GetNLevels();
@@ -690,7 +871,7 @@ lot of new non-zero entries in the matrix!\n" << endl;
   void FESpace :: GetDofNrs (int elnr, Array<int> & dnums, COUPLING_TYPE ctype) const
   {
     ArrayMem<int,100> alldnums; 
-    GetDofNrs(elnr, alldnums);
+    GetDofNrs(ElementId(VOL, elnr), alldnums);
 
     dnums.SetSize(0);
     if (ctofdof.Size() == 0)
@@ -789,7 +970,8 @@ lot of new non-zero entries in the matrix!\n" << endl;
 	<< "order = " << order << endl
 	<< "dim   = " << dimension << endl
 	<< "dgjmps= " << dgjumps << endl
-	<< "complex = " << iscomplex << endl;
+	<< "complex = " << iscomplex << endl
+        << "storedofs = " << StoresElementDofs() << endl;
 
     if (!free_dofs.Size()) return;
 
@@ -807,6 +989,19 @@ lot of new non-zero entries in the matrix!\n" << endl;
 	nfree++;
   }
   
+  void FESpace :: MemoryUsage (Array<MemoryUsageStruct*> & mu) const
+  {
+    int olds = mu.Size();
+    for (auto vb = VOL; vb <= BND; vb++)
+      if (element_dofs[vb].Size())
+        mu.Append (new MemoryUsageStruct ((vb == VOL) ? "ElementDofs" : "SElementDofs",
+                                          element_dofs[vb].NElements() * sizeof(int) +
+                                          (element_dofs[vb].Size()+1) * sizeof(size_t), 2));
+
+    for (int i = olds; i < mu.Size(); i++)
+      mu[i]->AddName (string(" fes ")+GetName());
+  }
+  
   void FESpace :: DoArchive (Archive & archive)
   {
     archive & order & dimension & iscomplex & dgjumps & print & level_updated;
@@ -157,6 +157,12 @@ namespace ngcomp
 
     Table<int> element_coloring; 
     Table<int> selement_coloring;
+    /// only for spaces with dg-coupling
+    Table<int> facet_coloring;
+    /// keep the dofs of all elements in a table (flag -storedofs)
+    bool store_element_dofs;
+    /// dofs of VOL/BND elements, empty if not stored
+    Table<int> element_dofs[2];
     Array<COUPLING_TYPE> ctofdof;
 
     ParallelDofs * paralleldofs; // = NULL;
@@ -190,9 +196,15 @@ namespace ngcomp
     const Table<int> & ElementColoring(VorB vb = VOL) const 
     { return (vb == VOL) ? element_coloring : selement_coloring; }
 
+    /// facets coupling common dofs get different colors (only with dg-coupling)
+    const Table<int> & FacetColoring() const { return facet_coloring; }
+
     /// print report to stream
     virtual void PrintReport (ostream & ost) const;
 
+    /// memory of stored element dofs
+    virtual void MemoryUsage (Array<MemoryUsageStruct*> & mu) const;
+
     /// Dump/restore fespace
     virtual void DoArchive (Archive & archive);
 
@@ -233,6 +245,10 @@ namespace ngcomp
 
       INLINE FlatArray<int> GetDofs() const
       {
+        // view into the table of stored element dofs
+        const Table<int> & eldofs = fes.element_dofs[VorB(*this)];
+        if (eldofs.Size()) return eldofs[Nr()];
+
         if (!dofs_set)
           fes.GetDofNrs (*this, temp_dnums);
         dofs_set = true;
@@ -295,7 +311,10 @@ namespace ngcomp
     /// get dof-nrs of domain or boundary element elnr
     void GetDofNrs (ElementId ei, Array<int> & dnums) const
     {
-      if (ei.IsBoundary())
+      const Table<int> & eldofs = element_dofs[VorB(ei)];
+      if (eldofs.Size())
+        dnums = eldofs[ei.Nr()];
+      else if (ei.IsBoundary())
 	GetSDofNrs (ei.Nr(), dnums);
       else
 	GetDofNrs (ei.Nr(), dnums);
@@ -303,6 +322,11 @@ namespace ngcomp
 
     Table<int> CreateDofTable (VorB vorb) const;
 
+    /// keep dofs of all elements in a table, built in FinalizeUpdate
+    void SetStoreElementDofs (bool store = true) { store_element_dofs = store; }
+    ///
+    bool StoresElementDofs () const { return element_dofs[VOL].Size() > 0; }
+
     // virtual void GetDofRanges (ElementId ei, Array<IntRange> & dranges) const;
 
     // FlatArray<int> GetDofNrs (ElementId ei, LocalHeap & lh) const;
@@ -621,6 +645,41 @@ namespace ngcomp
   }
 
 
+  /**
+     Parallel loop over all elements in mesh order, without colouring.
+     func must be safe for concurrent updates of shared dofs, 
+     finish is called by every thread after its last element.
+   */
+  template <typename TFUNC, typename TFINISH>
+  inline void IterateElementsUncolored (const FESpace & fes, 
+                                        VorB vb, 
+                                        LocalHeap & clh, 
+                                        const TFUNC & func,
+                                        const TFINISH & finish)
+  {
+    int ne = fes.GetMeshAccess()->GetNE(vb);
+
+#pragma omp parallel 
+    {
+      LocalHeap lh = clh.Split();
+      Array<int> temp_dnums;
+
+#pragma omp for schedule(dynamic, 64) nowait
+      for (int i = 0; i < ne; i++)
+        {
+          ElementId ei(vb, i);
+          if (!fes.DefinedOn (ei)) continue;
+
+          HeapReset hr(lh);
+          FESpace::Element el(fes, ei, temp_dnums);
+          func (el, lh);
+        }
+
+      finish ();
+    }
+  }
+
+
 
   template <typename TFUNC>
   inline void IterateElementsInsideParallel (const FESpace & fes, 
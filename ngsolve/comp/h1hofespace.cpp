@@ -66,7 +66,7 @@ namespace ngcomp
 
   H1HighOrderFESpace ::  
   H1HighOrderFESpace (shared_ptr<MeshAccess> ama, const Flags & flags, bool parseflags)
-    : FESpace (ama, flags)
+    : FESpace (ama, flags), spaceflags(flags)
   {
     name = "H1HighOrderFESpace(h1ho)";
     // define h1ho flags
@@ -86,6 +86,7 @@ namespace ngcomp
     //  DefineNumListFlag("dom_order_max_z");
     DefineNumFlag("smoothing");
     DefineDefineFlag("wb_withedges");
+    DefineDefineFlag("renumber");
     if (parseflags) CheckFlags(flags);
 
     wb_loedge = ma->GetDimension() == 3;
@@ -126,6 +127,7 @@ namespace ngcomp
     if (flags.NumFlagDefined("smoothing")) 
       throw Exception ("Flag 'smoothing' for fespace is obsolete \n Please use flag 'blocktype' in preconditioner instead");
     nodalp2 = flags.GetDefineFlag ("nodalp2");
+    renumber = flags.GetDefineFlag ("renumber");
           
     Flags loflags;
     loflags.SetFlag ("order", 1);
@@ -370,6 +372,81 @@ namespace ngcomp
   }
 
 
+  /*
+    Reverse Cuthill-McKee ordering of the volume elements, 
+    neighbours share a facet.
+  */
+  static void CalcElementRCMOrdering (const MeshAccess & ma, Array<int> & order)
+  {
+    static Timer timer ("H1HighOrderFESpace - RCM ordering");
+    RegionTimer reg (timer);
+
+    int ne = ma.GetNE();
+    Array<int> degree(ne);
+
+#pragma omp parallel
+    {
+      Array<int> fnums, elnums;
+#pragma omp for
+      for (int i = 0; i < ne; i++)
+        {
+          ma.GetElFacets (i, fnums);
+          degree[i] = 0;
+          for (int f : fnums)
+            {
+              ma.GetFacetElements (f, elnums);
+              degree[i] += elnums.Size()-1;
+            }
+        }
+    }
+
+    order.SetSize (0);
+    BitArray visited(ne);
+    visited.Clear();
+
+    Array<int> fnums, elnums, neighbours;
+    int firstfree = 0;
+    while (order.Size() < ne)
+      {
+        // start new component from an element of minimal degree
+        while (visited.Test(firstfree)) firstfree++;
+        int start = firstfree;
+        for (int i = firstfree; i < ne; i++)
+          if (!visited.Test(i) && degree[i] < degree[start])
+            start = i;
+
+        int first = order.Size();
+        order.Append (start);
+        visited.Set (start);
+
+        for (int k = first; k < order.Size(); k++)
+          {
+            ma.GetElFacets (order[k], fnums);
+            neighbours.SetSize (0);
+            for (int f : fnums)
+              {
+                ma.GetFacetElements (f, elnums);
+                for (int el : elnums)
+                  if (!visited.Test(el))
+                    {
+                      visited.Set (el);
+                      neighbours.Append (el);
+                    }
+              }
+
+            // neighbours by increasing degree
+            for (int i = 1; i < neighbours.Size(); i++)
+              for (int j = i; j > 0 && degree[neighbours[j]] < degree[neighbours[j-1]]; j--)
+                Swap (neighbours[j], neighbours[j-1]);
+            order += neighbours;
+          }
+      }
+
+    for (int i = 0, j = ne-1; i < j; i++, j--)
+      Swap (order[i], order[j]);
+  }
+
+
   void H1HighOrderFESpace :: UpdateDofTables ()
   {
     int dim = ma->GetDimension();
@@ -378,79 +455,141 @@ namespace ngcomp
     int nfa = (dim <= 2) ? 0 : ma->GetNFaces();
     int ne = ma->GetNE();
 
-    int hndof = nv;
+    Array<int> ndof_edge(ned), ndof_face(nfa), ndof_inner(ne);
 
-    first_edge_dof.SetSize (ned+1);
     for (auto i : Range (ned))
-      {
-	first_edge_dof[i] = hndof;
-	if (order_edge[i] > 1)
-	  hndof += order_edge[i] - 1;
-      }
-    first_edge_dof[ned] = hndof;
+      ndof_edge[i] = (order_edge[i] > 1) ? order_edge[i] - 1 : 0;
 
-    first_face_dof.SetSize (nfa+1);
     for (auto i : Range (nfa))
       {
-	first_face_dof[i] = hndof;
 	INT<2> p = order_face[i];
+        ndof_face[i] = 0;
 	switch(ma->GetFacetType(i))
 	  {
 	  case ET_TRIG:
             if (p[0] > 2)
-              hndof += (p[0]-1)*(p[0]-2)/2;
+              ndof_face[i] = (p[0]-1)*(p[0]-2)/2;
 	    break;
 	  case ET_QUAD:
 	    if (p[0] > 1 && p[1] > 1)
-	      hndof += (p[0]-1)*(p[1]-1);
+	      ndof_face[i] = (p[0]-1)*(p[1]-1);
 	    break; 
 	  default:
             ;
 	  }
       }
-    first_face_dof[nfa] = hndof;
- 
-    first_element_dof.SetSize(ne+1);
+
     for (auto i : Range(ne))
       {
-	first_element_dof[i] = hndof;
 	INT<3> p = order_inner[i];	
+        ndof_inner[i] = 0;
 	switch (ma->GetElType(i))
 	  {
 	  case ET_TRIG:
 	    if(p[0] > 2)
-	      hndof += (p[0]-1)*(p[0]-2)/2;
+	      ndof_inner[i] = (p[0]-1)*(p[0]-2)/2;
 	    break;
 	  case ET_QUAD:
 	    if(p[0] > 1 && p[1] > 1)
-	      hndof += (p[0]-1)*(p[1]-1);
+	      ndof_inner[i] = (p[0]-1)*(p[1]-1);
 	    break;
 	  case ET_TET:
 	    if(p[0] > 3)
-	      hndof += (p[0]-1)*(p[0]-2)*(p[0]-3)/6;
+	      ndof_inner[i] = (p[0]-1)*(p[0]-2)*(p[0]-3)/6;
 	    break;
 	  case ET_PRISM:
 	    if(p[0] > 2 && p[2] > 1)
-	      hndof += (p[0]-1)*(p[0]-2)*(p[2]-1)/2;
+	      ndof_inner[i] = (p[0]-1)*(p[0]-2)*(p[2]-1)/2;
 	    break;
 	  case ET_PYRAMID:
 	    if(p[0] > 2)
-	      hndof += (p[0]-1)*(p[0]-2)*(2*p[0]-3)/6;
+	      ndof_inner[i] = (p[0]-1)*(p[0]-2)*(2*p[0]-3)/6;
 	    break;
 	  case ET_HEX:
 	    if(p[0] > 1 && p[1] > 1 && p[2] > 1) 
-	      hndof += (p[0]-1)*(p[1]-1)*(p[2]-1);
+	      ndof_inner[i] = (p[0]-1)*(p[1]-1)*(p[2]-1);
 	    break;
           case ET_SEGM:
             if (p[0] > 1)
-	      hndof += p[0]-1;
+	      ndof_inner[i] = p[0]-1;
             break;
           case ET_POINT:
 	    break;
 	  }
       } 
-    first_element_dof[ne] = hndof;
+
+    first_edge_dof.SetSize (ned);
+    first_face_dof.SetSize (nfa);
+    first_element_dof.SetSize (ne);
+    first_edge_dof = -1;
+    first_face_dof = -1;
+    first_element_dof = -1;
+
+    // vertex dofs are the vertex numbers, for the low order space
+    int hndof = nv;
+
+    if (renumber)
+      {
+        // the edge, face and cell dofs of an element are numbered 
+        // consecutively, elements in reverse Cuthill-McKee order
+        Array<int> elorder;
+        CalcElementRCMOrdering (*ma, elorder);
+
+        for (int el : elorder)
+          {
+            Ngs_Element ngel = ma->GetElement(el);
+            if (dim >= 2)
+              for (int ed : ngel.Edges())
+                if (first_edge_dof[ed] == -1)
+                  {
+                    first_edge_dof[ed] = hndof;
+                    hndof += ndof_edge[ed];
+                  }
+            if (dim == 3)
+              for (int fa : ngel.Faces())
+                if (first_face_dof[fa] == -1)
+                  {
+                    first_face_dof[fa] = hndof;
+                    hndof += ndof_face[fa];
+                  }
+            first_element_dof[el] = hndof;
+            hndof += ndof_inner[el];
+          }
+      }
+
+    // standard numbering: edges, faces, cells, by node number
+    for (auto i : Range (ned))
+      if (first_edge_dof[i] == -1)
+        {
+          first_edge_dof[i] = hndof;
+          hndof += ndof_edge[i];
+        }
+
+    for (auto i : Range (nfa))
+      if (first_face_dof[i] == -1)
+        {
+          first_face_dof[i] = hndof;
+          hndof += ndof_face[i];
+        }
+
+    for (auto i : Range (ne))
+      if (first_element_dof[i] == -1)
+        {
+          first_element_dof[i] = hndof;
+          hndof += ndof_inner[i];
+        }
+
     ndof = hndof;
+
+    next_edge_dof.SetSize (ned);
+    next_face_dof.SetSize (nfa);
+    next_element_dof.SetSize (ne);
+    for (auto i : Range (ned))
+      next_edge_dof[i] = first_edge_dof[i] + ndof_edge[i];
+    for (auto i : Range (nfa))
+      next_face_dof[i] = first_face_dof[i] + ndof_face[i];
+    for (auto i : Range (ne))
+      next_element_dof[i] = first_element_dof[i] + ndof_inner[i];
    
 
     if (print)
@@ -712,6 +851,25 @@ namespace ngcomp
   }
 
 
+  shared_ptr<H1HighOrderFESpace> H1HighOrderFESpace :: 
+  CreateLowerOrderSpace (int aorder, LocalHeap & lh) const
+  {
+    if (var_order || aorder > order)
+      throw Exception ("H1HighOrderFESpace::CreateLowerOrderSpace: needs uniform order >= the requested one");
+
+    Flags loflags (spaceflags);
+    loflags.SetFlag ("order", aorder);
+    for (string name : { "orderinner", "orderface", "orderedge", "orderquad", "ordertrig" })
+      if (loflags.NumFlagDefined (name))
+        loflags.SetFlag (name, min2 (double(aorder), loflags.GetNumFlag (name, aorder)));
+
+    auto fes = make_shared<H1HighOrderFESpace> (ma, loflags);
+    fes -> Update (lh);
+    fes -> FinalizeUpdate (lh);
+    return fes;
+  }
+
+
   void H1HighOrderFESpace :: GetDofNrs (int elnr, Array<int> & dnums) const
   {
     Ngs_Element ngel = ma->GetElement(elnr);
@@ -1196,7 +1354,7 @@ namespace ngcomp
 	    for (int i = 0; i < ned; i++)
 	      {
 		int first = first_edge_dof[i] + ds_order - 1;
-		int ndof = first_edge_dof[i+1]-first;
+		int ndof = next_edge_dof[i]-first;
 		for (int j = 0; j < ndof; j++)
 		  creator.Add (i, first+j);
 	      }
@@ -1268,7 +1426,7 @@ namespace ngcomp
 	for (int i = 0; i < ned; i++)
 	  {
 	    int first = first_edge_dof[i];
-	    int next = first_edge_dof[i+1];
+	    int next = next_edge_dof[i];
 	    for (int j = 0; (j+2 <= ds_order) && (first+j < next) ; j++)
 	      clusters[first+j] = 1;
 	  }
@@ -1410,17 +1568,17 @@ namespace ngcomp
 
     for (int i = 0; i<directedgeclusters.Size(); i++)
       if(directedgeclusters[i] >= 0)
-	for(int j = first_edge_dof[i]; j<first_edge_dof[i+1]; j++)
+	for(int j = first_edge_dof[i]; j<next_edge_dof[i]; j++)
 	  clusters[j] = directedgeclusters[i] + stdoffset;
 
     for (int i = 0; i<directfaceclusters.Size(); i++)
       if(directfaceclusters[i] >= 0)
-	for(int j = first_face_dof[i]; j<first_face_dof[i+1]; j++)
+	for(int j = first_face_dof[i]; j<next_face_dof[i]; j++)
 	  clusters[j] = directfaceclusters[i] + stdoffset;
 	  
     for (int i = 0; i<directelementclusters.Size(); i++)
       if(directelementclusters[i] >= 0)
-	for(int j = first_element_dof[i]; j<first_element_dof[i+1]; j++)
+	for(int j = first_element_dof[i]; j<next_element_dof[i]; j++)
 	  clusters[j] = directelementclusters[i] + stdoffset;
 
 
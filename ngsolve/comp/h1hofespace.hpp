@@ -21,9 +21,13 @@ namespace ngcomp
   protected:
     int level;
 
+    /// dofs of edge/face/cell i are first_x_dof[i] <= dof < next_x_dof[i]
     Array<int> first_edge_dof;
     Array<int> first_face_dof;
     Array<int> first_element_dof;
+    Array<int> next_edge_dof;
+    Array<int> next_face_dof;
+    Array<int> next_element_dof;
 
     // typedef short TORDER;
     typedef unsigned char TORDER;
@@ -54,6 +58,10 @@ namespace ngcomp
 
     bool level_adapted_order; 
     bool nodalp2;
+    /// number high order dofs element by element, in reverse Cuthill-McKee order 
+    bool renumber;
+    /// flags of the space, used for the spaces of lower order
+    Flags spaceflags;
   public:
 
     H1HighOrderFESpace (shared_ptr<MeshAccess> ama, const Flags & flags, bool checkflags=false);
@@ -101,6 +109,13 @@ namespace ngcomp
     ///
     virtual Array<int> * CreateDirectSolverClusters (const Flags & flags) const;
 
+    /**
+       The same space with uniform order aorder <= order, updated for the
+       current mesh. With the hierarchical basis it is a subspace of this
+       space, e.g. for the coarse levels of p-multigrid.
+     */
+    shared_ptr<H1HighOrderFESpace> CreateLowerOrderSpace (int aorder, LocalHeap & lh) const;
+
     void UpdateDofTables ();
     ///
     virtual void UpdateCouplingDofArray();    
@@ -115,17 +130,17 @@ namespace ngcomp
 
     IntRange GetEdgeDofs (int nr) const
     {
-      return IntRange (first_edge_dof[nr], first_edge_dof[nr+1]);
+      return IntRange (first_edge_dof[nr], next_edge_dof[nr]);
     }
 
     IntRange GetFaceDofs (int nr) const
     {
-      return IntRange (first_face_dof[nr], first_face_dof[nr+1]);
+      return IntRange (first_face_dof[nr], next_face_dof[nr]);
     }
 
     IntRange GetElementDofs (int nr) const
     {
-      return IntRange (first_element_dof[nr], first_element_dof[nr+1]);
+      return IntRange (first_element_dof[nr], next_element_dof[nr]);
     }
 
   };
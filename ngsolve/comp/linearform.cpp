@@ -288,77 +288,83 @@ namespace ngcomp
 	}
 	if(hasskeletonbound)
 	{
+          // boundary facets are assembled together with their volume element,
+          // elements of one colour share no dofs
+          Array<int> sel2el(nse), sel2facnr(nse);
 #pragma omp parallel
-	  {
-	    LocalHeap lh = clh.Split();
-	    Array<int> dnums;
-	    Array<int> fnums, elnums, vnums;
-	    //Schleife fuer Facet-Integrators: 
-#pragma omp for	      
-	      for (int i = 0; i < nse; i++)
-		{
-#pragma omp critical (linformsurfneighprint)		    
-		  {
-		    gcnt++;
-		    if (i % 10 == 0)
-		      cout << "\rassemble facet surface element " << i << "/" << nse << flush;
-		    ma->SetThreadPercentage ( 100.0*(gcnt) / (loopsteps) );
-		  }
-
-		  HeapReset hr(lh);
-		  
-		  
-		  ma->GetSElFacets(i,fnums);
-		  int fac = fnums[0];
-		  ma->GetFacetElements(fac,elnums);
-		  int el = elnums[0];
-		  ma->GetElFacets(el,fnums);
-		  int facnr = 0;
-		  for (int k=0; k<fnums.Size(); k++)
-		    if(fac==fnums[k]) facnr = k;
-		  
-		  const FiniteElement & fel = fespace->GetFE (el, lh);
-		
-		  ElementTransformation & eltrans = ma->GetTrafo (el, false, lh);
-		  ElementTransformation & seltrans = ma->GetTrafo (i, true, lh);
+          {
+            Array<int> fnums, elnums;
+#pragma omp for
+            for (int i = 0; i < nse; i++)
+              {
+                ma->GetSElFacets(i,fnums);
+                int fac = fnums[0];
+                ma->GetFacetElements(fac,elnums);
+                sel2el[i] = elnums[0];
+                ma->GetElFacets(elnums[0],fnums);
+                sel2facnr[i] = max2 (fnums.Pos(fac), 0);
+              }
+          }
 
-		  fespace->GetDofNrs (el, dnums);
-		  ma->GetElVertices (el, vnums);		
+          Array<int> cnt(ne);
+          cnt = 0;
+          for (int i = 0; i < nse; i++)
+            cnt[sel2el[i]]++;
+          Table<int> el2sel(cnt);
+          cnt = 0;
+          for (int i = 0; i < nse; i++)
+            el2sel[sel2el[i]][cnt[sel2el[i]]++] = i;
+
+          ProgressOutput progress (ma, "assemble facet surface element", nse);
+          gcnt += nse;
+
+	  IterateElements 
+            (*fespace, VOL, clh, 
+             [&] (FESpace::Element el, LocalHeap & lh)
+             {
+               if (el2sel[el.Nr()].Size() == 0) return;
+
+               const FiniteElement & fel = fespace->GetFE (el, lh);
+               ElementTransformation & eltrans = ma->GetTrafo (el, lh);
+               FlatArray<int> dnums = el.GetDofs();
+               FlatArray<int> vnums(el.Vertices().Size(), lh);
+               for (int k = 0; k < vnums.Size(); k++)
+                 vnums[k] = el.Vertices()[k];
+
+               for (int i : el2sel[el.Nr()])
+                 {
+                   progress.Update ();
+                   HeapReset hr(lh);
+                   ElementTransformation & seltrans = ma->GetTrafo (i, true, lh);
 	      
-		  for (int j = 0; j < parts.Size(); j++)
-		    {
-		      if (!parts[j] -> SkeletonForm()) continue;
-		      if (!parts[j] -> BoundaryForm()) continue;
-		      if (!parts[j] -> DefinedOn (ma->GetSElIndex (i))) continue;
-		      if (parts[j] -> IntegrationAlongCurve()) continue;		    
+                   for (int j = 0; j < parts.Size(); j++)
+                     {
+                       if (!parts[j] -> SkeletonForm()) continue;
+                       if (!parts[j] -> BoundaryForm()) continue;
+                       if (!parts[j] -> DefinedOn (ma->GetSElIndex (i))) continue;
+                       if (parts[j] -> IntegrationAlongCurve()) continue;		    
 		  
-		      int elvec_size = dnums.Size()*fespace->GetDimension();
-		      FlatVector<TSCAL> elvec(elvec_size, lh);
-		      dynamic_cast<const FacetLinearFormIntegrator*>(parts[j].get()) 
-			  -> CalcFacetVector (fel,facnr,eltrans,vnums,seltrans, elvec, lh);
-		      if (printelvec)
-			{
-			  testout->precision(8);
-
-			  (*testout) << "surface-elnum= " << i << endl;
-			  (*testout) << "integrator " << parts[j]->Name() << endl;
-			  (*testout) << "dnums = " << endl << dnums << endl;
-			  (*testout) << "(vol)element-index = " << eltrans.GetElementIndex() << endl;
-			  (*testout) << "elvec = " << endl << elvec << endl;
-			}
-
-
-		      fespace->TransformVec (i, false, elvec, TRANSFORM_RHS);
-		    
-#pragma omp critical (addelvec3)		    
-		      {
-			AddElementVector (dnums, elvec, parts[j]->CacheComp()-1);
-		      }
-		    }
-		}
-		
-	  }//end of parallel
-	  cout << "\rassemble facet surface element  " << nse << "/" << nse << endl;	  
+                       int elvec_size = dnums.Size()*fespace->GetDimension();
+                       FlatVector<TSCAL> elvec(elvec_size, lh);
+                       dynamic_cast<const FacetLinearFormIntegrator*>(parts[j].get()) 
+                         -> CalcFacetVector (fel,sel2facnr[i],eltrans,vnums,seltrans, elvec, lh);
+                       if (printelvec)
+                         {
+                           testout->precision(8);
+
+                           (*testout) << "surface-elnum= " << i << endl;
+                           (*testout) << "integrator " << parts[j]->Name() << endl;
+                           (*testout) << "dnums = " << endl << dnums << endl;
+                           (*testout) << "(vol)element-index = " << eltrans.GetElementIndex() << endl;
+                           (*testout) << "elvec = " << endl << elvec << endl;
+                         }
+
+                       fespace->TransformVec (el, elvec, TRANSFORM_RHS);
+                       AddElementVector (dnums, elvec, parts[j]->CacheComp()-1);
+                     }
+                 }
+             });
+          progress.Done();
 	}//endof hasskeletonbound
 
 
@@ -526,6 +532,111 @@ namespace ngcomp
 
 
 
+  template <class SCAL>
+  void S_LinearForm<SCAL> :: AssembleBatch (FlatArray<S_LinearForm<SCAL>*> lfs, LocalHeap & clh)
+  {
+    static Timer timer("Vector assembling - batch");
+    RegionTimer reg (timer);
+
+    if (lfs.Size() == 0) return;
+    shared_ptr<FESpace> fespace = lfs[0]->GetFESpace();
+    auto ma = fespace->GetMeshAccess();
+
+    // forms with facet or curve integrators go the usual way
+    Array<S_LinearForm<SCAL>*> batch;
+    for (auto lf : lfs)
+      {
+        bool simple = !lf->independent && lf->GetFESpace() == fespace;
+        for (auto lfi : lf->parts)
+          if (lfi->SkeletonForm() || lfi->IntegrationAlongCurve())
+            simple = false;
+
+        if (simple)
+          batch.Append (lf);
+        else
+          lf->Assemble (clh);
+      }
+    
+    for (auto lf : batch)
+      {
+        lf->assembled = true;
+        if (!lf->allocated || lf->GetVector().Size() != fespace->GetNDof())
+          {
+            lf->AllocateVector();
+            lf->allocated = true;
+          }
+        else
+          lf->GetVector() = SCAL(0);
+      }
+
+    for (VorB vb : { VOL, BND })
+      {
+        ProgressOutput progress (ma, (vb == VOL) ? "assemble element" : "assemble surface element", 
+                                 ma->GetNE(vb));
+
+        IterateElements 
+          (*fespace, vb, clh, 
+           [&] (FESpace::Element el, LocalHeap & lh)
+           {
+             progress.Update ();
+
+             const FiniteElement & fel = fespace->GetFE(el, lh);
+             ElementTransformation & eltrans = ma->GetTrafo (el, lh);
+             int elvec_size = fel.GetNDof()*fespace->GetDimension();
+
+             for (auto lf : batch)
+               for (auto lfi : lf->parts)
+                 {
+                   if (lfi -> BoundaryForm() != (vb == BND)) continue;
+                   if (!lfi -> DefinedOn (el.GetIndex())) continue;
+                   
+                   HeapReset hr(lh);
+                   FlatVector<SCAL> elvec(elvec_size, lh);
+                   lfi -> CalcElementVector (fel, eltrans, elvec, lh);
+                   fespace->TransformVec (el, elvec, TRANSFORM_RHS);
+                   lf->AddElementVector (el.GetDofs(), elvec, lfi->CacheComp()-1);
+                 }
+           });
+        
+        progress.Done();
+      }
+
+    for (auto lf : batch)
+      {
+        if (lf->print)
+          {
+            (*testout) << "Linearform " << lf->GetName() << ": " << endl;
+            (*testout) << lf->GetVector() << endl;
+          }
+
+        if (lf->checksum)
+          cout << "|vector| = " 
+               << setprecision(16) << L2Norm (lf->GetVector()) << endl;
+      }
+  }
+
+
+  void AssembleLinearForms (FlatArray<shared_ptr<LinearForm>> lfs, LocalHeap & lh)
+  {
+    Array<S_LinearForm<double>*> lfsd;
+    Array<S_LinearForm<Complex>*> lfsc;
+
+    for (auto lf : lfs)
+      {
+        if (auto lfd = dynamic_pointer_cast<S_LinearForm<double>> (lf))
+          lfsd.Append (lfd.get());
+        else if (auto lfc = dynamic_pointer_cast<S_LinearForm<Complex>> (lf))
+          lfsc.Append (lfc.get());
+        else
+          lf->Assemble (lh);
+      }
+
+    S_LinearForm<double>::AssembleBatch (lfsd, lh);
+    S_LinearForm<Complex>::AssembleBatch (lfsc, lh);
+  }
+
+
+
   void LinearForm :: AddElementVector (FlatArray<int> dnums,
 				       FlatVector<double> elvec,
 				       int cachecomp)
@@ -149,6 +149,14 @@ namespace ngcomp
     ///
     virtual void Assemble (LocalHeap lh);
     void AssembleIndependent (LocalHeap lh);
+
+    /**
+       Assembles several linear forms on the same space in one pass 
+       over the elements. Finite elements, transformations and dofs are 
+       computed once per element for all forms. Forms with skeleton or 
+       curve integrators are assembled separately.
+    */
+    static void AssembleBatch (FlatArray<S_LinearForm<SCAL>*> lfs, LocalHeap & lh);
   };
 
 
@@ -202,6 +210,10 @@ namespace ngcomp
                                                                  const string & name,
                                                                  const Flags & flags);
 
+  /// batched assembling of right hand sides, e.g. for several load cases
+  extern NGS_DLL_HEADER void AssembleLinearForms (FlatArray<shared_ptr<LinearForm>> lfs,
+                                                  LocalHeap & lh);
+
 }
 
 #endif
@@ -952,6 +952,14 @@ namespace ngcomp
   void PDE :: AddCoefficientFunction (const string & name, shared_ptr<CoefficientFunction> fun)
   {
     cout << IM(2) << "add coefficient-function, name = " << name << endl;
+
+    // define constant compilecoefficients = 1
+    if (GetConstant ("compilecoefficients", true))
+      {
+        auto dvcf = dynamic_pointer_cast<DomainVariableCoefficientFunction> (fun);
+        if (dvcf) dvcf -> Compile (true);
+      }
+
     coefficients.Set (name.c_str(), fun);
   }
 
@@ -0,0 +1,480 @@
+/*********************************************************************/
+/* File:   pmultigrid.cpp                                            */
+/*********************************************************************/
+
+/*
+   p-version multigrid for high order H1 spaces
+*/
+
+#include <comp.hpp>
+#include <solve.hpp>
+
+
+namespace ngcomp
+{
+
+  /*
+    the embedding of the coarse element space. For the hierarchical
+    basis every coarse shape function is (up to the sign) a fine one,
+    and the embedding is an injection. Otherwise the L2 projection
+    prol = M_ff^{-1} M_fc is used.
+  */
+  template <int D>
+  static void LocalEmbedding (const FiniteElement & ffe, const FiniteElement & cfe,
+                              FlatMatrix<> prol, LocalHeap & lh)
+  {
+    HeapReset hr(lh);
+    const ScalarFiniteElement<D> & fel = static_cast<const ScalarFiniteElement<D>&> (ffe);
+    const ScalarFiniteElement<D> & cel = static_cast<const ScalarFiniteElement<D>&> (cfe);
+    int nf = fel.GetNDof(), nc = cel.GetNDof();
+
+    const IntegrationRule & ir = SelectIntegrationRule (fel.ElementType(), 2*fel.Order());
+    FlatMatrix<> fshape(nf, ir.Size(), lh), cshape(nc, ir.Size(), lh);
+    fel.CalcShape (ir, fshape);
+    cel.CalcShape (ir, cshape);
+
+    prol = 0.0;
+    bool hierarchical = true;
+    for (int j = 0; j < nc && hierarchical; j++)
+      {
+        double tol = 1e-10 * L2Norm (cshape.Row(j));
+        hierarchical = false;
+        for (int i = 0; i < nf && !hierarchical; i++)
+          for (double sign : { 1.0, -1.0 })
+            if (L2Norm (fshape.Row(i) - sign * cshape.Row(j)) < tol)
+              {
+                prol(i,j) = sign;
+                hierarchical = true;
+                break;
+              }
+      }
+    if (hierarchical) return;
+
+    // the mass matrix is ill-conditioned for high orders, rounding noise is dropped below
+    FlatMatrix<> wfshape(nf, ir.Size(), lh);
+    for (int j = 0; j < ir.Size(); j++)
+      wfshape.Col(j) = ir[j].Weight() * fshape.Col(j);
+
+    FlatMatrix<> mff(nf, nf, lh), mfc(nf, nc, lh);
+    mff = wfshape * Trans (fshape);
+    mfc = wfshape * Trans (cshape);
+    CalcInverse (mff);
+    prol = mff * mfc;
+  }
+
+
+  /*
+    The local embeddings of all elements. The shape functions depend on
+    the element only through its type, its orders and the ordering of
+    its vertex numbers, so the embedding is computed once per class of
+    elements with the same element type, numbers of fine and coarse dofs
+    and vertex orientation.
+  */
+  class EmbeddingClasses
+  {
+  public:
+    /// class of the element, -1 if the fine space is not defined on it
+    Array<int> elclass;
+    /// embedding per class
+    Array<shared_ptr<Matrix<>>> embedding;
+
+    EmbeddingClasses (const FESpace & fine, const FESpace & coarse, LocalHeap & lh)
+    {
+      static Timer t("p-multigrid - local embeddings");
+      RegionTimer reg(t);
+
+      auto ma = fine.GetMeshAccess();
+      int ne = ma->GetNE(VOL);
+      elclass.SetSize (ne);
+
+      HashTable<INT<4>, int> classes(1024);
+      Array<int> representative;
+      Array<int> fdnums, cdnums;
+      for (int i = 0; i < ne; i++)
+        {
+          ElementId ei(VOL, i);
+          elclass[i] = -1;
+          if (!fine.DefinedOn (ei)) continue;
+
+          fine.GetDofNrs (ei, fdnums);
+          coarse.GetDofNrs (ei, cdnums);
+          auto vnums = ma->GetElement(ei).Vertices();
+          int orientation = 0;
+          for (int j = 0; j < vnums.Size(); j++)
+            {
+              int rank = 0;
+              for (int k = 0; k < vnums.Size(); k++)
+                if (vnums[k] < vnums[j]) rank++;
+              orientation = vnums.Size() * orientation + rank;
+            }
+
+          INT<4> key (ma->GetElType(ei), orientation, fdnums.Size(), cdnums.Size());
+          if (!classes.Used (key))
+            {
+              classes.Set (key, representative.Size());
+              representative.Append (i);
+            }
+          elclass[i] = classes.Get (key);
+        }
+
+      int dim = ma->GetDimension();
+      embedding.SetSize (representative.Size());
+      for (int c = 0; c < representative.Size(); c++)
+        {
+          HeapReset hr(lh);
+          ElementId ei(VOL, representative[c]);
+          const FiniteElement & ffe = fine.GetFE (ei, lh);
+          const FiniteElement & cfe = coarse.GetFE (ei, lh);
+          embedding[c] = make_shared<Matrix<>> (ffe.GetNDof(), cfe.GetNDof());
+          switch (dim)
+            {
+            case 1: LocalEmbedding<1> (ffe, cfe, *embedding[c], lh); break;
+            case 2: LocalEmbedding<2> (ffe, cfe, *embedding[c], lh); break;
+            case 3: LocalEmbedding<3> (ffe, cfe, *embedding[c], lh); break;
+            }
+        }
+      cout << IM(5) << "p-multigrid: " << embedding.Size() << " local embeddings for " 
+           << ne << " elements" << endl;
+    }
+
+    const Matrix<> & operator[] (int elnr) const { return *embedding[elclass[elnr]]; }
+  };
+
+
+  /*
+    Calls func (fine dof, coarse dofs, row of the local embedding) for
+    every free fine dof in its owner element. The owner is the first
+    element containing the dof, the coloured element loop makes this
+    race-free. Unless count is set, owner has to be known.
+  */
+  template <typename FUNC>
+  static void IterateEmbedding (const FESpace & fine, const FESpace & coarse,
+                                const EmbeddingClasses & embeddings,
+                                const BitArray * ffree, Array<int> & owner, bool count,
+                                LocalHeap & clh, FUNC func)
+  {
+    IterateElements 
+      (fine, VOL, clh, 
+       [&] (FESpace::Element el, LocalHeap & lh)
+       {
+         ElementId ei(VOL, el.Nr());
+         FlatArray<int> fdnums = el.GetDofs();
+         ArrayMem<int,100> cdnums;
+         coarse.GetDofNrs (ei, cdnums);
+
+         const Matrix<> & prol = embeddings[el.Nr()];
+
+         for (int i = 0; i < fdnums.Size(); i++)
+           {
+             int d = fdnums[i];
+             if (d == -1 || (ffree && !ffree->Test(d))) continue;
+             if (count)
+               {
+                 if (owner[d] != -1) continue;
+                 owner[d] = el.Nr();
+               }
+             else if (owner[d] != el.Nr()) continue;
+             func (d, FlatArray<int> (cdnums), prol.Row(i));
+           }
+       });
+  }
+
+  /**
+     The prolongation from the coarse to the fine space, assembled from
+     the element-local embeddings, the element spaces must be nested.
+     Rows of fine and columns of coarse dofs which are not free are
+     left empty.
+  */
+  static shared_ptr<SparseMatrix<double>>
+  CreateEmbeddingMatrix (const FESpace & fine, const FESpace & coarse,
+                         const BitArray * ffree, const BitArray * cfree,
+                         LocalHeap & lh)
+  {
+    static Timer t("p-multigrid - embedding matrix");
+    RegionTimer reg(t);
+
+    int nf = fine.GetNDof(), nc = coarse.GetNDof();
+    Array<int> owner(nf), cnt(nf);
+    owner = -1;
+    cnt = 0;
+
+    auto used = [cfree] (int cd, double val)
+      {
+        return cd != -1 && (!cfree || cfree->Test(cd)) && fabs(val) > 1e-8;
+      };
+
+    EmbeddingClasses embeddings (fine, coarse, lh);
+
+    IterateEmbedding (fine, coarse, embeddings, ffree, owner, true, lh,
+                      [&] (int d, FlatArray<int> cdnums, FlatVector<> row)
+                      {
+                        for (int j = 0; j < cdnums.Size(); j++)
+                          if (used (cdnums[j], row(j))) cnt[d]++;
+                      });
+
+    auto prol = make_shared<SparseMatrix<double>> (cnt, nc);
+
+    IterateEmbedding (fine, coarse, embeddings, ffree, owner, false, lh,
+                      [&] (int d, FlatArray<int> cdnums, FlatVector<> row)
+                      {
+                        ArrayMem<int,100> cols, index;
+                        for (int j = 0; j < cdnums.Size(); j++)
+                          if (used (cdnums[j], row(j)))
+                            {
+                              cols.Append (cdnums[j]);
+                              index.Append (j);
+                            }
+                        QuickSortI (cols, index);
+
+                        FlatVector<> rv = prol->GetRowValues(d);
+                        for (int j = 0; j < index.Size(); j++)
+                          {
+                            prol->CreatePosition (d, cols[index[j]]);
+                            rv(j) = row(index[j]);
+                          }
+                      });
+    return prol;
+  }
+
+
+
+
+  /**
+     p-version multigrid for H1HighOrderFESpace.
+
+     The spaces of order p, p/2, ..., 1 are nested, the prolongations are
+     assembled from the element-local embeddings, the coarse matrices
+     are Galerkin products. Every p-level is smoothed by point
+     Gauss-Seidel or damped Jacobi, the lowest order level is solved
+     directly or by the preconditioner given as 'coarseprecond', e.g.
+     h-multigrid for the low order bilinear form.
+
+     Flags:
+     -smoother=gs|jacobi, -smoothingsteps=n, -damping=w (jacobi),
+     -inverse=<type> (lowest order direct solver), -coarseprecond=<name>
+  */
+  class NGS_DLL_HEADER PMultigridPreconditioner : public Preconditioner
+  {
+    struct Level
+    {
+      /// the space of lower order, not set on the finest level
+      shared_ptr<H1HighOrderFESpace> fes;
+      shared_ptr<SparseMatrixTM<double>> ownmat;
+      const SparseMatrixTM<double> * mat;
+      const BitArray * freedofs;
+      /// transfer from the next coarser level
+      shared_ptr<SparseMatrix<double>> prol, restr;
+      shared_ptr<BaseJacobiPrecond> jacobi;
+    };
+
+    shared_ptr<BilinearForm> bfa;
+    shared_ptr<Preconditioner> coarse_pre;
+    Array<shared_ptr<Level>> levels;
+    shared_ptr<BaseMatrix> coarseinv;
+
+    string smoother;
+    int smoothingsteps;
+    double damping;
+    string inversetype;
+
+  public:
+    PMultigridPreconditioner (const PDE & pde, const Flags & aflags,
+                              const string aname = "pmgprecond")
+      : Preconditioner(&pde,aflags,aname)
+    {
+      bfa = pde.GetBilinearForm (flags.GetStringFlag ("bilinearform", NULL));
+      coarse_pre = pde.GetPreconditioner (flags.GetStringFlag ("coarseprecond", ""), 1);
+      SetFlags ();
+    }
+
+    PMultigridPreconditioner (shared_ptr<BilinearForm> abfa, const Flags & aflags,
+                              const string aname = "pmgprecond")
+      : Preconditioner(abfa,aflags,aname), bfa(abfa)
+    {
+      SetFlags ();
+    }
+
+    virtual void Update ();
+
+    virtual void CleanUpLevel ()
+    {
+      levels.SetSize (0);
+      coarseinv = nullptr;
+    }
+
+    virtual const BaseMatrix & GetAMatrix() const
+    {
+      return bfa->GetMatrix();
+    }
+
+    virtual int VHeight() const { return bfa->GetMatrix().Height(); }
+    virtual int VWidth() const { return bfa->GetMatrix().Width(); }
+
+    virtual AutoVector CreateVector () const
+    {
+      return bfa->GetMatrix().CreateVector();
+    }
+
+    virtual void Mult (const BaseVector & x, BaseVector & y) const
+    {
+      static Timer t("p-multigrid - apply");
+      RegionTimer reg(t);
+      MGM (0, y, x);
+    }
+
+    virtual void MemoryUsage (Array<MemoryUsageStruct*> & mu) const
+    {
+      size_t nze = 0;
+      for (auto & lev : levels)
+        {
+          if (lev->ownmat) nze += lev->ownmat->NZE();
+          if (lev->prol) nze += 2 * lev->prol->NZE();
+        }
+      mu.Append (new MemoryUsageStruct ("p-multigrid", nze*(sizeof(double)+sizeof(int)), levels.Size()));
+      if (coarseinv) coarseinv -> MemoryUsage (mu);
+    }
+
+    virtual const char * ClassName() const
+    {
+      return "p-Multigrid Preconditioner";
+    }
+
+  private:
+    void SetFlags ()
+    {
+      smoother = flags.GetStringFlag ("smoother", "gs");
+      smoothingsteps = int (flags.GetNumFlag ("smoothingsteps", 1));
+      damping = flags.GetNumFlag ("damping", 0.6);
+      inversetype = flags.GetStringFlag("inverse", GetInverseName (default_inversetype));
+      if (smoother != "gs" && smoother != "jacobi")
+        throw Exception ("PMultigridPreconditioner: unknown smoother '" + smoother + "'");
+    }
+
+    void Smooth (int level, BaseVector & x, const BaseVector & b, bool back) const;
+    void MGM (int level, BaseVector & x, const BaseVector & b) const;
+  };
+
+
+
+  void PMultigridPreconditioner :: Update ()
+  {
+    static Timer t("p-multigrid - setup");
+    RegionTimer reg(t);
+
+    auto fes = dynamic_pointer_cast<H1HighOrderFESpace> (bfa->GetFESpace());
+    if (!fes)
+      throw Exception ("PMultigridPreconditioner: needs an H1HighOrderFESpace");
+
+    auto mat = dynamic_cast<const SparseMatrixTM<double>*> (&bfa->GetMatrix());
+    if (!mat)
+      throw Exception ("PMultigridPreconditioner: needs a real, scalar sparse matrix");
+
+    bool elim = bfa->UsesEliminateInternal();
+    LocalHeap lh(10000000, "p-multigrid");
+
+    levels.SetSize (0);
+    auto fine = make_shared<Level> ();
+    fine->mat = mat;
+    fine->freedofs = fes->GetFreeDofs (elim);
+    levels.Append (fine);
+
+    const FESpace * finefes = fes.get();
+    for (int order = fes->GetOrder(); order > 1; )
+      {
+        order = max2 (order/2, 1);
+        const Level & fl = *levels.Last();
+        auto lev = make_shared<Level> ();
+        lev->fes = fes->CreateLowerOrderSpace (order, lh);
+        lev->freedofs = lev->fes->GetFreeDofs (elim);
+
+        lev->prol = CreateEmbeddingMatrix (*finefes, *lev->fes, fl.freedofs, lev->freedofs, lh);
+        lev->restr = TransposeMatrix (*lev->prol);
+        lev->ownmat = RAP (*lev->restr, *fl.mat, *lev->prol);
+        lev->mat = lev->ownmat.get();
+
+        cout << IM(3) << "p-multigrid level, order " << order << ", ndof = " << lev->fes->GetNDof() << endl;
+
+        finefes = lev->fes.get();
+        levels.Append (lev);
+      }
+
+    for (int l = 0; l < levels.Size()-1; l++)
+      levels[l]->jacobi = levels[l]->mat->CreateJacobiPrecond (levels[l]->freedofs);
+
+    const Level & coarse = *levels.Last();
+    if (coarse_pre)
+      {
+        if (coarse_pre->GetMatrix().Height() != coarse.mat->Height())
+          throw Exception ("PMultigridPreconditioner: coarseprecond does not fit to the lowest order space");
+        coarseinv = nullptr;
+      }
+    else
+      {
+        coarse.mat->SetInverseType (inversetype);
+        coarseinv = coarse.mat->InverseMatrix (coarse.freedofs);
+      }
+
+    if (test) Test();
+  }
+
+
+  void PMultigridPreconditioner ::
+  Smooth (int level, BaseVector & x, const BaseVector & b, bool back) const
+  {
+    static Timer t("p-multigrid - smooth");
+    RegionTimer reg(t);
+
+    const Level & lev = *levels[level];
+    if (smoother == "gs")
+      {
+        for (int k = 0; k < smoothingsteps; k++)
+          if (back)
+            lev.jacobi->GSSmoothBack (x, b);
+          else
+            lev.jacobi->GSSmooth (x, b);
+        return;
+      }
+
+    auto r = lev.mat->CreateVector();
+    for (int k = 0; k < smoothingsteps; k++)
+      {
+        r = b - (*lev.mat) * x;
+        lev.jacobi->MultAdd (damping, r, x);
+      }
+  }
+
+
+  void PMultigridPreconditioner ::
+  MGM (int level, BaseVector & x, const BaseVector & b) const
+  {
+    if (level == levels.Size()-1)
+      {
+        if (coarse_pre)
+          coarse_pre->Mult (b, x);
+        else
+          coarseinv->Mult (b, x);
+        return;
+      }
+
+    const Level & lev = *levels[level];
+    const Level & clev = *levels[level+1];
+
+    x = 0.0;
+    Smooth (level, x, b, false);
+
+    auto r = lev.mat->CreateVector();
+    auto xc = clev.mat->CreateVector();
+    auto bc = clev.mat->CreateVector();
+
+    r = b - (*lev.mat) * x;
+    clev.restr->Mult (r, bc);
+    MGM (level+1, xc, bc);
+    clev.prol->MultAdd (1, xc, x);
+
+    Smooth (level, x, b, true);
+  }
+
+
+
+  static RegisterPreconditioner<PMultigridPreconditioner> initpmg ("pmultigrid");
+}
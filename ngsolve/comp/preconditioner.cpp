@@ -244,6 +244,10 @@ namespace ngcomp
       {
 	sm = new AnisotropicSmoother (*ma, *lo_bfa);
       }
+    else if (smoothertype == "chebyshev")
+      {
+	sm = new ChebyshevSmoother (*ma, *lo_bfa, flags);
+      }
     else if (smoothertype == "block") 
       {
 	if (!lfconstraint)
@@ -272,6 +276,7 @@ namespace ngcomp
     mgp->SetIncreaseSmoothingSteps (int(flags.GetNumFlag ("increasesmoothingsteps", 1)));
     mgp->SetCoarseSmoothingSteps (int(flags.GetNumFlag ("coarsesmoothingsteps", 1)));
     mgp->SetUpdateAll( flags.GetDefineFlag( "updateall" ) );
+    mgp->SetExplicitProlongation( flags.GetDefineFlag( "prolmatrix" ) );
 
     MultigridPreconditioner::COARSETYPE ct = MultigridPreconditioner::EXACT_COARSE;
     const string & coarse = flags.GetStringFlag ("coarsetype", "direct");
@@ -340,6 +345,10 @@ namespace ngcomp
       {
 	sm = new AnisotropicSmoother (*ma, *lo_bfa);
       }
+    else if (smoothertype == "chebyshev")
+      {
+	sm = new ChebyshevSmoother (*ma, *lo_bfa, flags);
+      }
     else if (smoothertype == "block") 
       {
 	// if (!lfconstraint)
@@ -370,6 +379,7 @@ namespace ngcomp
     mgp->SetIncreaseSmoothingSteps (int(flags.GetNumFlag ("increasesmoothingsteps", 1)));
     mgp->SetCoarseSmoothingSteps (int(flags.GetNumFlag ("coarsesmoothingsteps", 1)));
     mgp->SetUpdateAll( flags.GetDefineFlag( "updateall" ) );
+    mgp->SetExplicitProlongation( flags.GetDefineFlag( "prolmatrix" ) );
 
     MultigridPreconditioner::COARSETYPE ct = MultigridPreconditioner::EXACT_COARSE;
     const string & coarse = flags.GetStringFlag ("coarsetype", "direct");
@@ -412,9 +422,9 @@ namespace ngcomp
     shared_ptr<BilinearForm> lo_bfa = bfa->GetLowOrderBilinearForm();
 
     INVERSETYPE invtype, loinvtype = default_inversetype;
-    invtype = dynamic_cast<const BaseSparseMatrix & > (bfa->GetMatrix()).SetInverseType (inversetype);
+    invtype = bfa->GetMatrix().SetInverseType (inversetype);
     if (lo_bfa)
-      loinvtype = dynamic_cast<const BaseSparseMatrix & > (lo_bfa->GetMatrix()) .SetInverseType (inversetype);
+      loinvtype = lo_bfa->GetMatrix().SetInverseType (inversetype);
 
 
     mgp->Update();
@@ -448,9 +458,9 @@ namespace ngcomp
     if (test) Test();
     if (mgtest) MgTest();
 
-    dynamic_cast<const BaseSparseMatrix & > (bfa->GetMatrix()).SetInverseType ( invtype );
+    bfa->GetMatrix().SetInverseType ( invtype );
     if (lo_bfa)
-      dynamic_cast<const BaseSparseMatrix & > (lo_bfa->GetMatrix()) .SetInverseType ( loinvtype );
+      lo_bfa->GetMatrix().SetInverseType ( loinvtype );
   }
   
   
@@ -609,6 +619,161 @@ namespace ngcomp
 
 
 
+  // ****************************** SAAMGPreconditioner **************************
+
+
+  /**
+     Smoothed aggregation AMG on the assembled matrix.
+     The near-nullspace is built from the vertex dofs: constant per
+     component, or rigid body modes with the flag "rigidbody".
+   */
+  class NGS_DLL_HEADER SAAMGPreconditioner : public Preconditioner
+  {
+    shared_ptr<BilinearForm> bfa;
+    shared_ptr<SmoothedAggregationAMG> amg;
+
+  public:
+    SAAMGPreconditioner (const PDE & pde, const Flags & aflags,
+                         const string aname = "saamgprecond")
+      : Preconditioner(&pde,aflags,aname)
+    {
+      bfa = pde.GetBilinearForm (flags.GetStringFlag ("bilinearform", NULL));
+    }
+
+    SAAMGPreconditioner (shared_ptr<BilinearForm> abfa, const Flags & aflags,
+                         const string aname = "saamgprecond")
+      : Preconditioner(abfa,aflags,aname), bfa(abfa)
+    { ; }
+
+    virtual void Update ()
+    {
+      static Timer t("SAAMGPreconditioner::Update");
+      RegionTimer reg(t);
+
+      auto fes = bfa->GetFESpace();
+      auto ma = fes->GetMeshAccess();
+      const BitArray * freedofs = fes->GetFreeDofs (bfa->UsesEliminateInternal());
+
+      const BaseSparseMatrix * mat = dynamic_cast<const BaseSparseMatrix*> (&bfa->GetMatrix());
+      if (!mat)
+        throw Exception ("SAAMGPreconditioner: needs a sparse matrix");
+
+      amg = make_shared<SmoothedAggregationAMG> (*mat, freedofs);
+      amg -> SetStrengthThreshold (flags.GetNumFlag ("theta", 0.08));
+      amg -> SetMaxLevels (int (flags.GetNumFlag ("levels", 20)));
+      amg -> SetMinCoarseSize (int (flags.GetNumFlag ("coarsesize", 500)));
+
+      string sm = flags.GetStringFlag ("smoother", "chebyshev");
+      int steps = int (flags.GetNumFlag ("smoothingsteps", 2));
+      if (sm == "jacobi")
+        amg -> SetSmoother (SmoothedAggregationAMG::JACOBI, steps);
+      else if (sm == "gs")
+        amg -> SetSmoother (SmoothedAggregationAMG::GAUSS_SEIDEL, steps);
+      else if (sm == "chebyshev")
+        amg -> SetSmoother (SmoothedAggregationAMG::CHEBYSHEV, steps);
+      else
+        throw Exception ("SAAMGPreconditioner: unknown smoother '" + sm + "'");
+
+      SetNearNullspace (*fes);
+      amg -> Setup();
+
+      if (test) Test();
+    }
+
+    virtual void CleanUpLevel ()
+    {
+      amg = nullptr;
+    }
+
+    virtual const BaseMatrix & GetMatrix() const
+    {
+      return *amg;
+    }
+
+    virtual const BaseMatrix & GetAMatrix() const
+    {
+      return bfa->GetMatrix(); 
+    }
+
+    virtual void MemoryUsage (Array<MemoryUsageStruct*> & mu) const
+    {
+      if (amg) amg -> MemoryUsage (mu);
+    }
+
+    virtual const char * ClassName() const
+    {
+      return "SAAMG Preconditioner"; 
+    }
+
+  private:
+    void SetNearNullspace (const FESpace & fes)
+    {
+      auto ma = fes.GetMeshAccess();
+      int bs = fes.GetDimension();
+      int ns = fes.GetNDof() * bs;
+      int nv = ma->GetNV();
+      int dim = ma->GetDimension();
+      bool rigidbody = flags.GetDefineFlag ("rigidbody");
+
+      // number of components: block entries, or vertex dofs of a compound space
+      Array<int> dnums;
+      int ncomp = bs;
+      bool hasvertexdofs = false;
+      for (int v = 0; v < nv; v++)
+        {
+          fes.GetVertexDofNrs (v, dnums);
+          if (dnums.Size()) hasvertexdofs = true;
+          if (bs == 1) ncomp = max2 (ncomp, dnums.Size());
+        }
+      if (!hasvertexdofs && !rigidbody) return;    // constant per component
+      if (!hasvertexdofs)
+        throw Exception ("SAAMGPreconditioner: rigid body modes need vertex dofs");
+      if (rigidbody && ncomp != dim)
+        throw Exception ("SAAMGPreconditioner: rigid body modes need one component per space dimension");
+
+      int k = rigidbody ? (dim == 2 ? 3 : 6) : ncomp;
+
+      // non-vertex dofs are single nodes, high order dofs do not
+      // contribute to low energy modes of a hierarchical basis
+      Array<int> dof2node(ns);
+      Array<double> nullspace(ns*k);
+      nullspace = 0.0;
+      for (int r = 0; r < ns; r++)
+        dof2node[r] = nv + r;
+
+      for (int v = 0; v < nv; v++)
+        {
+          fes.GetVertexDofNrs (v, dnums);
+          Vec<3> p = ma->GetPoint<3> (v);
+          for (int j = 0; j < dnums.Size(); j++)
+            for (int c = 0; c < bs; c++)
+              {
+                if (dnums[j] == -1) continue;
+                int r = dnums[j]*bs + c;
+                int comp = (bs > 1) ? c : j;
+                dof2node[r] = v;
+
+                FlatVector<double> b(k, &nullspace[r*k]);
+                b(comp) = 1;
+                if (rigidbody && dim == 2)
+                  b(2) = (comp == 0) ? -p(1) : p(0);
+                if (rigidbody && dim == 3)
+                  switch (comp)
+                    {
+                    case 0: b(4) = p(2); b(5) = -p(1); break;
+                    case 1: b(3) = -p(2); b(5) = p(0); break;
+                    case 2: b(3) = p(1); b(4) = -p(0); break;
+                    }
+              }
+        }
+
+      amg -> SetNearNullspace (dof2node, nullspace, k);
+    }
+  };
+
+
+
+
   // ****************************** LocalPreconditioner *******************************
 
 
@@ -1215,6 +1380,7 @@ ComplexPreconditioner :: ComplexPreconditioner (PDE * apde, const Flags & aflags
 
   RegisterPreconditioner<MGPreconditioner> registerMG("multigrid");
   RegisterPreconditioner<DirectPreconditioner> registerDirect("direct");
+  RegisterPreconditioner<SAAMGPreconditioner> registerSAAMG("saamg");
 
 }
 
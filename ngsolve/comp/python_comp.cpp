@@ -435,6 +435,12 @@ void NGS_DLL_HEADER ExportNgcomp()
                                      }),
          (bp::arg("self")=NULL,bp::arg("heapsize")=1000000))
 
+    .def("SetDirtyElement", &BilinearForm::SetDirtyElement,
+         "recompute the element matrix in the next incremental Assemble")
+    .def("SetDirtyDomain", &BilinearForm::SetDirtyDomain,
+         "recompute the element matrices on the sub-domain in the next incremental Assemble")
+    .def("SetAllDirty", &BilinearForm::SetAllDirty)
+
     .add_property("mat", static_cast<shared_ptr<BaseMatrix>(BilinearForm::*)()const> (&BilinearForm::GetMatrixPtr))
     .def("Energy", &BilinearForm::Energy)
     .def("Apply", &BilinearForm::ApplyMatrix)
@@ -478,6 +484,17 @@ void NGS_DLL_HEADER ExportNgcomp()
          (bp::arg("self")=NULL,bp::arg("heapsize")=1000000))
     ;
 
+  bp::def("AssembleLinearForms", FunctionPointer
+          ([](bp::list forms, int heapsize)
+           {
+             Array<shared_ptr<LinearForm>> lfs;
+             for (int i = 0; i < bp::len(forms); i++)
+               lfs.Append (bp::extract<shared_ptr<LinearForm>> (forms[i])());
+             LocalHeap lh (heapsize*omp_get_max_threads(), "AssembleLinearForms-heap");
+             AssembleLinearForms (lfs, lh);
+           }),
+          (bp::arg("forms"), bp::arg("heapsize")=1000000));
+
   //////////////////////////////////////////////////////////////////////////////////////////
 
   typedef Preconditioner PRE;
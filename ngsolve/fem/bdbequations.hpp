@@ -114,6 +114,23 @@ namespace ngfem
       y = Cast(fel).GetDShape(mip.IP(),lh) * hv;
     }
 
+    using DiffOp<DiffOpGradient<D, FEL> >::ApplyTransIR;
+
+    template <class MIR>
+    static void ApplyTransIR (const FiniteElement & fel, 
+			      const MIR & mir,
+			      FlatMatrix<double> x, FlatVector<double> y,
+			      LocalHeap & lh)
+    {
+      HeapReset hr(lh);
+      FlatMatrixFixWidth<D> grad(mir.Size(), lh);
+      for (int i = 0; i < mir.Size(); i++)
+        {
+          Vec<D> hv = x.Row(i);
+          grad.Row(i) = mir[i].GetJacobianInverse() * hv;
+        }
+      Cast(fel).EvaluateGradTrans (mir.IR(), grad, y);
+    }
   };
 
 
@@ -175,7 +175,15 @@ public:
   protected:
     DMATOP dmatop;
     DifferentialOperator * diffop = NULL;
+    /// all coefficients are constant per sub-domain
+    bool const_coefs = false;
     enum { DIM_DMAT    = DMATOP::DIM_DMAT };
+
+    static bool IsPiecewiseConstant (shared_ptr<CoefficientFunction> cf)
+    {
+      return dynamic_pointer_cast<ConstantCoefficientFunction> (cf) ||
+        dynamic_pointer_cast<DomainConstantCoefficientFunction> (cf);
+    }
     
   public:
   
@@ -212,6 +220,9 @@ public:
     DMATOP & DMat () { return dmatop; }
     const DMATOP & DMat () const { return dmatop; }
 
+    virtual bool PiecewiseConstantCoefficients () const
+    { return const_coefs || const_coef; }
+
     
     int GetIntegrationOrder (const FiniteElement & fel, 
                              const bool use_higher_integration_order = false) const
@@ -594,7 +605,14 @@ public:
   template <class DMATOP>
   T_BDBIntegrator_DMat<DMATOP>:: 
   T_BDBIntegrator_DMat  (const Array<shared_ptr<CoefficientFunction>> & coeffs)
-    : dmatop(coeffs) { ; }
+    : dmatop(coeffs) 
+  { 
+    const_coefs = coeffs.Size() > 0;
+    for (int i = 0; i < coeffs.Size(); i++)
+      if (!IsPiecewiseConstant (coeffs[i])) const_coefs = false;
+    for (int i = 0; i < coeffs.Size(); i++)
+      AddDependency (coeffs[i]);
+  }
     
   /*
   template <class DMATOP> template <typename ... TMORE>
@@ -659,6 +677,8 @@ public:
     : BASE(c1) 
   { 
     diffop = new T_DifferentialOperator<DIFFOP>; 
+    BASE::const_coefs = BASE::IsPiecewiseConstant (c1);
+    BASE::AddDependency (c1);
   }
 
   /*
@@ -696,7 +716,11 @@ public:
   */
 
   ///
-  virtual ~T_BDBIntegrator () { ; }
+  virtual ~T_BDBIntegrator () 
+  { 
+    for (int i = 0; i < nreftensors; i++)
+      delete reftensors[i];
+  }
 
   ///
   virtual int GetDimension () const { return DIM; }
@@ -738,6 +762,9 @@ public:
 		     FlatMatrix<double> elmat,
 		     LocalHeap & lh) const
   {
+    if (CalcElementMatrixRefTensor (bfel, eltrans, elmat, lh, 
+                                    integral_constant<bool, REFTENSOR_POSSIBLE>()))
+      return;
     T_CalcElementMatrix<double> (bfel, eltrans, elmat, lh);
   }
 
@@ -751,6 +778,285 @@ public:
   }
 
 
+protected:
+
+  /*
+    Reference tensor assembly for affine simplices and element-wise 
+    constant coefficients. The B-matrix is a constant linear combination
+    E of the physical gradients (or shape values for DIFFORDER = 0):
+      B(r, DIM*i+c) = sum_m E(r, c*NCH+m) g_m(phi_i)
+    thus the element matrix is the contraction of
+      K(i*ndof+j, a*NCH+b) = sum_q w_q ghat_a(phi_i) ghat_b(phi_j)
+    with the constant geometry and material factors.
+    E is extracted from DIFFOP once, K is stored per element type, 
+    integration order and shape-function orientation.
+  */
+
+  enum { REFTENSOR_POSSIBLE = 
+         int(DIM_ELEMENT) == int(DIM_SPACE) && DIFFOP::DIFFORDER <= 1 &&
+         is_base_of<ScalarFiniteElement<DIM_ELEMENT>, FEL>::value };
+  enum { NCH = (DIFFOP::DIFFORDER == 0) ? 1 : DIM_ELEMENT };
+  enum { MAX_REFTENSORS = 256 };
+
+  class RefTensor
+  {
+  public:
+    ELEMENT_TYPE et;
+    int order;
+    Vector<> fingerprint;
+    Matrix<> tensor;
+  };
+
+  /// 0 .. not checked yet, 1 .. available, -1 .. not applicable
+  mutable atomic<int> reftensor_state{0};
+  mutable Matrix<> ecoupling;
+  mutable RefTensor * reftensors[MAX_REFTENSORS] = { };
+  mutable atomic<int> nreftensors{0};
+
+  template <typename ENABLE>
+  bool CalcElementMatrixRefTensor (const FiniteElement & bfel,
+                                   const ElementTransformation & eltrans, 
+                                   FlatMatrix<double> elmat,
+                                   LocalHeap & lh, ENABLE) const
+  {
+    return false;
+  }
+
+  /// reference channels: shape values, or reference gradients
+  static void CalcRefTensorChannels (const ScalarFiniteElement<DIM_ELEMENT> & fel,
+                                     const IntegrationPoint & ip,
+                                     FlatMatrix<> gref, LocalHeap & lh)
+  {
+    HeapReset hr(lh);
+    if (DIFFOP::DIFFORDER == 0)
+      fel.CalcShape (ip, gref.Row(0));
+    else
+      {
+        FlatMatrix<> dshape(fel.GetNDof(), DIM_ELEMENT, lh);
+        fel.CalcDShape (ip, dshape);
+        for (int a = 0; a < NCH; a++)
+          gref.Row(a) = dshape.Col(a);
+      }
+  }
+
+  /// channel transformation, physical = sum_a trafo(a,m) reference_a
+  template <typename MIP>
+  static Mat<NCH,NCH> RefTensorTrafo (const MIP & mip)
+  {
+    Mat<NCH,NCH> trafo;
+    auto jinv = mip.GetJacobianInverse();
+    for (int a = 0; a < NCH; a++)
+      for (int m = 0; m < NCH; m++)
+        trafo(a,m) = (DIFFOP::DIFFORDER == 0) ? 1.0 : jinv(a,m);
+    return trafo;
+  }
+
+  /// fits the coupling matrix E on a first element, and verifies it
+  template <typename ENABLE = void>
+  bool FitRefTensorCoupling (const ScalarFiniteElement<DIM_ELEMENT> & fel,
+                             const ElementTransformation & eltrans, 
+                             LocalHeap & lh) const
+  {
+    HeapReset hr(lh);
+    const IntegrationRule & ir = SelectIntegrationRule (fel.ElementType(), 3);
+    int ndof = fel.GetNDof();
+
+    FlatMatrixFixHeight<DIM_DMAT> bmat(ndof*DIM, lh);
+    FlatMatrix<> gref(NCH, ndof, lh), g(NCH, ndof, lh);
+    FlatMatrix<> ata(NCH, NCH, lh), inv(NCH, NCH, lh);
+    FlatMatrix<> atb(DIM_DMAT*DIM, NCH, lh);
+    ata = 0.0;
+    atb = 0.0;
+
+    for (int k = 0; k < 2; k++)
+      {
+        double maxb = 0, maxres = 0;
+        for (int q = 0; q < ir.GetNIP(); q++)
+          {
+            MappedIntegrationPoint<DIM_ELEMENT,DIM_SPACE> mip(ir[q], eltrans);
+            CalcRefTensorChannels (fel, ir[q], gref, lh);
+            g = Trans (RefTensorTrafo (mip)) * gref;
+            DIFFOP::GenerateMatrix (fel, mip, bmat, lh);
+
+            if (k == 0)
+              {
+                ata += g * Trans (g);
+                for (int r = 0; r < DIM_DMAT; r++)
+                  for (int c = 0; c < DIM; c++)
+                    for (int m = 0; m < NCH; m++)
+                      for (int i = 0; i < ndof; i++)
+                        atb(r*DIM+c, m) += bmat(r, DIM*i+c) * g(m,i);
+              }
+            else
+              for (int r = 0; r < DIM_DMAT; r++)
+                for (int c = 0; c < DIM; c++)
+                  for (int i = 0; i < ndof; i++)
+                    {
+                      double fit = 0;
+                      for (int m = 0; m < NCH; m++)
+                        fit += ecoupling(r, c*NCH+m) * g(m,i);
+                      maxb = max2 (maxb, fabs (bmat(r,DIM*i+c)));
+                      maxres = max2 (maxres, fabs (bmat(r,DIM*i+c)-fit));
+                    }
+          }
+        
+        if (k == 0)
+          {
+            CalcInverse (ata, inv);
+            ecoupling.SetSize (DIM_DMAT, DIM*NCH);
+            for (int r = 0; r < DIM_DMAT; r++)
+              for (int c = 0; c < DIM; c++)
+                for (int m = 0; m < NCH; m++)
+                  {
+                    double sum = 0;
+                    for (int l = 0; l < NCH; l++)
+                      sum += atb(r*DIM+c, l) * inv(l,m);
+                    ecoupling(r, c*NCH+m) = sum;
+                  }
+          }
+        else
+          return maxres <= 1e-10 * maxb;
+      }
+    return false;
+  }
+
+  template <typename ENABLE = void>
+  bool CalcElementMatrixRefTensor (const FiniteElement & bfel,
+                                   const ElementTransformation & eltrans, 
+                                   FlatMatrix<double> elmat,
+                                   LocalHeap & lh, true_type) const
+  {
+    ELEMENT_TYPE et = bfel.ElementType();
+    if (et != ET_SEGM && et != ET_TRIG && et != ET_TET) return false;
+    if (!BASE::const_coefs || eltrans.IsCurvedElement()) return false;
+    if (reftensor_state < 0) return false;
+
+    static Timer timer ("Elementmatrix, reference tensor");
+    RegionTimer reg (timer);
+
+    const ScalarFiniteElement<DIM_ELEMENT> & fel = 
+      static_cast<const ScalarFiniteElement<DIM_ELEMENT>&> (bfel);
+
+    if (reftensor_state == 0)
+      {
+#pragma omp critical(reftensor_coupling)
+        {
+          if (reftensor_state == 0)
+            reftensor_state = FitRefTensorCoupling (fel, eltrans, lh) ? 1 : -1;
+        }
+        if (reftensor_state < 0) return false;
+      }
+
+    HeapReset hr(lh);
+    int ndof = fel.GetNDof();
+    int order = GetIntegrationOrder (fel, eltrans.HigherIntegrationOrderSet());
+
+    // shape values and derivatives in a generic point identify the 
+    // orientation class of the element
+    IntegrationPoint probe(0.1361, 0.2274, 0.1913, 0);
+    FlatVector<> fingerprint(ndof*(DIM_ELEMENT+1), lh);
+    fel.CalcShape (probe, fingerprint.Range(0, ndof));
+    FlatMatrix<> dshape(ndof, DIM_ELEMENT, lh);
+    fel.CalcDShape (probe, dshape);
+    for (int i = 0; i < ndof; i++)
+      for (int j = 0; j < DIM_ELEMENT; j++)
+        fingerprint(ndof+DIM_ELEMENT*i+j) = dshape(i,j);
+
+    const RefTensor * rt = FindRefTensor (et, order, fingerprint);
+    if (!rt)
+      {
+        RefTensor * nrt = new RefTensor;
+        nrt->et = et;
+        nrt->order = order;
+        nrt->fingerprint.SetSize (fingerprint.Size());
+        nrt->fingerprint = fingerprint;
+        nrt->tensor.SetSize (ndof*ndof, NCH*NCH);
+        nrt->tensor = 0.0;
+
+        const IntegrationRule & ir = SelectIntegrationRule (et, order);
+        FlatMatrix<> gref(NCH, ndof, lh);
+        for (int q = 0; q < ir.GetNIP(); q++)
+          {
+            CalcRefTensorChannels (fel, ir[q], gref, lh);
+            double w = ir[q].Weight();
+            for (int i = 0; i < ndof; i++)
+              for (int j = 0; j < ndof; j++)
+                for (int a = 0; a < NCH; a++)
+                  for (int b = 0; b < NCH; b++)
+                    nrt->tensor(i*ndof+j, a*NCH+b) += w * gref(a,i) * gref(b,j);
+          }
+
+#pragma omp critical(reftensor_insert)
+        {
+          rt = FindRefTensor (et, order, fingerprint);
+          if (!rt && nreftensors < MAX_REFTENSORS)
+            {
+              reftensors[nreftensors] = nrt;
+              rt = nrt;
+              nreftensors++;
+            }
+        }
+        if (rt != nrt) delete nrt;
+        if (!rt) return false;
+      }
+
+    MappedIntegrationPoint<DIM_ELEMENT,DIM_SPACE> mip(probe, eltrans);
+    Mat<DIM_DMAT,DIM_DMAT> dmat;
+    dmatop.GenerateMatrix (fel, mip, dmat, lh);
+
+    // material factors in physical channels
+    FlatMatrix<> de(DIM_DMAT, DIM*NCH, lh), cmat(DIM*NCH, DIM*NCH, lh);
+    de = dmat * ecoupling;
+    cmat = Trans (ecoupling) * de;
+
+    // geometric factors: pull back to reference channels
+    Mat<NCH,NCH> trafo = RefTensorTrafo (mip);
+    double meas = mip.GetMeasure();
+    FlatMatrix<> hmat(NCH*NCH, DIM*DIM, lh);
+    for (int c = 0; c < DIM; c++)
+      for (int e = 0; e < DIM; e++)
+        for (int a = 0; a < NCH; a++)
+          for (int b = 0; b < NCH; b++)
+            {
+              double sum = 0;
+              for (int m = 0; m < NCH; m++)
+                for (int n = 0; n < NCH; n++)
+                  sum += trafo(a,m) * trafo(b,n) * cmat(c*NCH+m, e*NCH+n);
+              hmat(a*NCH+b, c*DIM+e) = meas * sum;
+            }
+
+    FlatMatrix<> rmat(ndof*ndof, DIM*DIM, lh);
+    rmat = rt->tensor * hmat;
+
+    for (int i = 0; i < ndof; i++)
+      for (int j = 0; j < ndof; j++)
+        for (int c = 0; c < DIM; c++)
+          for (int e = 0; e < DIM; e++)
+            elmat(DIM*i+c, DIM*j+e) = rmat(i*ndof+j, c*DIM+e);
+    return true;
+  }
+
+  const RefTensor * FindRefTensor (ELEMENT_TYPE et, int order, 
+                                   FlatVector<> fingerprint) const
+  {
+    int nr = nreftensors;
+    for (int k = 0; k < nr; k++)
+      {
+        const RefTensor & rt = *reftensors[k];
+        if (rt.et != et || rt.order != order || 
+            rt.fingerprint.Size() != fingerprint.Size()) continue;
+        bool same = true;
+        for (int i = 0; i < fingerprint.Size(); i++)
+          if (fabs (rt.fingerprint(i)-fingerprint(i)) > 1e-12 * (1+fabs(fingerprint(i))))
+            { same = false; break; }
+        if (same) return &rt;
+      }
+    return NULL;
+  }
+
+public:
+
+
 #ifdef TEXT_BOOK_VERSION
 
   template <typename TSCAL>
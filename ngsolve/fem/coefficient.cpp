@@ -13,6 +13,38 @@
 
 namespace ngfem
 {
+
+  atomic<size_t> ChangeTracker :: counter(0);
+
+  void ChangeTracker :: SetChanged (int domain)
+  {
+    size_t stamp = ++counter;
+    if (domain < 0)
+      {
+        all_stamp = stamp;
+        return;
+      }
+    if (domain >= domain_stamps.Size())
+      {
+        int oldsize = domain_stamps.Size();
+        domain_stamps.SetSize (domain+1);
+        domain_stamps.Range (oldsize, domain+1) = 0;
+      }
+    domain_stamps[domain] = stamp;
+  }
+
+  bool ChangeTracker :: ChangedSince (int domain, size_t stamp) const
+  {
+    if (all_stamp > stamp) return true;
+    if (domain < 0)
+      {
+        for (size_t s : domain_stamps)
+          if (s > stamp) return true;
+        return false;
+      }
+    return domain < domain_stamps.Size() && domain_stamps[domain] > stamp;
+  }
+
   
   CoefficientFunction :: CoefficientFunction ()
   { ; }
@@ -201,6 +233,17 @@ namespace ngfem
     */
   }
 
+  void DomainVariableCoefficientFunction :: Compile (bool verbose)
+  {
+    for (int i = 0; i < fun.Size(); i++)
+      if (fun[i] && !fun[i]->IsCompiled())
+        {
+          bool ok = fun[i]->Compile (verbose);
+          if (verbose)
+            cout << IM(3) << "evalfunction " << i << (ok ? " compiled" : " interpreted") << endl;
+        }
+  }
+
   bool DomainVariableCoefficientFunction :: IsComplex() const 
   {
     for (int i = 0; i < fun.Size(); i++)
@@ -15,8 +15,36 @@ namespace ngfem
   */
 
 
+  /**
+     Records on which sub-domains an object changed, and when.
+     Time stamps come from one global counter, such that every 
+     user can compare with the stamp of its own last update
+     (e.g. incremental re-assembling of bilinear-forms).
+  */
+  class NGS_DLL_HEADER ChangeTracker
+  {
+    /// stamp of the last change per sub-domain
+    Array<size_t> domain_stamps;
+    /// stamp of the last change everywhere
+    size_t all_stamp = 0;
+    ///
+    static atomic<size_t> counter;
+  public:
+    /// mark as changed on sub-domain (-1 .. everywhere)
+    void SetChanged (int domain = -1);
+    /// changed on sub-domain (-1 .. anywhere) after time stamp ?
+    bool ChangedSince (int domain, size_t stamp) const;
+    /// the current time stamp
+    static size_t Now () { return counter; }
+  };
+
+
   class NGS_DLL_HEADER CoefficientFunction
   {
+  protected:
+    /// changes of the function, for incremental re-assembling
+    ChangeTracker changes;
+
   public:
     ///
     CoefficientFunction ();
@@ -91,6 +119,13 @@ namespace ngfem
     }
 
     virtual void PrintReport (ostream & ost) const;
+
+    /// mark the function as changed on sub-domain (-1 .. everywhere)
+    void SetChanged (int domain = -1) { changes.SetChanged (domain); }
+    /// has the function changed on the sub-domain since the time stamp ?
+    /// functions which do not track their changes are always changed
+    virtual bool ChangedSince (int domain, size_t stamp) const
+    { return true; }
   };
 
   inline ostream & operator<< (ostream & ost, CoefficientFunction & cf)
@@ -155,6 +190,17 @@ namespace ngfem
       return val;
     }
 
+    /// new value, marks the function as changed
+    void SetValue (double aval) 
+    {
+      val = aval; 
+      SetChanged();
+    }
+
+    /// changes only by SetValue
+    virtual bool ChangedSince (int domain, size_t stamp) const
+    { return changes.ChangedSince (domain, stamp); }
+
     virtual void PrintReport (ostream & ost) const;
   };
 
@@ -187,6 +233,17 @@ namespace ngfem
     }
 
     double operator[] (int i) const { return val[i]; }
+
+    /// new value on sub-domain, marks the sub-domain as changed
+    void SetValue (int domain, double aval)
+    {
+      val[domain] = aval;
+      SetChanged (domain);
+    }
+
+    /// changes only by SetValue
+    virtual bool ChangedSince (int domain, size_t stamp) const
+    { return changes.ChangedSince (domain, stamp); }
   };
 
 
@@ -222,6 +279,9 @@ namespace ngfem
       return *(fun[index]);
     }
 
+    /// translate the EvalFunctions to native code (see EvalFunction::Compile)
+    void Compile (bool verbose = false);
+
     virtual bool IsComplex() const;
     /*
     {
@@ -463,11 +463,15 @@ namespace ngfem
     ElasticityIntegrator (shared_ptr<CoefficientFunction> coefe,
 			  shared_ptr<CoefficientFunction> coefnu)
       : BASE(ElasticityDMat<D> (coefe, coefnu))
-    { ; }
+    { 
+      this->const_coefs = BASE::IsPiecewiseConstant (coefe) && BASE::IsPiecewiseConstant (coefnu);
+    }
 
     ElasticityIntegrator (const Array<shared_ptr<CoefficientFunction>> & coeffs)
       : BASE(ElasticityDMat<D> (coeffs[0], coeffs[1]))
-    { ; }
+    { 
+      this->const_coefs = BASE::IsPiecewiseConstant (coeffs[0]) && BASE::IsPiecewiseConstant (coeffs[1]);
+    }
 
     /*
     static Integrator * Create (Array<CoefficientFunction*> & coeffs)
@@ -37,7 +37,7 @@ namespace ngfem
 
   public:
     ///
-    ElementTransformation () { higher_integration_order = false; } 
+    ElementTransformation () { higher_integration_order = false; iscurved = true; } 
     ///
     virtual ~ElementTransformation() { ; } 
     /// set data: is it a boundary, element number, and element index
@@ -116,7 +116,7 @@ namespace ngfem
     /// has the element non-constant Jacobian ?
     virtual bool IsCurvedElement() const 
     {
-      return false;
+      return iscurved;
     }
 
     virtual void GetSort (FlatArray<int> sort) const
@@ -36,6 +36,15 @@ namespace ngfem
     DeleteCurveIPs();
   }
   
+  bool Integrator :: ChangedSince (int domain, size_t stamp) const
+  {
+    if (!changes_tracked) return true;
+    if (changes.ChangedSince (domain, stamp)) return true;
+    for (auto & cf : dependencies)
+      if (cf->ChangedSince (domain, stamp)) return true;
+    return false;
+  }
+
   bool Integrator :: DefinedOn (int mat) const
   {
     if (definedon.Size())
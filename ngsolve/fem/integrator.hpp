@@ -52,6 +52,13 @@ namespace ngfem
   
     int cachecomp;
 
+    /// changes of the integrator, for incremental re-assembling
+    ChangeTracker changes;
+    /// coefficients the element matrices depend on
+    Array<shared_ptr<CoefficientFunction>> dependencies;
+    /// all dependencies are registered, otherwise always changed
+    bool changes_tracked = false;
+
   
   protected:
     void DeleteCurveIPs ( void );
@@ -84,6 +91,15 @@ namespace ngfem
     /// defined only on some subdomains
     void SetDefinedOn (const Array<int> & regions);
 
+    /// mark the integrator as changed on sub-domain (-1 .. everywhere)
+    void SetChanged (int domain = -1) { changes.SetChanged (domain); }
+    /// element matrices depend on the coefficient
+    /// (the first call opts in to change tracking, so register all of them)
+    void AddDependency (shared_ptr<CoefficientFunction> cf)
+    { dependencies.Append (cf); changes_tracked = true; }
+    /// have the element matrices on sub-domain changed since the time stamp ?
+    virtual bool ChangedSince (int domain, size_t stamp) const;
+
     bool DefinedOnSubdomainsOnly() const
     { return definedon.Size() != 0; }
 
@@ -122,6 +138,10 @@ namespace ngfem
     void SetConstantCoefficient (bool acc = 1)
     { const_coef = acc; }
 
+    /// coefficients are constant on every sub-domain
+    virtual bool PiecewiseConstantCoefficients () const
+    { return const_coef; }
+
     /// dimension of element
     virtual int DimElement () const { return -1; }
 
@@ -663,6 +683,9 @@ namespace ngfem
     const BilinearFormIntegrator & Block () const { return *bfi; }
     shared_ptr<BilinearFormIntegrator> BlockPtr () const { return bfi; }
 
+    virtual bool ChangedSince (int domain, size_t stamp) const
+    { return changes.ChangedSince (domain, stamp) || bfi->ChangedSince (domain, stamp); }
+
     virtual void
     CalcElementMatrix (const FiniteElement & bfel, 
 		       const ElementTransformation & eltrans, 
@@ -811,6 +834,9 @@ namespace ngfem
 
     virtual void CheckElement (const FiniteElement & el) const { bfi->CheckElement(el); }
 
+    virtual bool ChangedSince (int domain, size_t stamp) const
+    { return changes.ChangedSince (domain, stamp) || bfi->ChangedSince (domain, stamp); }
+
 
     virtual void
     CalcElementMatrix (const FiniteElement & fel, 
@@ -968,6 +994,9 @@ namespace ngfem
       return bfi->CheckElement (dynamic_cast<const CompoundFiniteElement&>(el)[comp]);
     }
 
+    virtual bool ChangedSince (int domain, size_t stamp) const
+    { return changes.ChangedSince (domain, stamp) || bfi->ChangedSince (domain, stamp); }
+
     virtual void
     CalcElementMatrix (const FiniteElement & bfel, 
 		       const ElementTransformation & eltrans, 
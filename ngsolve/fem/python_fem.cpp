@@ -284,11 +284,13 @@ void NGS_DLL_HEADER ExportNgfem() {
   bp::class_<CoefficientFunction, shared_ptr<CoefficientFunction>, boost::noncopyable> 
     ("CoefficientFunction", bp::no_init)
     .def("Evaluate", static_cast<double (CoefficientFunction::*)(const BaseMappedIntegrationPoint &) const>(&CoefficientFunction::Evaluate))
+    .def("SetChanged", &CoefficientFunction::SetChanged, (bp::arg("self"), bp::arg("domain")=-1))
     ;
 
   bp::class_<ConstantCoefficientFunction,bp::bases<CoefficientFunction>,
     shared_ptr<ConstantCoefficientFunction>, boost::noncopyable>
     ("ConstantCF", bp::init<double>())
+    .def("SetValue", &ConstantCoefficientFunction::SetValue)
     ;
   
   bp::implicitly_convertible 
@@ -333,6 +335,7 @@ void NGS_DLL_HEADER ExportNgfem() {
                              Array<double> darray (makeCArray<double> (coefs));
                              return make_shared<DomainConstantCoefficientFunction> (darray);
                            })))
+    .def("SetValue", &DomainConstantCoefficientFunction::SetValue)
     ;
 
   bp::implicitly_convertible
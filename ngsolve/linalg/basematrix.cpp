@@ -273,6 +273,7 @@ namespace ngla
       case SUPERLU_DIST:    return "superlu_dist";
       case MUMPS:           return "mumps";
       case MASTERINVERSE:   return "masterinverse";
+      case DISTRIBUTEDINVERSE: return "distributedinverse";
       }
     return "";
   }
@@ -241,6 +241,75 @@ namespace ngla
 
 
 
+  template <typename SCAL>
+  void LocalInnerProducts (FlatArray<const BaseVector*> x, FlatArray<const BaseVector*> y,
+                           FlatArray<const BitArray*> masks, FlatVector<SCAL> ips)
+  {
+    static Timer t("LocalInnerProducts");
+    RegionTimer reg(t);
+
+    int n = x.Size();
+    if (y.Size() != n || ips.Size() != n)
+      throw Exception ("LocalInnerProducts: sizes do not fit");
+
+    ips = SCAL(0.0);
+    if (n == 0) return;
+
+    // all pairs chunk by chunk, fixed chunks give results independent of the threads
+    int size = x[0]->FV<SCAL>().Size();
+    int chunksize = 4096;
+    int nchunks = (size + chunksize-1) / chunksize;
+    Matrix<SCAL> partial(nchunks, n);
+
+#pragma omp parallel for
+    for (int c = 0; c < nchunks; c++)
+      {
+        int first = c * chunksize;
+        int next = min2 (size, first+chunksize);
+        for (int i = 0; i < n; i++)
+          {
+            FlatVector<SCAL> fx = x[i]->FV<SCAL>();
+            FlatVector<SCAL> fy = y[i]->FV<SCAL>();
+            const BitArray * mask = masks.Size() ? masks[i] : NULL;
+
+            if (!mask)
+              partial(c,i) = ngbla::InnerProduct (fx.Range(first, next), fy.Range(first, next));
+            else
+              {
+                int es = size / x[i]->Size();
+                SCAL sum = 0.0;
+                for (int k = first; k < next; k++)
+                  if (mask->Test (k / es))
+                    sum += fx(k) * fy(k);
+                partial(c,i) = sum;
+              }
+          }
+      }
+
+    for (int c = 0; c < nchunks; c++)
+      ips += partial.Row(c);
+  }
+
+  template NGS_DLL_HEADER void LocalInnerProducts<double> 
+  (FlatArray<const BaseVector*> x, FlatArray<const BaseVector*> y,
+   FlatArray<const BitArray*> masks, FlatVector<double> ips);
+  template NGS_DLL_HEADER void LocalInnerProducts<Complex> 
+  (FlatArray<const BaseVector*> x, FlatArray<const BaseVector*> y,
+   FlatArray<const BitArray*> masks, FlatVector<Complex> ips);
+
+  void BaseVector :: InnerProducts (FlatArray<const BaseVector*> x, FlatArray<const BaseVector*> y,
+                                    FlatVector<double> ips) const
+  {
+    LocalInnerProducts (x, y, FlatArray<const BitArray*> (0, NULL), ips);
+  }
+
+  void BaseVector :: InnerProducts (FlatArray<const BaseVector*> x, FlatArray<const BaseVector*> y,
+                                    FlatVector<Complex> ips) const
+  {
+    LocalInnerProducts (x, y, FlatArray<const BitArray*> (0, NULL), ips);
+  }
+
+
   AutoVector BaseVector ::Range (int begin, int end) const
   {
     throw Exception ("BaseVector::Range const called");
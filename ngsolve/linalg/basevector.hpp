@@ -216,6 +216,15 @@ namespace ngla
     virtual double InnerProductD (const BaseVector & v2) const;
     virtual Complex InnerProductC (const BaseVector & v2) const;
 
+    /**
+       The inner products <x_i, y_i> of the vector pairs, computed in one
+       threaded pass. Parallel vectors use a single global reduction.
+    */
+    virtual void InnerProducts (FlatArray<const BaseVector*> x, FlatArray<const BaseVector*> y,
+                                FlatVector<double> ips) const;
+    virtual void InnerProducts (FlatArray<const BaseVector*> x, FlatArray<const BaseVector*> y,
+                                FlatVector<Complex> ips) const;
+
     virtual double L2Norm () const;
     virtual bool IsComplex() const = 0;
 
@@ -440,6 +449,18 @@ namespace ngla
       return vec->InnerProductC (v2);
     }
 
+    virtual void InnerProducts (FlatArray<const BaseVector*> x, FlatArray<const BaseVector*> y,
+                                FlatVector<double> ips) const
+    {
+      vec->InnerProducts (x, y, ips);
+    }
+
+    virtual void InnerProducts (FlatArray<const BaseVector*> x, FlatArray<const BaseVector*> y,
+                                FlatVector<Complex> ips) const
+    {
+      vec->InnerProducts (x, y, ips);
+    }
+
     virtual double L2Norm () const
     {
       return vec->L2Norm();
@@ -963,6 +984,38 @@ namespace ngla
     return InnerProduct( v2.FVComplex(), Conj(v1.FVComplex()) );
   }
 
+
+  /**
+     The local parts of the inner products <x_i, y_i>. Only the dofs
+     set in masks[i] are counted, if given.
+  */
+  template <typename SCAL>
+  NGS_DLL_HEADER void LocalInnerProducts (FlatArray<const BaseVector*> x, FlatArray<const BaseVector*> y,
+                                          FlatArray<const BitArray*> masks, FlatVector<SCAL> ips);
+
+  /// inner products of vector pairs, one global reduction for parallel vectors
+  template <class IPTYPE>
+  inline void S_InnerProducts (FlatArray<const BaseVector*> x, FlatArray<const BaseVector*> y,
+                               FlatVector<typename SCAL_TRAIT<IPTYPE>::SCAL> ips)
+  {
+    for (int i = 0; i < x.Size(); i++)
+      ips(i) = S_InnerProduct<IPTYPE> (*x[i], *y[i]);
+  }
+
+  template <> inline void
+  S_InnerProducts<double> (FlatArray<const BaseVector*> x, FlatArray<const BaseVector*> y,
+                           FlatVector<double> ips)
+  {
+    if (x.Size()) x[0]->InnerProducts (x, y, ips);
+  }
+
+  template <> inline void
+  S_InnerProducts<Complex> (FlatArray<const BaseVector*> x, FlatArray<const BaseVector*> y,
+                            FlatVector<Complex> ips)
+  {
+    if (x.Size()) x[0]->InnerProducts (x, y, ips);
+  }
+
   ///
   inline double L2Norm (const BaseVector & v)
   {
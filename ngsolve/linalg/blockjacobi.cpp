@@ -546,18 +546,26 @@ namespace ngla
     FlatVector<TVX> fx = x.FV<TVX> ();
     FlatVector<TVX> fy = y.FV<TVX> ();
     
-    Vector<TVX> hxmax(maxbs);
-    
-    for (auto i : Range (blocktable))
-      {
-	FlatArray<int> ind = blocktable[i];
-	if (!ind.Size()) continue;
+    // blocks of one colour are disjoint
+#pragma omp parallel
+    {
+      Vector<TVX> hxmax(maxbs);
+      for (int c = 0; c < block_coloring.Size(); c++)
+	{
+	  FlatArray<int> blocks = block_coloring[c];
+	  for (int ii : ThreadRange (c))
+	    {
+	      FlatArray<int> ind = blocktable[blocks[ii]];
+	      if (!ind.Size()) continue;
 
-	FlatVector<TVX> hx = hxmax.Range(0, ind.Size()); // (ind.Size(), hxmax.Addr(0));
+	      FlatVector<TVX> hx = hxmax.Range(0, ind.Size());
 	  
-	hx = s * fx(ind);
-	fy(ind) += invdiag[i] * hx;
-      }
+	      hx = s * fx(ind);
+	      fy(ind) += invdiag[blocks[ii]] * hx;
+	    }
+#pragma omp barrier
+	}
+    }
   }
 
 
@@ -1062,25 +1070,34 @@ namespace ngla
     FlatVector<TVX> fx = x.FV<TVX> ();
     FlatVector<TVX> fy       = y.FV<TVX> ();
 
-    Vector<TVX> hxmax(maxbs);
-    Vector<TVX> hymax(maxbs);
-
-    for (int i = 0; i < blocktable.Size(); i++)
-      {
-	int bs = blocktable[i].Size();
-	if (!bs) continue;
+    // blocks of one colour are disjoint
+#pragma omp parallel
+    {
+      Vector<TVX> hxmax(maxbs);
+      Vector<TVX> hymax(maxbs);
+      for (int c = 0; c < block_coloring.Size(); c++)
+	{
+	  FlatArray<int> blocks = block_coloring[c];
+	  for (int ii : ThreadRange (c))
+	    {
+	      int i = blocks[ii];
+	      int bs = blocktable[i].Size();
+	      if (!bs) continue;
 
-	FlatVector<TVX> hx = hxmax.Range (0, bs); // (bs, hxmax.Addr(0));
-	FlatVector<TVX> hy = hymax.Range (0, bs); // (bs, hymax.Addr(0));
+	      FlatVector<TVX> hx = hxmax.Range (0, bs);
+	      FlatVector<TVX> hy = hymax.Range (0, bs);
 
-	for (int j = 0; j < bs; j++)
-	  hx(j) = fx(blocktable[i][j]);
+	      for (int j = 0; j < bs; j++)
+		hx(j) = fx(blocktable[i][j]);
 	
-	InvDiag(i).Mult (hx, hy);
+	      InvDiag(i).Mult (hx, hy);
 
-	for (int j = 0; j < bs; j++)
-	  fy(blocktable[i][j]) += s * hy(j);
-      }
+	      for (int j = 0; j < bs; j++)
+		fy(blocktable[i][j]) += s * hy(j);
+	    }
+#pragma omp barrier
+	}
+    }
   }
 
 
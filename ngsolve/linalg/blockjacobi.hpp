@@ -30,6 +30,14 @@ namespace ngla
     Table<int> block_balancing;
 
     size_t nze;
+
+    /// the blocks of colour c for the calling thread, also if the team is smaller
+    IntRange ThreadRange (int c) const
+    {
+      int nt = omp_get_num_threads(), tid = omp_get_thread_num();
+      int nb = block_balancing[c].Size()-1;
+      return IntRange (block_balancing[c][tid*nb/nt], block_balancing[c][(tid+1)*nb/nt]);
+    }
   public:
     /// the blocktable define the blocks. ATTENTION: entries will be reordered !
     BaseBlockJacobiPrecond (Table<int> & ablocktable);
@@ -701,7 +701,13 @@ namespace ngla
 
 	t = (*a) * s_tilde;
 
-	omega = S_InnerProduct<IPTYPE> (t, s) / S_InnerProduct<IPTYPE> (t, t);
+	// (t,s) and (t,t) in one reduction
+	const BaseVector * ipx[2] = { &*t, &*t };
+	const BaseVector * ipy[2] = { &*s, &*t };
+	Vec<2,SCAL> ts_tt;
+	S_InnerProducts<IPTYPE> (FlatArray<const BaseVector*> (2, ipx), 
+				 FlatArray<const BaseVector*> (2, ipy), ts_tt);
+	omega = ts_tt(0) / ts_tt(1);
 	u += alpha * p_tilde + omega * s_tilde;
 	r = s - omega * t;
 
@@ -749,7 +755,9 @@ namespace ngla
 
 	    t = (*a) * s_tilde;
 	    
-	    omega = S_InnerProduct<IPTYPE> (t, s) / S_InnerProduct<IPTYPE> (t, t);
+	    S_InnerProducts<IPTYPE> (FlatArray<const BaseVector*> (2, ipx), 
+				     FlatArray<const BaseVector*> (2, ipy), ts_tt);
+	    omega = ts_tt(0) / ts_tt(1);
 	    u +=  omega * s_tilde;
 	    r = s - omega * t;
 
@@ -927,8 +935,17 @@ namespace ngla
                 av = hv;
               }
 
+            // all (v_i, av) in one reduction
+            Array<const BaseVector*> ipx(j+1), ipy(j+1);
+            Vector<SCAL> hj(j+1);
             for (int i = 0; i <= j; i++)
-              h2(i,j) = h(i,j) = S_InnerProduct<IPTYPE> (*vi[i], av);
+              {
+                ipx[i] = &*vi[i];
+                ipy[i] = &*av;
+              }
+            S_InnerProducts<IPTYPE> (ipx, ipy, hj);
+            for (int i = 0; i <= j; i++)
+              h2(i,j) = h(i,j) = hj(i);
 
             w = av;
             for (int i = 0; i <= j; i++)
@@ -101,13 +101,149 @@ namespace ngla
   template <class SCAL>
   ElementByElementMatrix<SCAL> :: ~ElementByElementMatrix ()
   {
+    for (int i = 0; i < ne; i++)
+      {
+        if (!clone.Test(i) && !InArena (elmats[i].Data()))
+          delete [] elmats[i].Data();
+        if (!InArena (rowdnums[i].Data()))
+          delete [] rowdnums[i].Data();
+        if (!InArena (coldnums[i].Data()))
+          delete [] coldnums[i].Data();
+      }
+  }
+
+
+  template <class SCAL>
+  void ElementByElementMatrix<SCAL> :: Compress ()
+  {
+    static Timer timer("EBE-matrix::Compress");
+    RegionTimer reg (timer);
+
+    const int align = 64 / sizeof(SCAL);
+
+    // group elements by block size, keep element order within a group
+    apply_order.SetSize (ne);
+    for (int i = 0; i < ne; i++)
+      apply_order[i] = i;
+    QuickSort (apply_order, [&] (int a, int b)
+               {
+                 if (elmats[a].Height() != elmats[b].Height())
+                   return elmats[a].Height() < elmats[b].Height();
+                 if (elmats[a].Width() != elmats[b].Width())
+                   return elmats[a].Width() < elmats[b].Width();
+                 return a < b;
+               });
+
+    // offsets of matrices and dofs in the new arenas
+    Array<size_t> matpos(ne), dnumpos(ne);
+    size_t nmat = 0, ndnums = 0;
+    for (int i : apply_order)
+      {
+        matpos[i] = nmat;
+        if (!clone.Test(i))
+          nmat += (elmats[i].Height()*elmats[i].Width() + align-1) / align * align;
+        dnumpos[i] = ndnums;
+        ndnums += rowdnums[i].Size() + coldnums[i].Size();
+      }
+
+    Array<SCAL> newarena(nmat+align);
+    Array<int> newarena_dnums(ndnums);
+
+    size_t offset = 0;
+    while ( (size_t(newarena.Data()+offset) % 64) != 0 && offset < size_t(align))
+      offset++;
+
+    Array<SCAL*> newdata(ne);
+#pragma omp parallel for
+    for (int i = 0; i < ne; i++)
+      {
+        newdata[i] = newarena.Data()+offset+matpos[i];
+        if (!clone.Test(i))
+          {
+            int h = elmats[i].Height(), w = elmats[i].Width();
+            SCAL * olddata = elmats[i].Data();
+            for (int j = 0; j < h*w; j++)
+              newdata[i][j] = olddata[j];
+          }
+        
+        int * pr = newarena_dnums.Data()+dnumpos[i];
+        int * pc = pr + rowdnums[i].Size();
+        for (int j = 0; j < rowdnums[i].Size(); j++) pr[j] = rowdnums[i][j];
+        for (int j = 0; j < coldnums[i].Size(); j++) pc[j] = coldnums[i][j];
+      }
+
+    // clones share the matrix of their reference element,
+    // find the owner by the old data pointer
+    Array<int> owners;
+    for (int i = 0; i < ne; i++)
+      if (!clone.Test(i) && elmats[i].Height()*elmats[i].Width() != 0)
+        owners.Append (i);
+    QuickSort (owners, [&] (int a, int b)
+               { return elmats[a].Data() < elmats[b].Data(); });
+
+    Array<int> cloneref(ne);
+    cloneref = -1;
+    for (int i = 0; i < ne; i++)
+      if (clone.Test(i) && elmats[i].Height()*elmats[i].Width() != 0)
+        {
+          int first = 0, last = owners.Size();
+          while (last-first > 1)
+            {
+              int mid = (first+last)/2;
+              if (elmats[owners[mid]].Data() <= elmats[i].Data())
+                first = mid;
+              else
+                last = mid;
+            }
+          cloneref[i] = owners[first];
+        }
+
+    for (int i = 0; i < ne; i++)
+      {
+        int * pr = newarena_dnums.Data()+dnumpos[i];
+        int * pc = pr + rowdnums[i].Size();
+        int sr = rowdnums[i].Size(), sc = coldnums[i].Size();
+
+        if (!InArena (rowdnums[i].Data())) delete [] rowdnums[i].Data();
+        if (!InArena (coldnums[i].Data())) delete [] coldnums[i].Data();
+        new (&rowdnums[i]) FlatArray<int> (sr, pr);
+        new (&coldnums[i]) FlatArray<int> (sc, pc);
+      }
+
     for (int i = 0; i < ne; i++)
       if (!clone.Test(i))
-	{
-	  delete [] &(elmats[i](0,0));
-	  delete [] &(rowdnums[i])[0];
-	  delete [] &(coldnums[i])[0];
-	}
+        {
+          if (!InArena (elmats[i].Data())) delete [] elmats[i].Data();
+          elmats[i].AssignMemory (elmats[i].Height(), elmats[i].Width(), newdata[i]);
+        }
+    for (int i = 0; i < ne; i++)
+      if (clone.Test(i) && elmats[i].Height()*elmats[i].Width() != 0)
+        elmats[i].AssignMemory (elmats[i].Height(), elmats[i].Width(), newdata[cloneref[i]]);
+
+    arena.Swap (newarena);
+    arena_dnums.Swap (newarena_dnums);
+  }
+
+
+  template <class SCAL>
+  void ElementByElementMatrix<SCAL> :: MemoryUsage (Array<MemoryUsageStruct*> & mu) const
+  {
+    size_t nbytes = arena.Size()*sizeof(SCAL) + arena_dnums.Size()*sizeof(int);
+    int nblocks = (arena.Size() ? 1 : 0) + (arena_dnums.Size() ? 1 : 0);
+    for (int i = 0; i < ne; i++)
+      {
+        if (!clone.Test(i) && !InArena (elmats[i].Data()))
+          {
+            nbytes += elmats[i].Height()*elmats[i].Width()*sizeof(SCAL);
+            nblocks++;
+          }
+        if (!InArena (rowdnums[i].Data()))
+          {
+            nbytes += (rowdnums[i].Size()+coldnums[i].Size())*sizeof(int);
+            nblocks += 2;
+          }
+      }
+    mu.Append (new MemoryUsageStruct ("ElementByElementMatrix", nbytes, nblocks));
   }
   
   template <class SCAL>
@@ -117,118 +253,92 @@ namespace ngla
     RegionTimer reg (timer);
 
     int maxs = 0;
-    for (int i = 0; i < coldnums.Size(); i++)
-      maxs = max2 (maxs, coldnums[i].Size());
-
-    if (disjointrows)
-      {
-#pragma omp parallel
-	{    
-	  ArrayMem<SCAL, 100> mem1(maxs); 
-
-	  FlatVector<SCAL> vx = x.FV<SCAL> (); 
-	  FlatVector<SCAL> vy = y.FV<SCAL> (); 
-
-#pragma omp for
-	  for (int i = 0; i < rowdnums.Size(); i++) //sum over all elements
-	    {
-	      FlatArray<int> rdi = rowdnums[i];
-	      FlatArray<int> cdi = coldnums[i];
+    for (int i = 0; i < ne; i++)
+      maxs = max2 (maxs, max2 (rowdnums[i].Size(), coldnums[i].Size()));
+
+    FlatVector<SCAL> vx = x.FV<SCAL> (); 
+    FlatVector<SCAL> vy = y.FV<SCAL> (); 
+
+    // shared rows are updated atomically
+    bool atomic = !disjointrows && omp_get_max_threads() > 1;
+    double flops = 0;
+
+#pragma omp parallel reduction(+:flops)
+    {    
+      ArrayMem<SCAL, 100> mem1(maxs), mem2(maxs); 
+
+      // elements with equal block size are consecutive
+#pragma omp for schedule(static)
+      for (int k = 0; k < ne; k++)
+        {
+          int i = apply_order.Size() ? apply_order[k] : k;
+          FlatArray<int> rdi = rowdnums[i];
+          FlatArray<int> cdi = coldnums[i];
 	      
-	      if (!rdi.Size() || !cdi.Size()) continue;
+          if (!rdi.Size() || !cdi.Size()) continue;
 	      
-	      FlatVector<SCAL> hv1(cdi.Size(), &mem1[0]);
-
-	      hv1 = vx(cdi);
-	      vy(rdi) += s * elmats[i] * hv1;
-
-	      timer.AddFlops (cdi.Size()*rdi.Size());
-	    }
-	}//end of parallel    
-	
-      }
-    else
-      {    
-	ArrayMem<SCAL, 100> mem1(maxs), mem2(maxs);
-	
-	FlatVector<SCAL> vx = x.FV<SCAL>(); // dynamic_cast<const S_BaseVector<SCAL> & >(x).FVScal();
-	FlatVector<SCAL> vy = y.FV<SCAL>(); // dynamic_cast<S_BaseVector<SCAL> & >(y).FVScal();
-	
-	for (int i = 0; i < rowdnums.Size(); i++) //sum over all elements
-	  {
-	    FlatArray<int> rdi = rowdnums[i];
-	    FlatArray<int> cdi = coldnums[i];
-	    
-	    if (!rdi.Size() || !cdi.Size()) continue;
-	    
-	    FlatVector<SCAL> hv(cdi.Size(), &mem1[0]);
-	    
-	    hv = vx(cdi);
-	    vy(rdi) += s * elmats[i] * hv;
-	    
-	    timer.AddFlops (cdi.Size()*rdi.Size());
-	  }
-      }
+          FlatVector<SCAL> hx(cdi.Size(), &mem1[0]);
+          FlatVector<SCAL> hy(rdi.Size(), &mem2[0]);
+
+          hx = vx(cdi);
+          hy = s * elmats[i] * hx;
+          if (atomic)
+            for (int j = 0; j < rdi.Size(); j++)
+              AtomicAdd (vy(rdi[j]), hy(j));
+          else
+            vy(rdi) += hy;
+
+          flops += cdi.Size()*rdi.Size();
+        }
+    }
+    timer.AddFlops (flops);
   }
 
   
   template <class SCAL>
   void ElementByElementMatrix<SCAL> :: MultTransAdd (double s, const BaseVector & x, BaseVector & y) const
   {
-//     cout << " ElementByElementMatrix<SCAL> :: MultTansAdd here " << endl << flush;
     static Timer timer("EBE-matrix::MultTransAdd");
     RegionTimer reg (timer);
+
     int maxs = 0;
-    for (int i = 0; i < rowdnums.Size(); i++)
-      maxs = max2 (maxs, rowdnums[i].Size());
-    
-    if (disjointcols)
-      {
-#pragma omp parallel
-	{
-	  ArrayMem<SCAL, 100> mem1(maxs);
-	  
-	  FlatVector<SCAL> vx = dynamic_cast<const S_BaseVector<SCAL> & >(x).FVScal();
-	  FlatVector<SCAL> vy = dynamic_cast<S_BaseVector<SCAL> & >(y).FVScal();
-
-    #pragma omp  for    
-	  for (int i = 0; i < coldnums.Size(); i++) //sum over all elements
-	    {
-	      FlatArray<int> rdi (rowdnums[i]);
-	      FlatArray<int> cdi (coldnums[i]);
-	      if (!rdi.Size() || !cdi.Size()) continue;
+    for (int i = 0; i < ne; i++)
+      maxs = max2 (maxs, max2 (rowdnums[i].Size(), coldnums[i].Size()));
+
+    FlatVector<SCAL> vx = x.FV<SCAL> (); 
+    FlatVector<SCAL> vy = y.FV<SCAL> (); 
+
+    bool atomic = !disjointcols && omp_get_max_threads() > 1;
+    double flops = 0;
+
+#pragma omp parallel reduction(+:flops)
+    {
+      ArrayMem<SCAL, 100> mem1(maxs), mem2(maxs);
+
+#pragma omp for schedule(static)
+      for (int k = 0; k < ne; k++)
+        {
+          int i = apply_order.Size() ? apply_order[k] : k;
+          FlatArray<int> rdi = rowdnums[i];
+          FlatArray<int> cdi = coldnums[i];
+          
+          if (!rdi.Size() || !cdi.Size()) continue;
 	      
-	      FlatVector<SCAL> hv1(rdi.Size(), &mem1[0]);
-
-	      hv1 = vx(rdi);
-	      vy(cdi) += s * Trans(elmats[i]) * hv1;
-
-	      timer.AddFlops (cdi.Size()*rdi.Size());
-	    }
-	}//end of parallel
-      }
-    else
-      {
-	ArrayMem<SCAL, 100> mem1(maxs);
-	
-	FlatVector<SCAL> vx = x.FV<SCAL> (); // dynamic_cast<const S_BaseVector<SCAL> & >(x).FVScal();
-	FlatVector<SCAL> vy = y.FV<SCAL> (); // dynamic_cast<S_BaseVector<SCAL> & >(y).FVScal();
-	
-	for (int i = 0; i < coldnums.Size(); i++) //sum over all elements
-	  {
-	    FlatArray<int> rdi (rowdnums[i]);
-	    FlatArray<int> cdi (coldnums[i]);
-	    
-	    if (!rdi.Size() || !cdi.Size()) continue;
-	    
-	    FlatVector<SCAL> hv1(rdi.Size(), &mem1[0]);
-	    
-	    hv1 = vx(rdi);
-	    vy(cdi) += s * Trans(elmats[i]) * hv1;
-
-	    timer.AddFlops (cdi.Size()*rdi.Size());
-	  }
-      }
+          FlatVector<SCAL> hx(rdi.Size(), &mem1[0]);
+          FlatVector<SCAL> hy(cdi.Size(), &mem2[0]);
+
+          hx = vx(rdi);
+          hy = s * Trans(elmats[i]) * hx;
+          if (atomic)
+            for (int j = 0; j < cdi.Size(); j++)
+              AtomicAdd (vy(cdi[j]), hy(j));
+          else
+            vy(cdi) += hy;
+
+          flops += cdi.Size()*rdi.Size();
+        }
+    }
+    timer.AddFlops (flops);
   }
 
 
@@ -28,6 +28,18 @@ namespace ngla
     bool disjointrows;
     bool disjointcols;
     BitArray clone;
+    /// compact storage of element matrices, blocks of equal size
+    /// consecutive, every block 64-byte aligned
+    Array<SCAL> arena;
+    /// compact storage of the row and column dofs
+    Array<int> arena_dnums;
+    /// elements grouped by block size, order of the apply
+    Array<int> apply_order;
+
+    bool InArena (const SCAL * p) const
+    { return arena.Size() && p >= arena.Data() && p <= arena.Data()+arena.Size(); }
+    bool InArena (const int * p) const
+    { return arena_dnums.Size() && p >= arena_dnums.Data() && p <= arena_dnums.Data()+arena_dnums.Size(); }
   public:
     ElementByElementMatrix (int h, int ane, bool isymmetric=false);
     ElementByElementMatrix (int h, int w, int ane, bool isymmetric=false);
@@ -56,6 +68,12 @@ namespace ngla
 			   const FlatArray<int> & dnums2,
 			   int refelnr);
 
+    /// moves all element matrices and dofs into compact arenas,
+    /// grouped by block size
+    void Compress ();
+
+    virtual void MemoryUsage (Array<MemoryUsageStruct*> & mu) const;
+
     virtual BaseVector & AsVector() 
     {
       throw Exception ("Cannot access ebe-matrix AsVector");
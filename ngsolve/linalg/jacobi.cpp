@@ -56,9 +56,11 @@ namespace ngla
     FlatVector<TV_ROW> fy = y.FV<TV_ROW> ();
 
     if (!inner)
+#pragma omp parallel for
       for (int i = 0; i < height; i++)
 	fy(i) += s * (invdiag[i] * fx(i));
     else
+#pragma omp parallel for
       for (int i = 0; i < height; i++)
 	if (inner->Test(i))
 	  fy(i) += s * (invdiag[i] * fx(i));
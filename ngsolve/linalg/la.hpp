@@ -40,6 +40,7 @@ namespace ngla
 #include "jacobi.hpp"
 #include "blockjacobi.hpp"
 #include "commutingAMG.hpp"
+#include "saamg.hpp"
 #include "special_matrix.hpp"
 #include "elementbyelement.hpp"
 #include "cg.hpp"
@@ -99,6 +99,37 @@ namespace ngla
     for (int i = 0; i < ntasks; i++)
       if (IsExchangeProc (i))
 	all_dist_procs.Append (i);
+
+
+    // exchange lists for ReduceDofData and ScatterDofData, 
+    // both sides enumerate the shared dofs in increasing local numbers
+    Array<int> nmaster(ntasks), nslave(ntasks);
+    nmaster = 0;
+    nslave = 0;
+    for (int i = 0; i < ndof; i++)
+      if (IsMasterDof(i))
+        {
+          for (int p : (*dist_procs)[i])
+            nslave[p]++;
+        }
+      else
+        nmaster[GetMasterProc(i)]++;
+
+    dofs_by_master = Table<int> (nmaster);
+    masterdofs_by_proc = Table<int> (nslave);
+    nmaster = 0;
+    nslave = 0;
+    for (int i = 0; i < ndof; i++)
+      if (IsMasterDof(i))
+        {
+          for (int p : (*dist_procs)[i])
+            masterdofs_by_proc[p][nslave[p]++] = i;
+        }
+      else
+        {
+          int m = GetMasterProc(i);
+          dofs_by_master[m][nmaster[m]++] = i;
+        }
   }
 
 
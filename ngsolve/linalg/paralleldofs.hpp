@@ -40,6 +40,12 @@ namespace ngla
     
     /// am I the master process ?
     BitArray ismasterdof;
+
+    /// non-master dofs, grouped by their master proc
+    Table<int> dofs_by_master;
+
+    /// master dofs, grouped by the distant procs sharing them
+    Table<int> masterdofs_by_proc;
     
   public:
     /**
@@ -70,6 +76,9 @@ namespace ngla
     bool IsMasterDof ( int localdof ) const
     { return ismasterdof.Test(localdof); }
 
+    const BitArray & MasterDofs () const
+    { return ismasterdof; }
+
     int GetNDofLocal () const { return ndof; }
 
     int GetNDofGlobal () const
@@ -164,6 +173,12 @@ namespace ngla
 
 #ifdef PARALLEL
 
+  /*
+    The exchange lists dofs_by_master and masterdofs_by_proc are set up
+    in the constructor, the message sizes are known in advance and only
+    the neighbour processes are addressed.
+  */
+
   template <typename T>
   void ParallelDofs::ReduceDofData (FlatArray<T> data, MPI_Op op) const
   {
@@ -171,48 +186,37 @@ namespace ngla
     int ntasks = GetNTasks ();
     if (ntasks <= 1) return;
 
-    DynamicTable<T> dist_data(ntasks);
-
-    for (int i = 0; i < GetNDofLocal(); i++)
-      if (!IsMasterDof(i))
-	{
-	  FlatArray<int> distprocs = GetDistantProcs (i);
-	  int master = ntasks;
-	  for (int j = 0; j < distprocs.Size(); j++)
-	    master = min (master, distprocs[j]);
-	  dist_data.Add (master, data[i]);
-	}
-    
     Array<int> nsend(ntasks), nrecv(ntasks);
     for (int i = 0; i < ntasks; i++)
-      nsend[i] = dist_data[i].Size();
+      {
+        nsend[i] = dofs_by_master[i].Size();
+        nrecv[i] = masterdofs_by_proc[i].Size();
+      }
 
-    MyMPI_AllToAll (nsend, nrecv, comm);
-    Table<T> recv_data(nrecv);
+    Table<T> send_data(nsend), recv_data(nrecv);
 
     Array<MPI_Request> requests; 
-    for (int i = 0; i < ntasks; i++)
+    for (int p : all_dist_procs)
       {
-	if (nsend[i])
-	  requests.Append (MyMPI_ISend (dist_data[i], i, MPI_TAG_SOLVE, comm));
-	if (nrecv[i])
-	  requests.Append (MyMPI_IRecv (recv_data[i], i, MPI_TAG_SOLVE, comm));
+	if (nsend[p])
+          {
+            for (int j = 0; j < nsend[p]; j++)
+              send_data[p][j] = data[dofs_by_master[p][j]];
+            requests.Append (MyMPI_ISend (send_data[p], p, MPI_TAG_SOLVE, comm));
+          }
+	if (nrecv[p])
+	  requests.Append (MyMPI_IRecv (recv_data[p], p, MPI_TAG_SOLVE, comm));
       }
 
     MyMPI_WaitAll (requests);
 
-    Array<int> cnt(ntasks);
-    cnt = 0;
-    
     MPI_Datatype type = MyGetMPIType<T>();
-    for (int i = 0; i < GetNDofLocal(); i++)
-      if (IsMasterDof(i))
-	{
-	  FlatArray<int> distprocs = GetDistantProcs (i);
-	  for (int j = 0; j < distprocs.Size(); j++)
-	    MPI_Reduce_local (&recv_data[distprocs[j]][cnt[distprocs[j]]++], 
-			      &data[i], 1, type, op);
-	}
+    for (int p : all_dist_procs)
+      {
+        FlatArray<int> dofs = masterdofs_by_proc[p];
+        for (int j = 0; j < dofs.Size(); j++)
+          MPI_Reduce_local (&recv_data[p][j], &data[dofs[j]], 1, type, op);
+      }
   }    
 
 
@@ -223,52 +227,39 @@ namespace ngla
   void ParallelDofs :: ScatterDofData (FlatArray<T> data) const
   {
     if (this == NULL) return;
-    MPI_Comm comm = GetCommunicator();
-
-    int ntasks = MyMPI_GetNTasks (comm);
+    int ntasks = GetNTasks ();
     if (ntasks <= 1) return;
 
-    DynamicTable<T> dist_data(ntasks);
-    for (int i = 0; i < GetNDofLocal(); i++)
-      if (IsMasterDof(i))
-	{
-	  FlatArray<int> distprocs = GetDistantProcs (i);
-	  for (int j = 0; j < distprocs.Size(); j++)
-	    dist_data.Add (distprocs[j], data[i]);
-	}
-
     Array<int> nsend(ntasks), nrecv(ntasks);
     for (int i = 0; i < ntasks; i++)
-      nsend[i] = dist_data[i].Size();
-
-    MyMPI_AllToAll (nsend, nrecv, comm);
+      {
+        nsend[i] = masterdofs_by_proc[i].Size();
+        nrecv[i] = dofs_by_master[i].Size();
+      }
 
-    Table<T> recv_data(nrecv);
+    Table<T> send_data(nsend), recv_data(nrecv);
 
     Array<MPI_Request> requests;
-    for (int i = 0; i < ntasks; i++)
+    for (int p : all_dist_procs)
       {
-	if (nsend[i])
-	  requests.Append (MyMPI_ISend (dist_data[i], i, MPI_TAG_SOLVE, comm));
-	if (nrecv[i])
-	  requests.Append (MyMPI_IRecv (recv_data[i], i, MPI_TAG_SOLVE, comm));
+	if (nsend[p])
+          {
+            for (int j = 0; j < nsend[p]; j++)
+              send_data[p][j] = data[masterdofs_by_proc[p][j]];
+            requests.Append (MyMPI_ISend (send_data[p], p, MPI_TAG_SOLVE, comm));
+          }
+	if (nrecv[p])
+	  requests.Append (MyMPI_IRecv (recv_data[p], p, MPI_TAG_SOLVE, comm));
       }
 
     MyMPI_WaitAll (requests);
 
-    Array<int> cnt(ntasks);
-    cnt = 0;
-    
-    for (int i = 0; i < GetNDofLocal(); i++)
-      if (!IsMasterDof(i))
-	{
-	  FlatArray<int> distprocs = GetDistantProcs (i);
-	  
-	  int master = ntasks;
-	  for (int j = 0; j < distprocs.Size(); j++)
-	    master = min (master, distprocs[j]);
-	  data[i] = recv_data[master][cnt[master]++];
-	}
+    for (int p : all_dist_procs)
+      {
+        FlatArray<int> dofs = dofs_by_master[p];
+        for (int j = 0; j < dofs.Size(); j++)
+          data[dofs[j]] = recv_data[p][j];
+      }
   }    
 
 
@@ -8,6 +8,44 @@ using namespace ngla;
 
 
 
+// memory of a linear algebra object handed to numpy, keeps the owner alive
+class PyBufferView
+{
+public:
+  bp::object owner;
+  bp::dict array_interface;
+  int size;
+
+  template <typename T>
+  PyBufferView (bp::object aowner, T * data, int asize)
+    : owner(aowner), array_interface(PyArrayInterface (data, bp::make_tuple (asize))), size(asize) { ; }
+};
+
+// a vector on the memory of an array, the array lives as long as the vector
+template <typename T>
+shared_ptr<BaseVector> VectorFromArray (bp::object array)
+{
+  Array<int> dims;
+  T * data = PyArrayData<T> (array, dims);
+  if (dims.Size() != 1) throw Exception ("vector needs a 1D array");
+  return shared_ptr<BaseVector> (new VFlatVector<T> (dims[0], data),
+                                 [array] (BaseVector * vec) { delete vec; });
+}
+
+template <typename TM>
+bp::object SparseCSR (bp::object self, const SparseMatrixTM<TM> & mat)
+{
+  FlatArray<size_t> firsti = mat.GetFirstArray();
+  FlatArray<int,size_t> colnr = mat.GetColIndices();
+  FlatArray<TM,size_t> vals = mat.GetValues();
+  // the order of scipy.sparse.csr_matrix ((data, indices, indptr)), no element access for nze = 0
+  return bp::make_tuple (PyBufferView (self, vals.Data(), vals.Size()),
+                         PyBufferView (self, colnr.Data(), colnr.Size()),
+                         PyBufferView (self, firsti.Data(), firsti.Size()));
+}
+
+
+
 void NGS_DLL_HEADER ExportNgla() {
     std::string nested_name = "la";
     if( bp::scope() )
@@ -26,9 +64,32 @@ void NGS_DLL_HEADER ExportNgla() {
 
 
   
+  bp::class_<PyBufferView> ("BufferView", bp::no_init)
+    .add_property("__array_interface__", FunctionPointer( [] (PyBufferView & self)
+                                                          { return self.array_interface; }))
+    .def("__len__", FunctionPointer( [] (PyBufferView & self) { return self.size; }))
+    ;
+
   bp::class_<BaseVector, shared_ptr<BaseVector>, boost::noncopyable>("BaseVector", bp::no_init)
+    .def("__init__", bp::make_constructor 
+         (FunctionPointer ([](bp::object array) 
+                           {
+                             if (PyArrayIsComplex (array))
+                               return VectorFromArray<Complex> (array);
+                             return VectorFromArray<double> (array);
+                           })))
     .def("__str__", &ToString<BaseVector>)
     .add_property("size", &BaseVector::Size)
+    .add_property("__array_interface__", FunctionPointer( [] (BaseVector & self)
+                                                          {
+                                                            if (self.IsComplex())
+                                                              {
+                                                                FlatVector<Complex> fv = self.FVComplex();
+                                                                return PyArrayInterface (fv.Data(), bp::make_tuple (fv.Size()));
+                                                              }
+                                                            FlatVector<double> fv = self.FVDouble();
+                                                            return PyArrayInterface (fv.Data(), bp::make_tuple (fv.Size()));
+                                                          }))
     .def("CreateVector", FunctionPointer( [] ( BaseVector & self)
         { return shared_ptr<BaseVector>(self.CreateVector()); } ))
 
@@ -141,6 +202,18 @@ void NGS_DLL_HEADER ExportNgla() {
 				   throw Exception ("COO needs sparse matrix");
                                  }))
 
+    // the compressed row arrays (values, column numbers, row offsets) without copying,
+    // matrices in symmetric storage provide the lower triangle
+    .def("CSR", FunctionPointer( [] (bp::object self) -> bp::object
+                                 {
+                                   BM & m = bp::extract<BM&> (self);
+                                   if (auto sp = dynamic_cast<SparseMatrixTM<double>*> (&m))
+                                     return SparseCSR (self, *sp);
+                                   if (auto sp = dynamic_cast<SparseMatrixTM<Complex>*> (&m))
+                                     return SparseCSR (self, *sp);
+                                   throw Exception ("CSR needs sparse matrix with scalar entries");
+                                 }))
+
     .def("Mult",        FunctionPointer( [](BM &m, BV &x, BV &y, double s) { m.Mult (x,y); y *= s; }) )
     .def("MultAdd",     FunctionPointer( [](BM &m, BV &x, BV &y, double s) { m.MultAdd (s, x, y); }))
     // .def("MultTrans",   FunctionPointer( [](BM &m, BV &x, BV &y, double s) { y  = s*Trans(m)*x; }) )
@@ -150,6 +223,23 @@ void NGS_DLL_HEADER ExportNgla() {
     .def("__mul__" , bp::object(expr_namespace["expr_mul"]) )
     .def("__rmul__" , bp::object(expr_namespace["expr_rmul"]) )
 
+    .def("__matmul__", FunctionPointer( [] (BM & ma, BM & mb) -> shared_ptr<BaseMatrix>
+                                       {
+                                         auto spa = dynamic_cast<SparseMatrixTM<double>*> (&ma);
+                                         auto spb = dynamic_cast<SparseMatrixTM<double>*> (&mb);
+                                         if (spa && spb)
+                                           return MatMult (*spa, *spb);
+                                         auto spca = dynamic_cast<SparseMatrixTM<Complex>*> (&ma);
+                                         auto spcb = dynamic_cast<SparseMatrixTM<Complex>*> (&mb);
+                                         if (spca && spcb)
+                                           return MatMult (*spca, *spcb);
+                                         if (spa && spcb)
+                                           return MatMult (*spa, *spcb);
+                                         if (spca && spb)
+                                           return MatMult (*spca, *spb);
+                                         throw Exception ("matrix product needs sparse matrices");
+                                       }))
+
     .def("__iadd__", FunctionPointer( [] (BM &m, BM &m2) { 
         m.AsVector()+=m2.AsVector();
     }))
@@ -0,0 +1,768 @@
+/*********************************************************************/
+/* File:   saamg.cpp                                                 */
+/*********************************************************************/
+
+/*
+   Smoothed aggregation algebraic multigrid
+*/
+
+#include <la.hpp>
+
+namespace ngla
+{
+
+  inline double ScalarEntry (double val, int i, int j) { return val; }
+
+  template <int N>
+  inline double ScalarEntry (const Mat<N,N,double> & val, int i, int j) { return val(i,j); }
+
+
+  /*
+    Expands a sparse matrix with block entries, symmetric or full storage,
+    to a full scalar matrix. Rows and columns of non-free dofs are replaced
+    by the identity.
+  */
+  template <class TM>
+  static shared_ptr<SparseMatrix<double>>
+  ExpandMatrix (const SparseMatrixTM<TM> & mat, bool symmetric, const BitArray * freedofs)
+  {
+    static Timer t("SAAMG - expand matrix");
+    RegionTimer reg(t);
+
+    const int bs = mat_traits<TM>::HEIGHT;
+    int n = mat.Height();
+
+    // full block graph, the source of every entry (row, index in row)
+    Array<int> cnt(n);
+#pragma omp parallel for
+    for (int i = 0; i < n; i++)
+      cnt[i] = mat.GetRowIndices(i).Size();
+    if (symmetric)
+      {
+#pragma omp parallel for
+        for (int i = 0; i < n; i++)
+          for (int j : mat.GetRowIndices(i))
+            if (j != i) AtomicAdd (cnt[j], 1);
+      }
+
+    Table<INT<2>> source(cnt);
+    cnt = 0;
+#pragma omp parallel for
+    for (int i = 0; i < n; i++)
+      {
+        FlatArray<int> ri = mat.GetRowIndices(i);
+        for (int j = 0; j < ri.Size(); j++)
+          {
+            source[i][AtomicAdd (cnt[i], 1)] = INT<2> (i, j);
+            if (symmetric && ri[j] != i)
+              source[ri[j]][AtomicAdd (cnt[ri[j]], 1)] = INT<2> (i, j);
+          }
+      }
+
+    auto isfree = [&] (int r) { return !freedofs || freedofs->Test(r/bs); };
+
+    // count scalar entries, the diagonal always exists
+    Array<int> scnt(n*bs);
+#pragma omp parallel for
+    for (int i = 0; i < n; i++)
+      for (int c = 0; c < bs; c++)
+        {
+          int r = i*bs+c;
+          if (!isfree(r)) { scnt[r] = 1; continue; }
+          bool hasdiag = false;
+          int rcnt = 0;
+          for (INT<2> src : source[i])
+            {
+              int j = mat.GetRowIndices(src[0])[src[1]];
+              if (src[0] != i) j = src[0];
+              for (int c2 = 0; c2 < bs; c2++)
+                if (isfree(j*bs+c2))
+                  {
+                    rcnt++;
+                    if (j*bs+c2 == r) hasdiag = true;
+                  }
+            }
+          scnt[r] = hasdiag ? rcnt : rcnt+1;
+        }
+
+    auto smat = make_shared<SparseMatrix<double>> (scnt, n*bs);
+
+#pragma omp parallel
+    {
+      Array<int> cols, index;
+      Array<double> vals;
+#pragma omp for
+      for (int i = 0; i < n; i++)
+        for (int c = 0; c < bs; c++)
+          {
+            int r = i*bs+c;
+            cols.SetSize(0);
+            vals.SetSize(0);
+            if (!isfree(r))
+              {
+                cols.Append (r);
+                vals.Append (1.0);
+              }
+            else
+              {
+                bool hasdiag = false;
+                for (INT<2> src : source[i])
+                  {
+                    int j = mat.GetRowIndices(src[0])[src[1]];
+                    const TM & val = mat.GetRowValues(src[0])(src[1]);
+                    bool trans = src[0] != i;
+                    if (trans) j = src[0];
+                    for (int c2 = 0; c2 < bs; c2++)
+                      if (isfree(j*bs+c2))
+                        {
+                          cols.Append (j*bs+c2);
+                          vals.Append (trans ? ScalarEntry(val,c2,c) : ScalarEntry(val,c,c2));
+                          if (j*bs+c2 == r) hasdiag = true;
+                        }
+                  }
+                if (!hasdiag)
+                  {
+                    cols.Append (r);
+                    vals.Append (0.0);
+                  }
+              }
+
+            index.SetSize (cols.Size());
+            for (int k = 0; k < index.Size(); k++) index[k] = k;
+            QuickSortI (cols, index);
+
+            FlatVector<double> rv = smat->GetRowValues(r);
+            for (int k = 0; k < index.Size(); k++)
+              {
+                smat->CreatePosition (r, cols[index[k]]);
+                rv(k) = vals[index[k]];
+              }
+          }
+    }
+    return smat;
+  }
+
+
+
+  SmoothedAggregationAMG ::
+  SmoothedAggregationAMG (const BaseSparseMatrix & amat, const BitArray * afreedofs)
+    : mat(amat), freedofs(afreedofs)
+  {
+    bs = 0;
+    if (dynamic_cast<const SparseMatrixTM<double>*> (&mat)) bs = 1;
+    if (dynamic_cast<const SparseMatrixTM<Mat<2,2,double>>*> (&mat)) bs = 2;
+    if (dynamic_cast<const SparseMatrixTM<Mat<3,3,double>>*> (&mat)) bs = 3;
+    if (bs == 0)
+      throw Exception ("SmoothedAggregationAMG: needs a real sparse matrix with scalar, 2x2 or 3x3 entries");
+  }
+
+
+  SmoothedAggregationAMG :: ~SmoothedAggregationAMG ()
+  {
+    ;
+  }
+
+
+  void SmoothedAggregationAMG ::
+  SetNearNullspace (FlatArray<int> adof2node, FlatArray<double> anullspace, int dim)
+  {
+    if (adof2node.Size() != mat.Height()*bs || anullspace.Size() != adof2node.Size()*dim)
+      throw Exception ("SmoothedAggregationAMG::SetNearNullspace: sizes do not fit");
+
+    dof2node = adof2node;
+    nullspace = anullspace;
+    nullspace_dim = dim;
+  }
+
+
+  shared_ptr<SparseMatrix<double>> SmoothedAggregationAMG :: ScalarMatrix () const
+  {
+    bool symmetric = dynamic_cast<const SparseMatrixSymmetricTM<double>*> (&mat) ||
+      dynamic_cast<const SparseMatrixSymmetricTM<Mat<2,2,double>>*> (&mat) ||
+      dynamic_cast<const SparseMatrixSymmetricTM<Mat<3,3,double>>*> (&mat);
+
+    switch (bs)
+      {
+      case 1: return ExpandMatrix (dynamic_cast<const SparseMatrixTM<double>&> (mat),
+                                   symmetric, freedofs);
+      case 2: return ExpandMatrix (dynamic_cast<const SparseMatrixTM<Mat<2,2,double>>&> (mat),
+                                   symmetric, freedofs);
+      default: return ExpandMatrix (dynamic_cast<const SparseMatrixTM<Mat<3,3,double>>&> (mat),
+                                    symmetric, freedofs);
+      }
+  }
+
+
+  // pseudo-random priority for the independent set, unique per node
+  inline size_t AggregationKey (int i)
+  {
+    unsigned int h = unsigned(i) * 2654435761u;
+    h ^= h >> 16;
+    return (size_t(h) << 32) + size_t(i) + 1;
+  }
+
+
+  /*
+    Aggregates the nodes of the strength graph around the roots of a
+    distance-2 maximal independent set. The set is found by Luby-type
+    rounds, where a node becomes a root if its key is maximal among the
+    undecided nodes within distance 2. Nodes without strong neighbours
+    are not aggregated (-1).
+  */
+  static int Aggregate (const Table<int> & graph, Array<int> & agg)
+  {
+    static Timer t("SAAMG - aggregate");
+    RegionTimer reg(t);
+
+    enum { UNDECIDED, ROOT, COVERED, ISOLATED };
+    int nn = graph.Size();
+    Array<int> state(nn);
+    Array<size_t> m1(nn), m2(nn);
+
+#pragma omp parallel for
+    for (int i = 0; i < nn; i++)
+      state[i] = graph[i].Size() ? UNDECIDED : ISOLATED;
+
+    while (true)
+      {
+        int undecided = 0;
+#pragma omp parallel for reduction(+:undecided)
+        for (int i = 0; i < nn; i++)
+          if (state[i] == UNDECIDED) undecided++;
+        if (!undecided) break;
+
+#pragma omp parallel for
+        for (int i = 0; i < nn; i++)
+          {
+            size_t m = (state[i] == UNDECIDED) ? AggregationKey(i) : 0;
+            for (int j : graph[i])
+              if (state[j] == UNDECIDED)
+                m = max2 (m, AggregationKey(j));
+            m1[i] = m;
+          }
+#pragma omp parallel for
+        for (int i = 0; i < nn; i++)
+          {
+            size_t m = m1[i];
+            for (int j : graph[i])
+              m = max2 (m, m1[j]);
+            m2[i] = m;
+          }
+#pragma omp parallel for
+        for (int i = 0; i < nn; i++)
+          if (state[i] == UNDECIDED && m2[i] == AggregationKey(i))
+            state[i] = ROOT;
+
+        // cover everything within distance 2 of a root
+#pragma omp parallel for
+        for (int i = 0; i < nn; i++)
+          {
+            size_t near = (state[i] == ROOT);
+            for (int j : graph[i])
+              if (state[j] == ROOT) near = 1;
+            m1[i] = near;
+          }
+#pragma omp parallel for
+        for (int i = 0; i < nn; i++)
+          if (state[i] == UNDECIDED)
+            {
+              bool near = m1[i];
+              for (int j : graph[i])
+                if (m1[j]) near = true;
+              if (near) state[i] = COVERED;
+            }
+      }
+
+    agg.SetSize (nn);
+    int naggs = 0;
+    for (int i = 0; i < nn; i++)
+      agg[i] = (state[i] == ROOT) ? naggs++ : -1;
+
+    // neighbours of roots join the root with the largest key
+    Array<int> agg1(nn);
+#pragma omp parallel for
+    for (int i = 0; i < nn; i++)
+      {
+        agg1[i] = agg[i];
+        if (state[i] != COVERED) continue;
+        size_t best = 0;
+        for (int j : graph[i])
+          if (state[j] == ROOT && AggregationKey(j) > best)
+            {
+              best = AggregationKey(j);
+              agg1[i] = agg[j];
+            }
+      }
+
+    // remaining nodes join an aggregate of a neighbour
+#pragma omp parallel for
+    for (int i = 0; i < nn; i++)
+      {
+        agg[i] = agg1[i];
+        if (state[i] != COVERED || agg1[i] != -1) continue;
+        for (int j : graph[i])
+          if (agg1[j] != -1)
+            {
+              agg[i] = agg1[j];
+              break;
+            }
+      }
+    return naggs;
+  }
+
+
+
+  void SmoothedAggregationAMG :: Setup ()
+  {
+    static Timer t("SAAMG - setup");
+    static Timer tstrength("SAAMG - strength graph");
+    static Timer ttent("SAAMG - tentative prolongation");
+    static Timer tsmooth("SAAMG - smooth prolongation");
+    static Timer trap("SAAMG - Galerkin product");
+    static Timer tcoarse("SAAMG - coarse inverse");
+    RegionTimer reg(t);
+
+    auto A = ScalarMatrix();
+    int ns = A->Height();
+
+    Array<int> d2n;
+    Array<double> B;
+    int k = nullspace_dim;
+    if (dof2node.Size())
+      {
+        d2n = dof2node;
+        B = nullspace;
+      }
+    else
+      {
+        // constant per component
+        k = bs;
+        d2n.SetSize (ns);
+        B.SetSize (ns*k);
+        B = 0.0;
+        for (int r = 0; r < ns; r++)
+          {
+            d2n[r] = r / bs;
+            B[r*k + r%bs] = 1;
+          }
+      }
+
+    levels.SetSize(0);
+    coarseinv = nullptr;
+
+    while (true)
+      {
+        auto lev = make_shared<Level>();
+        lev->mat = A;
+        int n = A->Height();
+
+        // inverse diagonal and largest eigenvalue of D^{-1} A
+        lev->diaginv.SetSize (n);
+#pragma omp parallel for
+        for (int i = 0; i < n; i++)
+          {
+            double d = (*A)(i,i);
+            lev->diaginv[i] = (d != 0) ? 1.0/d : 1.0;
+          }
+
+        VVector<double> v(n), w(n);
+        FlatVector<double> fv = v.FV(), fw = w.FV();
+        // pseudo-random start vector, contains the oscillating modes
+        for (int i = 0; i < n; i++)
+          fv(i) = double(AggregationKey(i) >> 32) / 4294967296.0 - 0.5;
+        double lam = 1;
+        for (int it = 0; it < 20; it++)
+          {
+            double nv = L2Norm (fv);
+            if (nv == 0) break;
+            fv /= nv;
+            A->Mult (v, w);
+#pragma omp parallel for
+            for (int i = 0; i < n; i++)
+              fw(i) *= lev->diaginv[i];
+            lam = L2Norm (fw);
+            fv = fw;
+          }
+        lev->lam_max = lam;
+
+        if (smoother == GAUSS_SEIDEL)
+          lev->gs = A->CreateJacobiPrecond(nullptr);
+
+        levels.Append (lev);
+
+        if (n <= mincoarse || levels.Size() >= maxlevels) break;
+
+
+        // strength graph of the nodes
+        tstrength.Start();
+        int nn = 0;
+        for (int r = 0; r < n; r++)
+          nn = max2 (nn, d2n[r]+1);
+
+        Array<int> cnt(nn);
+        cnt = 0;
+        for (int r = 0; r < n; r++)
+          cnt[d2n[r]]++;
+        Table<int> node2dofs(cnt);
+        cnt = 0;
+        for (int r = 0; r < n; r++)
+          node2dofs[d2n[r]][cnt[d2n[r]]++] = r;
+
+        Array<double> diag(n);
+#pragma omp parallel for
+        for (int i = 0; i < n; i++)
+          diag[i] = fabs ((*A)(i,i));
+
+        auto strong_neighbours = [&] (int p, Array<int> & marks, Array<int> & nbs)
+          {
+            nbs.SetSize(0);
+            for (int r : node2dofs[p])
+              {
+                FlatArray<int> ri = A->GetRowIndices(r);
+                FlatVector<double> rv = A->GetRowValues(r);
+                for (int j = 0; j < ri.Size(); j++)
+                  {
+                    int q = d2n[ri[j]];
+                    if (q == p || marks[q] == p) continue;
+                    if (fabs(rv(j)) >= theta * sqrt (diag[r]*diag[ri[j]]) && rv(j) != 0)
+                      {
+                        marks[q] = p;
+                        nbs.Append (q);
+                      }
+                  }
+              }
+          };
+
+#pragma omp parallel
+        {
+          Array<int> marks(nn), nbs;
+          marks = -1;
+#pragma omp for
+          for (int p = 0; p < nn; p++)
+            {
+              strong_neighbours (p, marks, nbs);
+              cnt[p] = nbs.Size();
+            }
+        }
+        Table<int> graph(cnt);
+#pragma omp parallel
+        {
+          Array<int> marks(nn), nbs;
+          marks = -1;
+#pragma omp for
+          for (int p = 0; p < nn; p++)
+            {
+              strong_neighbours (p, marks, nbs);
+              QuickSort (nbs);
+              graph[p] = nbs;
+            }
+        }
+        tstrength.Stop();
+
+        Array<int> agg;
+        int naggs = Aggregate (graph, agg);
+        if (naggs == 0) break;
+
+
+        // tentative prolongation, QR decomposition of the nullspace per aggregate
+        ttent.Start();
+        Array<int> acnt(naggs);
+        acnt = 0;
+        for (int r = 0; r < n; r++)
+          if (agg[d2n[r]] != -1)
+            acnt[agg[d2n[r]]]++;
+        Table<int> agg2dofs(acnt);
+        acnt = 0;
+        for (int r = 0; r < n; r++)
+          {
+            int a = agg[d2n[r]];
+            if (a != -1) agg2dofs[a][acnt[a]++] = r;
+          }
+
+        for (int a = 0; a < naggs; a++)
+          acnt[a] = agg2dofs[a].Size() * k;
+        Table<double> qtab(acnt);
+        for (int a = 0; a < naggs; a++)
+          acnt[a] = k*k;
+        Table<double> rtab(acnt);
+        Array<int> rank(naggs);
+
+#pragma omp parallel for
+        for (int a = 0; a < naggs; a++)
+          {
+            FlatArray<int> dofs = agg2dofs[a];
+            int m = dofs.Size();
+            FlatMatrix<double> q(m, k, &qtab[a][0]);
+            FlatMatrix<double> rmat(k, k, &rtab[a][0]);
+            rmat = 0.0;
+
+            int r = 0;
+            for (int l = 0; l < k; l++)
+              {
+                for (int i = 0; i < m; i++)
+                  q(i,r) = B[dofs[i]*k+l];
+                double norm0 = 0;
+                for (int i = 0; i < m; i++)
+                  norm0 += sqr (q(i,r));
+                norm0 = sqrt (norm0);
+
+                for (int p = 0; p < r; p++)
+                  {
+                    double sum = 0;
+                    for (int i = 0; i < m; i++)
+                      sum += q(i,p) * q(i,r);
+                    rmat(p,l) = sum;
+                    for (int i = 0; i < m; i++)
+                      q(i,r) -= sum * q(i,p);
+                  }
+
+                double norm = 0;
+                for (int i = 0; i < m; i++)
+                  norm += sqr (q(i,r));
+                norm = sqrt (norm);
+
+                if (norm > 1e-10 * norm0 && norm > 0)
+                  {
+                    for (int i = 0; i < m; i++)
+                      q(i,r) /= norm;
+                    rmat(r,l) = norm;
+                    r++;
+                  }
+              }
+            rank[a] = r;
+          }
+
+        Array<int> first(naggs+1);
+        first[0] = 0;
+        for (int a = 0; a < naggs; a++)
+          first[a+1] = first[a] + rank[a];
+        int nc = first[naggs];
+
+        Array<int> pcnt(n);
+#pragma omp parallel for
+        for (int r = 0; r < n; r++)
+          pcnt[r] = (agg[d2n[r]] != -1) ? rank[agg[d2n[r]]] : 0;
+
+        SparseMatrix<double> ptent(pcnt, nc);
+        Array<int> cd2n(nc);
+        Array<double> cB(nc*k);
+
+#pragma omp parallel for
+        for (int a = 0; a < naggs; a++)
+          {
+            FlatArray<int> dofs = agg2dofs[a];
+            FlatMatrix<double> q(dofs.Size(), k, &qtab[a][0]);
+            FlatMatrix<double> rmat(k, k, &rtab[a][0]);
+            for (int i = 0; i < dofs.Size(); i++)
+              for (int p = 0; p < rank[a]; p++)
+                ptent(dofs[i], first[a]+p) = q(i,p);
+            for (int p = 0; p < rank[a]; p++)
+              {
+                cd2n[first[a]+p] = a;
+                for (int l = 0; l < k; l++)
+                  cB[(first[a]+p)*k+l] = rmat(p,l);
+              }
+          }
+        ttent.Stop();
+
+        if (nc == 0 || nc > 0.9 * n) break;
+
+
+        // smoothed prolongation P = (I - omega D^{-1} A) P_tent
+        tsmooth.Start();
+        double omega = 4.0 / (3.0 * lev->lam_max);
+        auto prol = MatMult (*A, ptent);
+#pragma omp parallel for
+        for (int r = 0; r < n; r++)
+          {
+            FlatVector<double> pv = prol->GetRowValues(r);
+            pv *= -omega * lev->diaginv[r];
+            FlatArray<int> ri = ptent.GetRowIndices(r);
+            FlatVector<double> rv = ptent.GetRowValues(r);
+            for (int j = 0; j < ri.Size(); j++)
+              {
+                size_t pos = prol->GetPositionTest (r, ri[j]);
+                if (pos != numeric_limits<size_t>::max())
+                  (*prol)[pos] += rv(j);
+              }
+          }
+        tsmooth.Stop();
+
+        trap.Start();
+        auto restr = TransposeMatrix (*prol);
+        auto coarsemat = RAP (*restr, *A, *prol);
+        trap.Stop();
+
+        lev->prol = prol;
+        lev->restr = restr;
+
+        cout << IM(4) << "SAAMG level " << levels.Size()-1 << ": " << n << " dofs, "
+             << A->NZE() << " nze, " << naggs << " aggregates" << endl;
+
+        A = coarsemat;
+        d2n = move(cd2n);
+        B = move(cB);
+      }
+
+    RegionTimer regc(tcoarse);
+    levels.Last()->mat->SetInverseType (SPARSECHOLESKY);
+    coarseinv = levels.Last()->mat->InverseMatrix();
+
+    cout << IM(3) << "SAAMG: " << levels.Size() << " levels, coarse size = "
+         << levels.Last()->mat->Height()
+         << ", operator complexity = " << OperatorComplexity() << endl;
+  }
+
+
+  double SmoothedAggregationAMG :: OperatorComplexity () const
+  {
+    if (!levels.Size()) return 0;
+    double sum = 0;
+    for (auto & lev : levels)
+      sum += lev->mat->NZE();
+    return sum / levels[0]->mat->NZE();
+  }
+
+
+  void SmoothedAggregationAMG ::
+  Smooth (int level, FlatVector<double> x, FlatVector<double> b, bool back) const
+  {
+    static Timer t("SAAMG - smooth");
+    RegionTimer reg(t);
+
+    const Level & lev = *levels[level];
+    const SparseMatrix<double> & A = *lev.mat;
+    int n = A.Height();
+    VFlatVector<double> vx(n, &x(0)), vb(n, &b(0));
+
+    if (smoother == GAUSS_SEIDEL)
+      {
+        for (int k = 0; k < smoothingsteps; k++)
+          if (back)
+            lev.gs->GSSmoothBack (vx, vb);
+          else
+            lev.gs->GSSmooth (vx, vb);
+        return;
+      }
+
+    VVector<double> vr(n);
+    FlatVector<double> r = vr.FV();
+
+    if (smoother == JACOBI)
+      {
+        double omega = 4.0 / (3.0 * lev.lam_max);
+        for (int k = 0; k < smoothingsteps; k++)
+          {
+            vr = vb - A * vx;
+#pragma omp parallel for
+            for (int i = 0; i < n; i++)
+              x(i) += omega * lev.diaginv[i] * r(i);
+          }
+        return;
+      }
+
+    // Chebyshev iteration for D^{-1} A on [lam_max/30, 1.1 lam_max]
+    double upper = 1.1 * lev.lam_max, lower = upper / 30;
+    double theta = 0.5 * (upper+lower), delta = 0.5 * (upper-lower);
+    double sigma = theta / delta, rho = 1/sigma;
+
+    VVector<double> vd(n), vad(n);
+    FlatVector<double> d = vd.FV(), ad = vad.FV();
+
+    vr = vb - A * vx;
+#pragma omp parallel for
+    for (int i = 0; i < n; i++)
+      {
+        r(i) *= lev.diaginv[i];
+        d(i) = r(i) / theta;
+      }
+
+    for (int k = 0; k < smoothingsteps; k++)
+      {
+        double rhonew = 1.0 / (2*sigma - rho);
+        A.Mult (vd, vad);
+#pragma omp parallel for
+        for (int i = 0; i < n; i++)
+          {
+            x(i) += d(i);
+            r(i) -= lev.diaginv[i] * ad(i);
+            d(i) = rhonew * rho * d(i) + 2 * rhonew / delta * r(i);
+          }
+        rho = rhonew;
+      }
+  }
+
+
+  void SmoothedAggregationAMG ::
+  MGM (int level, FlatVector<double> x, FlatVector<double> b) const
+  {
+    const Level & lev = *levels[level];
+    int n = lev.mat->Height();
+    VFlatVector<double> vx(n, &x(0)), vb(n, &b(0));
+
+    if (level == levels.Size()-1)
+      {
+        vx = (*coarseinv) * vb;
+        return;
+      }
+
+    int nc = lev.prol->Width();
+    VVector<double> vr(n), vxc(nc), vbc(nc);
+
+    x = 0.0;
+    Smooth (level, x, b, false);
+
+    vr = vb - (*lev.mat) * vx;
+    lev.restr->Mult (vr, vbc);
+    MGM (level+1, vxc.FV(), vbc.FV());
+    lev.prol->MultAdd (1, vxc, vx);
+
+    Smooth (level, x, b, true);
+  }
+
+
+  void SmoothedAggregationAMG :: Mult (const BaseVector & x, BaseVector & y) const
+  {
+    y = 0.0;
+    MultAdd (1, x, y);
+  }
+
+
+  void SmoothedAggregationAMG :: MultAdd (double s, const BaseVector & x, BaseVector & y) const
+  {
+    static Timer t("SAAMG - apply");
+    RegionTimer reg(t);
+
+    FlatVector<double> fx = x.FVDouble();
+    FlatVector<double> fy = y.FVDouble();
+    int ns = fx.Size();
+
+    Vector<double> b(ns), u(ns);
+#pragma omp parallel for
+    for (int r = 0; r < ns; r++)
+      b(r) = (!freedofs || freedofs->Test(r/bs)) ? fx(r) : 0.0;
+
+    MGM (0, u, b);
+
+#pragma omp parallel for
+    for (int r = 0; r < ns; r++)
+      if (!freedofs || freedofs->Test(r/bs))
+        fy(r) += s * u(r);
+  }
+
+
+  void SmoothedAggregationAMG :: MemoryUsage (Array<MemoryUsageStruct*> & mu) const
+  {
+    size_t nbytes = 0;
+    int nblocks = 0;
+    for (auto & lev : levels)
+      for (auto m : { lev->mat, lev->prol, lev->restr })
+        if (m)
+          {
+            nbytes += m->NZE() * (sizeof(double)+sizeof(int));
+            nblocks += 2;
+          }
+    mu.Append (new MemoryUsageStruct ("SAAMG", nbytes, nblocks));
+  }
+
+}
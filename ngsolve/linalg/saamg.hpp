@@ -0,0 +1,96 @@
+#ifndef FILE_SAAMG
+#define FILE_SAAMG
+
+/* *************************************************************************/
+/* File:   saamg.hpp                                                       */
+/* *************************************************************************/
+
+namespace ngla
+{
+
+  /**
+     Smoothed aggregation algebraic multigrid.
+
+     Works on the scalar entries of a SparseMatrixTM<double> or
+     SparseMatrixTM<Mat<N,N>>, symmetric or full storage. Scalar dofs are
+     grouped to nodes, which are aggregated. The near-nullspace (default:
+     constant per component) is given per scalar dof.
+  */
+  class NGS_DLL_HEADER SmoothedAggregationAMG : public BaseMatrix
+  {
+  public:
+    enum SMOOTHER { JACOBI, GAUSS_SEIDEL, CHEBYSHEV };
+
+  protected:
+    struct Level
+    {
+      shared_ptr<SparseMatrix<double>> mat, prol, restr;
+      Array<double> diaginv;
+      double lam_max;
+      shared_ptr<BaseJacobiPrecond> gs;
+    };
+
+    const BaseSparseMatrix & mat;
+    const BitArray * freedofs;
+    /// scalar entries per matrix entry
+    int bs;
+
+    Array<shared_ptr<Level>> levels;
+    shared_ptr<BaseMatrix> coarseinv;
+
+    Array<int> dof2node;
+    Array<double> nullspace;
+    int nullspace_dim = 0;
+
+    double theta = 0.08;
+    int maxlevels = 20;
+    int mincoarse = 500;
+    SMOOTHER smoother = CHEBYSHEV;
+    int smoothingsteps = 2;
+
+  public:
+    SmoothedAggregationAMG (const BaseSparseMatrix & amat, const BitArray * afreedofs = NULL);
+    virtual ~SmoothedAggregationAMG ();
+
+    /**
+       Node number of every scalar dof, and the near-nullspace, one row of
+       length dim per scalar dof.
+     */
+    void SetNearNullspace (FlatArray<int> adof2node, FlatArray<double> anullspace, int dim);
+
+    void SetStrengthThreshold (double atheta) { theta = atheta; }
+    void SetMaxLevels (int amaxlevels) { maxlevels = amaxlevels; }
+    void SetMinCoarseSize (int amincoarse) { mincoarse = amincoarse; }
+    void SetSmoother (SMOOTHER asmoother, int steps)
+    { smoother = asmoother; smoothingsteps = steps; }
+
+    /// builds the hierarchy
+    void Setup ();
+
+    int GetNLevels () const { return levels.Size(); }
+    /// sum of non-zeros of all levels, relative to the finest level
+    double OperatorComplexity () const;
+
+    virtual int VHeight() const { return mat.Height(); }
+    virtual int VWidth() const { return mat.Width(); }
+    virtual bool IsComplex() const { return false; }
+
+    virtual AutoVector CreateVector () const
+    {
+      return mat.CreateVector();
+    }
+
+    virtual void Mult (const BaseVector & x, BaseVector & y) const;
+    virtual void MultAdd (double s, const BaseVector & x, BaseVector & y) const;
+
+    virtual void MemoryUsage (Array<MemoryUsageStruct*> & mu) const;
+
+  protected:
+    shared_ptr<SparseMatrix<double>> ScalarMatrix () const;
+    void Smooth (int level, FlatVector<double> x, FlatVector<double> b, bool back) const;
+    void MGM (int level, FlatVector<double> x, FlatVector<double> b) const;
+  };
+
+}
+
+#endif
@@ -867,6 +867,7 @@ namespace ngla
     else if (ainversetype == "superlu_dist")  SetInverseType ( SUPERLU_DIST );
     else if (ainversetype == "mumps")         SetInverseType ( MUMPS );
     else if (ainversetype == "masterinverse") SetInverseType ( MASTERINVERSE );
+    else if (ainversetype == "distributedinverse") SetInverseType ( DISTRIBUTEDINVERSE );
     else SetInverseType ( SPARSECHOLESKY );
     return old_invtype;
   }
@@ -982,6 +983,66 @@ namespace ngla
   }
   
 
+  template <class TM>
+  void SparseMatrixTM<TM> ::
+  AddElementMatrixAtomic(const FlatArray<int> & dnums1, const FlatArray<int> & dnums2, 
+                         const FlatMatrix<TSCAL> & elmat1)
+  {
+    ArrayMem<int, 50> map(dnums2.Size());
+    for (int i = 0; i < map.Size(); i++) map[i] = i;
+    QuickSortI (dnums2, map);
+
+    Scalar2ElemMatrix<TM, TSCAL> elmat (elmat1);
+
+    for (int i = 0; i < dnums1.Size(); i++)
+      if (dnums1[i] != -1)
+	{
+	  FlatArray<int> rowind = this->GetRowIndices(dnums1[i]);
+	  FlatVector<TM> rowvals = this->GetRowValues(dnums1[i]);
+	  
+	  int k = 0;
+	  for (int j1 = 0; j1 < dnums2.Size(); j1++)
+	    {
+	      int j = map[j1];
+	      if (dnums2[j] != -1)
+		{
+		  while (rowind[k] != dnums2[j])
+		    {
+		      k++;
+		      if (k >= rowind.Size())
+			throw Exception ("SparseMatrixTM::AddElementMatrixAtomic: illegal dnums");
+		    }
+		  AtomicAdd (rowvals(k), elmat(i,j));
+		}
+	    }
+	}
+  }
+
+
+  template <class TM>
+  void SparseMatrixTM<TM> ::
+  AddElementMatrixAt (FlatArray<int> pos, FlatArray<int> dnums1, FlatArray<int> dnums2,
+                      const FlatMatrix<TSCAL> & elmat1, bool atomic)
+  {
+    Scalar2ElemMatrix<TM, TSCAL> elmat (elmat1);
+
+    int n2 = dnums2.Size();
+    for (int i = 0; i < dnums1.Size(); i++)
+      if (dnums1[i] != -1)
+        {
+          FlatArray<int> posi = pos.Range (i*n2, (i+1)*n2);
+          for (int j = 0; j < n2; j++)
+            if (posi[j] != -1 && dnums2[j] != -1)
+              {
+                if (atomic)
+                  AtomicAdd (data[posi[j]], elmat(i,j));
+                else
+                  data[posi[j]] += elmat(i,j);
+              }
+        }
+  }
+
+
   template <class TM>
   void SparseMatrixTM<TM> :: SetZero ()
   {
@@ -1043,6 +1104,25 @@ namespace ngla
   }
   
 
+  template <class TM, class TV_ROW, class TV_COL>
+  void SparseMatrix<TM,TV_ROW,TV_COL> ::
+  MultAddRows (double s, const BaseVector & x, BaseVector & y,
+               FlatArray<int> rows) const
+  {
+    static Timer timer("SparseMatrix::MultAddRows");
+    RegionTimer reg (timer);
+
+    FlatVector<TVX> fx = x.FV<TVX>(); 
+    FlatVector<TVY> fy = y.FV<TVY>(); 
+
+#pragma omp parallel for
+    for (int k = 0; k < rows.Size(); k++)
+      {
+        int i = rows[k];
+        fy(i) += s * RowTimesVector (i, fx);
+      }
+  }
+
   template <class TM, class TV_ROW, class TV_COL>
   void SparseMatrix<TM,TV_ROW,TV_COL> ::
   MultTransAdd (double s, const BaseVector & x, BaseVector & y) const
@@ -1285,6 +1365,128 @@ namespace ngla
   }
   
   
+  template <class TM>
+  void SparseMatrixSymmetricTM<TM> ::
+  AddElementMatrixAtomic(const FlatArray<int> & dnums, const FlatArray<int> & dnums2,
+                         const FlatMatrix<TSCAL> & elmat1)
+  {
+    ArrayMem<int, 50> map(dnums.Size());
+    for (int i = 0; i < map.Size(); i++) map[i] = i;
+    QuickSortI (dnums, map);
+
+    Scalar2ElemMatrix<TM, TSCAL> elmat (elmat1);
+
+    int first_used = 0;
+    while (first_used < dnums.Size() && dnums[map[first_used]] == -1) first_used++;
+    
+    for (int i1 = first_used; i1 < dnums.Size(); i1++)
+      {
+	FlatArray<int> rowind = this->GetRowIndices(dnums[map[i1]]);
+	FlatVector<TM> rowvals = this->GetRowValues(dnums[map[i1]]);
+
+	for (int j1 = first_used, k = 0; j1 <= i1; j1++, k++)
+	  {
+	    while (rowind[k] != dnums[map[j1]])
+	      {
+		k++;
+		if (k >= rowind.Size())
+		  throw Exception ("SparseMatrixSymmetricTM::AddElementMatrixAtomic: illegal dnums");
+	      }
+	    AtomicAdd (rowvals(k), elmat(map[i1], map[j1]));
+	  }
+      }
+  }
+
+
+
+  template <class TM>
+  SparseMatrixAssemblyBuffer<TM> :: 
+  SparseMatrixAssemblyBuffer (SparseMatrixTM<TM> & amat, size_t amaxentries)
+    : mat(amat), maxentries(amaxentries), 
+      locks(amat.Height()/ROWBLOCK+1), buffers(omp_get_max_threads())
+  {
+    lower = dynamic_cast<SparseMatrixSymmetricTM<TM>*> (&mat) != NULL;
+    for (auto & l : locks) l = 0;
+  }
+
+  template <class TM>
+  void SparseMatrixAssemblyBuffer<TM> :: 
+  AddElementMatrix (FlatArray<int> dnums1, FlatArray<int> dnums2,
+                    FlatMatrix<TSCAL> elmat1)
+  {
+    ThreadBuffer & buf = buffers[omp_get_thread_num()];
+    Scalar2ElemMatrix<TM, TSCAL> elmat (elmat1);
+    size_t w = mat.Width();
+
+    for (int i = 0; i < dnums1.Size(); i++)
+      if (dnums1[i] != -1)
+        for (int j = 0; j < dnums2.Size(); j++)
+          if (dnums2[j] != -1 && (!lower || dnums2[j] <= dnums1[i]))
+            {
+              buf.keys.Append (size_t(dnums1[i]) * w + dnums2[j]);
+              buf.vals.Append (elmat(i,j));
+            }
+
+    if (size_t(buf.keys.Size()) >= maxentries)
+      Flush();
+  }
+
+  template <class TM>
+  void SparseMatrixAssemblyBuffer<TM> :: Flush ()
+  {
+    static Timer timer ("SparseMatrixAssemblyBuffer::Flush", 1);
+    RegionTimer reg (timer);
+
+    ThreadBuffer & buf = buffers[omp_get_thread_num()];
+    int n = buf.keys.Size();
+    if (n == 0) return;
+
+    Array<int> index(n);
+    for (int i = 0; i < n; i++) index[i] = i;
+    QuickSortI (buf.keys, index);
+
+    size_t w = mat.Width();
+    int first = 0;
+    while (first < n)
+      {
+        int block = int (buf.keys[index[first]] / w) / ROWBLOCK;
+        while (locks[block].exchange (1, memory_order_acquire))
+          ;
+
+        // merge all entries of this block of rows, entries are sorted by row and column
+        int i = first;
+        while (i < n && int (buf.keys[index[i]] / w) / ROWBLOCK == block)
+          {
+            int row = buf.keys[index[i]] / w;
+            FlatArray<int> rowind = mat.GetRowIndices(row);
+            FlatVector<TM> rowvals = mat.GetRowValues(row);
+
+            int k = 0;
+            for ( ; i < n && int (buf.keys[index[i]] / w) == row; i++)
+              {
+                int col = buf.keys[index[i]] % w;
+                while (rowind[k] != col)
+                  {
+                    k++;
+                    if (k >= rowind.Size())
+                      {
+                        locks[block].store (0, memory_order_release);
+                        throw Exception ("SparseMatrixAssemblyBuffer::Flush: illegal dnums");
+                      }
+                  }
+                rowvals(k) += buf.vals[index[i]];
+              }
+          }
+
+        locks[block].store (0, memory_order_release);
+        first = i;
+      }
+
+    buf.keys.SetSize(0);
+    buf.vals.SetSize(0);
+  }
+
+
   template <class TM, class TV>
   SparseMatrixSymmetric<TM,TV> :: 
   SparseMatrixSymmetric (const MatrixGraph & agraph, bool stealgraph)
@@ -1317,6 +1519,24 @@ namespace ngla
       }
   }
 
+  template <class TM, class TV>
+  void SparseMatrixSymmetric<TM,TV> :: 
+  MultAddRows (double s, const BaseVector & x, BaseVector & y,
+               FlatArray<int> rows) const
+  {
+    static Timer timer("SparseMatrixSymmetric::MultAddRows");
+    RegionTimer reg (timer);
+
+    const FlatVector<TV_ROW> fx = x.FV<TV_ROW>();
+    FlatVector<TV_COL> fy = y.FV<TV_COL>();
+
+    for (int i : rows)
+      {
+	fy(i) += s * RowTimesVector (i, fx);
+	AddRowTransToVectorNoDiag (i, s * fx(i), fy);
+      }
+  }
+
   template <class TM, class TV>
   void SparseMatrixSymmetric<TM,TV> :: 
   MultAdd1 (double s, const BaseVector & x, BaseVector & y,
@@ -1409,291 +1629,400 @@ namespace ngla
 
 
 
-  template <class TM, class TV>
-  BaseSparseMatrix * 
-  SparseMatrixSymmetric<TM,TV> :: Restrict (const SparseMatrixTM<double> & prol,
-					    BaseSparseMatrix* acmat ) const
+  /* ************************* sparse matrix products ************************* */
+
+  /*
+    The products are computed row by row in parallel: a symbolic pass
+    counts the entries per row and creates the sorted graph, the numeric
+    pass accumulates directly into the matrix row, addressed by a dense
+    column -> position map of the calling thread.
+  */
+
+  // the transposed matrix; strict: only the strictly lower triangle of mat
+  template <typename TM>
+  static shared_ptr<SparseMatrix<TM>> TransposeKernel (const SparseMatrixTM<TM> & mat, bool strict)
   {
-    static Timer t ("sparsematrix - restrict");
-    static Timer tbuild ("sparsematrix - restrict, build matrix");
-    static Timer tcomp ("sparsematrix - restrict, compute matrix");
+    static Timer t("sparse matrix transpose");
     RegionTimer reg(t);
-    
-    int n = this->Height();
 
-    SparseMatrixSymmetric<TM,TV>* cmat = 
-      dynamic_cast< SparseMatrixSymmetric<TM,TV>* > ( acmat );
- 
-    // if no coarse matrix, build up matrix-graph!
-    if ( !cmat )
+    int h = mat.Height(), w = mat.Width();
+
+    Array<int> cnt(w);
+    cnt = 0;
+#pragma omp parallel for
+    for (int i = 0; i < h; i++)
+      for (int c : mat.GetRowIndices(i))
+        if (!strict || c < i)
+          AtomicAdd (cnt[c], 1);
+
+    Table<int> rows(cnt);
+    Table<int> positions(cnt);
+    cnt = 0;
+#pragma omp parallel for
+    for (int i = 0; i < h; i++)
       {
-        RegionTimer reg(tbuild);
+        FlatArray<int> ri = mat.GetRowIndices(i);
+        size_t first = mat.First(i);
+        for (int j = 0; j < ri.Size(); j++)
+          if (!strict || ri[j] < i)
+            {
+              int pos = AtomicAdd (cnt[ri[j]], 1);
+              rows[ri[j]][pos] = i;
+              positions[ri[j]][pos] = first+j;
+            }
+      }
 
-	Array<int> marks(n);
-	Array<INT<2> > e2v;
-	for (int i = 0; i < n; i++)
-	  for (int j = 0; j < this->GetRowIndices(i).Size(); j++)
-	    {
-	      int col = this->GetRowIndices(i)[j];
-	      FlatArray<int> prol_rowind = prol.GetRowIndices(i);
-	      FlatArray<int> prol_colind = prol.GetRowIndices(col);
+    auto trans = make_shared<SparseMatrix<TM>> (cnt, h);
 
-	      for (int k = 0; k < prol_rowind.Size(); k++)
-		for (int l = 0; l < prol_colind.Size(); l++)
-		  {
-		    int kk = prol_rowind[k];
-		    int ll = prol_colind[l];
-		    
-		    if (kk >= ll) swap (kk,ll);
-		    e2v.Append (INT<2> (kk,ll));
-		  }
-	    }
+#pragma omp parallel
+    {
+      Array<int> index;
+#pragma omp for
+      for (int i = 0; i < w; i++)
+        {
+          index.SetSize (rows[i].Size());
+          for (int j = 0; j < index.Size(); j++) index[j] = j;
+          QuickSortI (rows[i], index);
 
-	int nc = 0;
-	for (int i = 0; i < e2v.Size(); i++)
-	  nc = max2 (nc, e2v[i][1]);
-	nc++;
+          FlatVector<TM> tv = trans->GetRowValues(i);
+          for (int j = 0; j < index.Size(); j++)
+            {
+              trans->CreatePosition (i, rows[i][index[j]]);
+              tv(j) = Trans (mat[positions[i][index[j]]]);
+            }
+        }
+    }
+    return trans;
+  }
 
-	// *testout << "e2v = " << endl << e2v << endl;
-        
-        // count all entries in row with multiplicity
-	Array<int> cnt(nc);
-	cnt = 0;
-	for (int i = 0; i < e2v.Size(); i++)
-	  cnt[e2v[i][1]]++;
-
-	Table<int> v2e(cnt);
-	cnt = 0;
-	for (int i = 0; i < e2v.Size(); i++)
-	  {
-	    int v1 = e2v[i][1];
-	    v2e[v1][cnt[v1]++] = i;
-	  }
-	
-	cnt = 0;
-	marks = -1;
 
-        // count all entries in row withOUT multiplicity
-	for (int i = 0; i < nc; i++)
-	  for (int j = 0; j < v2e[i].Size(); j++)
-	    {
-	      int jj = v2e[i][j];
-	      int v0 = e2v[jj][0];
-	      if (marks[v0] != i) 
-		{
-		  cnt[i]++;
-		  marks[v0] = i;
-		}
-	    }
+  // row-wise access to all entries, also for matrices in symmetric storage
+  template <typename TM>
+  class SparseRows
+  {
+    const SparseMatrixTM<TM> & mat;
+    // the strictly upper triangle, if mat stores the lower one only
+    shared_ptr<SparseMatrix<TM>> upper;
+  public:
+    typedef TM TENTRY;
+    SparseRows (const SparseMatrixTM<TM> & amat) : mat(amat)
+    {
+      if (dynamic_cast<const SparseMatrixSymmetricTM<TM>*> (&mat))
+        upper = TransposeKernel (mat, true);
+    }
 
-	cmat = new SparseMatrixSymmetric<TM,TV> (cnt);
+    template <typename FUNC>
+    INLINE void Indices (int i, FUNC func) const
+    {
+      for (int j : mat.GetRowIndices(i)) func (j);
+      if (upper)
+        for (int j : upper->GetRowIndices(i)) func (j);
+    }
 
-	marks = -1;
-	for (int i = 0; i < nc; i++)
-	  for (int j = 0; j < v2e[i].Size(); j++)
-	    {
-	      int jj = v2e[i][j];
-	      int v0 = e2v[jj][0];
-	      if (marks[v0] != i) 
-		{
-		  marks[v0] = i;
-		  cmat -> CreatePosition (i, v0);
-		}
-	    }
-      }
+    template <typename FUNC>
+    INLINE void Entries (int i, FUNC func) const
+    {
+      FlatArray<int> ri = mat.GetRowIndices(i);
+      FlatVector<TM> rv = mat.GetRowValues(i);
+      for (int j = 0; j < ri.Size(); j++) func (ri[j], rv(j));
+      if (upper)
+        {
+          FlatArray<int> uri = upper->GetRowIndices(i);
+          FlatVector<TM> urv = upper->GetRowValues(i);
+          for (int j = 0; j < uri.Size(); j++) func (uri[j], urv(j));
+        }
+    }
+  };
 
-    *cmat = 0.;
-    RegionTimer reg2(tcomp);
-	  
-    for (int i = 0; i < n; i++)
-      {
-        FlatArray<int> mat_ri = this->GetRowIndices(i);
-        FlatVector<TM> mat_rval = this->GetRowValues(i);
+  // the identity, as left factor of a product A*B = I*A*B
+  class IdentityRows
+  {
+  public:
+    typedef double TENTRY;
+    template <typename FUNC>
+    INLINE void Indices (int i, FUNC func) const { func (i); }
+    template <typename FUNC>
+    INLINE void Entries (int i, FUNC func) const { func (i, 1.0); }
+  };
+
+
+  // entry product, Mat only supports scalar factors from the left
+  template <typename TA, typename TB>
+  INLINE typename SparseProductEntry<TA,TB>::TM ProductEntry (const TA & a, const TB & b)
+  { return a * b; }
+  template <typename TA>
+  INLINE TA ProductEntry (const TA & a, double b)
+  { return b * a; }
+
+
+  // number of entries per row of R*A*B, columns < w, lower: only cols <= row
+  template <typename TR, typename TA, typename TB>
+  static void ProductCount (const TR & r, const TA & a, const TB & b,
+                            int h, int w, bool lower, Array<int> & cnt)
+  {
+    static Timer t("sparse matrix-matrix product - symbolic");
+    RegionTimer reg(t);
 
-        for (int j = 0; j < mat_ri.Size(); j++)
-          {
-            int col = mat_ri[j];
-            TM mat_val = mat_rval[j]; 
+    cnt.SetSize (h);
+#pragma omp parallel
+    {
+      Array<int> marks(w);
+      marks = -1;
+#pragma omp for
+      for (int i = 0; i < h; i++)
+        {
+          int c = 0;
+          r.Indices (i, [&] (int k)
+            {
+              a.Indices (k, [&] (int l)
+                {
+                  b.Indices (l, [&] (int j)
+                    {
+                      if ( (!lower || j <= i) && marks[j] != i)
+                        {
+                          marks[j] = i;
+                          c++;
+                        }
+                    });
+                });
+            });
+          cnt[i] = c;
+        }
+    }
+  }
 
-            FlatArray<int> prol_ri_i = prol.GetRowIndices(i);
-            FlatArray<int> prol_ri_col = prol.GetRowIndices(col);
-            FlatVector<double> prol_rval_i = prol.GetRowValues(i);
-            FlatVector<double> prol_rval_col = prol.GetRowValues(col);
+  // creates the sorted graph of R*A*B in prod, allocated with the counts of ProductCount
+  template <typename TR, typename TA, typename TB, typename TMC>
+  static void ProductGraph (const TR & r, const TA & a, const TB & b,
+                            int w, bool lower, SparseMatrixTM<TMC> & prod)
+  {
+    static Timer t("sparse matrix-matrix product - symbolic");
+    RegionTimer reg(t);
 
-            for (int k = 0; k < prol_ri_i.Size(); k++)
-              for (int l = 0; l < prol_ri_col.Size(); l++)
+    int h = prod.Height();
+#pragma omp parallel
+    {
+      Array<int> marks(w), cols;
+      marks = -1;
+#pragma omp for
+      for (int i = 0; i < h; i++)
+        {
+          cols.SetSize (0);
+          r.Indices (i, [&] (int k)
+            {
+              a.Indices (k, [&] (int l)
                 {
-                  int kk = prol_ri_i[k];
-                  int ll = prol_ri_col[l];
-                  
-                  if ( kk>=ll && kk < cmat->Height() )
+                  b.Indices (l, [&] (int j)
                     {
-                      (*cmat)(kk,ll) += 
-                        prol_rval_i[k] * prol_rval_col[l] * mat_val; 
-                    }
-                  
-                  if (ll >= kk && i != col && ll < cmat->Height() )
+                      if ( (!lower || j <= i) && marks[j] != i)
+                        {
+                          marks[j] = i;
+                          cols.Append (j);
+                        }
+                    });
+                });
+            });
+          QuickSort (cols);
+          for (int j : cols)
+            prod.CreatePosition (i, j);
+        }
+    }
+  }
+
+  // values of R*A*B, entries outside the graph of prod are skipped
+  template <typename TR, typename TA, typename TB, typename TMC>
+  static void ProductValues (const TR & r, const TA & a, const TB & b,
+                             int w, SparseMatrixTM<TMC> & prod)
+  {
+    static Timer t("sparse matrix-matrix product - numeric");
+    RegionTimer reg(t);
+    typedef typename TA::TENTRY TMA;
+    typedef typename TB::TENTRY TMB;
+
+    int h = prod.Height();
+#pragma omp parallel
+    {
+      Array<int> pos(w);
+      pos = -1;
+#pragma omp for
+      for (int i = 0; i < h; i++)
+        {
+          FlatArray<int> cols = prod.GetRowIndices(i);
+          FlatVector<TMC> vals = prod.GetRowValues(i);
+          for (int j = 0; j < cols.Size(); j++)
+            {
+              pos[cols[j]] = j;
+              vals(j) = 0.0;
+            }
+
+          r.Entries (i, [&] (int k, double rik)
+            {
+              a.Entries (k, [&] (int l, const TMA & akl)
+                {
+                  TMA rakl = rik * akl;
+                  b.Entries (l, [&] (int j, const TMB & blj)
                     {
-                      (*cmat)(ll,kk) += 
-                        prol_rval_col[l] * prol_rval_i[k] * Trans(mat_val); 
-                    }
-                  
-                }
-          }
-      }
-    return cmat;
+                      if (pos[j] != -1)
+                        vals(pos[j]) += ProductEntry (rakl, blj);
+                    });
+                });
+            });
+
+          for (int c : cols) pos[c] = -1;
+        }
+    }
+  }
+
+
+  template <typename TM>
+  shared_ptr<SparseMatrix<TM>> TransposeMatrix (const SparseMatrixTM<TM> & mat)
+  {
+    if (!dynamic_cast<const SparseMatrixSymmetricTM<TM>*> (&mat))
+      return TransposeKernel (mat, false);
+
+    // symmetric storage: the transposed matrix is the full matrix
+    SparseRows<TM> rows(mat);
+    Array<int> cnt;
+    ProductCount (IdentityRows(), IdentityRows(), rows, mat.Height(), mat.Width(), false, cnt);
+    auto trans = make_shared<SparseMatrix<TM>> (cnt, mat.Width());
+    ProductGraph (IdentityRows(), IdentityRows(), rows, mat.Width(), false, *trans);
+    ProductValues (IdentityRows(), IdentityRows(), rows, mat.Width(), *trans);
+    return trans;
   }
-  
 
+  template <typename TMA, typename TMB>
+  shared_ptr<SparseMatrix<typename SparseProductEntry<TMA,TMB>::TM>>
+  MatMult (const SparseMatrixTM<TMA> & mata, const SparseMatrixTM<TMB> & matb)
+  {
+    static Timer t("sparse matrix-matrix product");
+    RegionTimer reg(t);
 
+    if (mata.Width() != matb.Height())
+      throw Exception ("MatMult: matrix sizes do not fit");
 
+    SparseRows<TMA> arows(mata);
+    SparseRows<TMB> brows(matb);
+    int w = matb.Width();
 
+    Array<int> cnt;
+    ProductCount (IdentityRows(), arows, brows, mata.Height(), w, false, cnt);
+    auto prod = make_shared<SparseMatrix<typename SparseProductEntry<TMA,TMB>::TM>> (cnt, w);
+    ProductGraph (IdentityRows(), arows, brows, w, false, *prod);
+    ProductValues (IdentityRows(), arows, brows, w, *prod);
+    return prod;
+  }
 
+  template <typename TMA, typename TMB>
+  void MatMult (const SparseMatrixTM<TMA> & mata, const SparseMatrixTM<TMB> & matb,
+                SparseMatrixTM<typename SparseProductEntry<TMA,TMB>::TM> & prod)
+  {
+    static Timer t("sparse matrix-matrix product");
+    RegionTimer reg(t);
 
+    if (mata.Width() != matb.Height() || prod.Height() != mata.Height())
+      throw Exception ("MatMult: matrix sizes do not fit");
 
+    ProductValues (IdentityRows(), SparseRows<TMA>(mata), SparseRows<TMB>(matb),
+                   matb.Width(), prod);
+  }
 
-  template <> BaseSparseMatrix * 
-  SparseMatrixSymmetric<double,double> :: Restrict (const SparseMatrixTM<double> & prol,
-                                                    BaseSparseMatrix* acmat ) const
+  template <typename TM>
+  shared_ptr<SparseMatrix<TM>> RAP (const SparseMatrixTM<double> & restr,
+                                    const SparseMatrixTM<TM> & mat,
+                                    const SparseMatrixTM<double> & prol)
   {
-    static Timer t ("sparsematrix - restrict");
-    static Timer tbuild ("sparsematrix - restrict, build matrix");
-    static Timer tbuild1 ("sparsematrix - restrict, build matrix1");
-    static Timer tbuild2 ("sparsematrix - restrict, build matrix2");
-    static Timer tbuild3 ("sparsematrix - restrict, build matrix3");
-    static Timer tbuild4 ("sparsematrix - restrict, build matrix4");
-    static Timer tcomp ("sparsematrix - restrict, compute matrix");
+    static Timer t("sparse matrix RAP");
     RegionTimer reg(t);
-    
-    int n = this->Height();
 
-    SparseMatrixSymmetric<double,double>* cmat = 
-      dynamic_cast< SparseMatrixSymmetric<double,double>* > ( acmat );
- 
-    // if no coarse matrix, build up matrix-graph!
-    if ( !cmat )
-      {
-        RegionTimer reg(tbuild);
-        tbuild1.Start();
-	Array<INT<2> > e2v;
-	for (int i = 0; i < n; i++)
-	  for (int j = 0; j < this->GetRowIndices(i).Size(); j++)
-	    {
-	      int col = this->GetRowIndices(i)[j];
+    if (restr.Width() != mat.Height() || mat.Width() != prol.Height())
+      throw Exception ("RAP: matrix sizes do not fit");
 
-	      for (int kk : prol.GetRowIndices(i))
-		for (int ll : prol.GetRowIndices(col))
-		  {
-		    if (kk >= ll) swap (kk,ll);
-		    e2v.Append (INT<2> (kk,ll));
-		  }
-	    }
+    SparseRows<double> rrows(restr), prows(prol);
+    SparseRows<TM> arows(mat);
+    int w = prol.Width();
 
-	int nc = 0;
-        for (auto vpair : e2v)
-          nc = max2 (nc, vpair[1]);
-	nc++;
+    Array<int> cnt;
+    ProductCount (rrows, arows, prows, restr.Height(), w, false, cnt);
+    auto cmat = make_shared<SparseMatrix<TM>> (cnt, w);
+    ProductGraph (rrows, arows, prows, w, false, *cmat);
+    ProductValues (rrows, arows, prows, w, *cmat);
+    return cmat;
+  }
 
-        tbuild1.Stop();
-        tbuild2.Start();
+  template <typename TM>
+  void RAP (const SparseMatrixTM<double> & restr, const SparseMatrixTM<TM> & mat,
+            const SparseMatrixTM<double> & prol, SparseMatrixTM<TM> & cmat)
+  {
+    static Timer t("sparse matrix RAP");
+    RegionTimer reg(t);
 
-        // count all entries in row with multiplicity
-	Array<int> cnt(nc);
-	cnt = 0;
-	for (int i = 0; i < e2v.Size(); i++)
-	  cnt[e2v[i][1]]++;
+    if (restr.Width() != mat.Height() || mat.Width() != prol.Height() ||
+        cmat.Height() > restr.Height())
+      throw Exception ("RAP: matrix sizes do not fit");
 
-	Table<int> v2e(cnt);
-	cnt = 0;
-	for (int i = 0; i < e2v.Size(); i++)
-	  {
-	    int v1 = e2v[i][1];
-	    v2e[v1][cnt[v1]++] = i;
-	  }
+    ProductValues (SparseRows<double>(restr), SparseRows<TM>(mat), SparseRows<double>(prol),
+                   prol.Width(), cmat);
+  }
 
-        tbuild2.Stop();
-        tbuild3.Start();
-	
-	cnt = 0;
-	Array<int> marks(n);
-	marks = -1;
 
-        // count all entries in row withOUT multiplicity
-	for (int i = 0; i < nc; i++)
-	  for (int j = 0; j < v2e[i].Size(); j++)
-	    {
-	      int jj = v2e[i][j];
-	      int v0 = e2v[jj][0];
-	      if (marks[v0] != i) 
-		{
-		  cnt[i]++;
-		  marks[v0] = i;
-		}
-	    }
 
-        tbuild3.Stop();
-        tbuild4.Start();
+  template <class TM, class TV>
+  BaseSparseMatrix *
+  SparseMatrixSymmetric<TM,TV> :: Restrict (const SparseMatrixTM<double> & prol,
+					    BaseSparseMatrix* acmat ) const
+  {
+    static Timer t ("sparsematrix - restrict");
+    static Timer tbuild ("sparsematrix - restrict, build matrix");
+    static Timer tcomp ("sparsematrix - restrict, compute matrix");
+    RegionTimer reg(t);
 
-	cmat = new SparseMatrixSymmetric<double,double> (cnt);
+    SparseMatrixSymmetric<TM,TV>* cmat =
+      dynamic_cast< SparseMatrixSymmetric<TM,TV>* > ( acmat );
 
-	marks = -1;
-	for (int i = 0; i < nc; i++)
-	  for (int j = 0; j < v2e[i].Size(); j++)
-	    {
-	      int jj = v2e[i][j];
-	      int v0 = e2v[jj][0];
-	      if (marks[v0] != i) 
-		{
-		  marks[v0] = i;
-		  cmat -> CreatePosition (i, v0);
-		}
-	    }
+    auto restr = TransposeMatrix (prol);
+    SparseRows<double> rrows(*restr), prows(prol);
+    SparseRows<TM> arows(*this);
 
-        tbuild4.Stop();
+    // if no coarse matrix, build up matrix-graph (lower triangle) !
+    if ( !cmat )
+      {
+        RegionTimer reg(tbuild);
+        Array<int> cnt;
+        ProductCount (rrows, arows, prows, restr->Height(), prol.Width(), true, cnt);
+	cmat = new SparseMatrixSymmetric<TM,TV> (cnt);
+        ProductGraph (rrows, arows, prows, prol.Width(), true, *cmat);
       }
 
-    *cmat = 0.;
     RegionTimer reg2(tcomp);
+    ProductValues (rrows, arows, prows, prol.Width(), *cmat);
+    return cmat;
+  }
 
-#pragma omp parallel for	  
-    for (int i = 0; i < n; i++)
-      {
-        FlatArray<int> mat_ri = this->GetRowIndices(i);
-        FlatVector<double> mat_rval = this->GetRowValues(i);
 
-        for (int j = 0; j < mat_ri.Size(); j++)
-          {
-            int col = mat_ri[j];
-            double mat_val = mat_rval[j]; 
+  template <class TM, class TV_ROW, class TV_COL>
+  BaseSparseMatrix *
+  SparseMatrix<TM,TV_ROW,TV_COL> :: Restrict (const SparseMatrixTM<double> & prol,
+                                              BaseSparseMatrix* acmat ) const
+  {
+    static Timer t ("sparsematrix - restrict");
+    RegionTimer reg(t);
 
-            FlatArray<int> prol_rowind = prol.GetRowIndices(i);
-            FlatArray<int> prol_colind = prol.GetRowIndices(col);
-            FlatVector<double> prol_rowval = prol.GetRowValues(i);
-            FlatVector<double> prol_colval = prol.GetRowValues(col);
+    SparseMatrix<TM,TV_ROW,TV_COL>* cmat =
+      dynamic_cast< SparseMatrix<TM,TV_ROW,TV_COL>* > ( acmat );
 
-            for (int k = 0; k < prol_rowind.Size(); k++)
-              for (int l = 0; l < prol_colind.Size(); l++)
-                {
-                  int kk = prol_rowind[k];
-                  int ll = prol_colind[l];
-                  
-                  if ( kk>=ll && kk < cmat->Height() )
-                    {
-#pragma omp atomic                      
-                      (*cmat)(kk,ll) += 
-                        prol_rowval[k] * prol_colval[l] * mat_val; 
-                    }
-                  
-                  if (ll >= kk && i != col && ll < cmat->Height() )
-                    {
-#pragma omp atomic                      
-                      (*cmat)(ll,kk) += 
-                        prol_colval[l] * prol_rowval[k] * Trans(mat_val); 
-                    }
-                  
-                }
-          }
+    auto restr = TransposeMatrix (prol);
+    SparseRows<double> rrows(*restr), prows(prol);
+    SparseRows<TM> arows(*this);
+
+    if ( !cmat )
+      {
+        Array<int> cnt;
+        ProductCount (rrows, arows, prows, restr->Height(), prol.Width(), false, cnt);
+	cmat = new SparseMatrix<TM,TV_ROW,TV_COL> (cnt, prol.Width());
+        ProductGraph (rrows, arows, prows, prol.Width(), false, *cmat);
       }
+
+    ProductValues (rrows, arows, prows, prol.Width(), *cmat);
     return cmat;
   }
 
@@ -1807,6 +2136,57 @@ namespace ngla
 
 
 
+
+
+
+
+#define INST_SPARSE_PRODUCTS(...)                                       \
+  template NGS_DLL_HEADER shared_ptr<SparseMatrix<__VA_ARGS__>>         \
+  TransposeMatrix (const SparseMatrixTM<__VA_ARGS__> &);                \
+  template NGS_DLL_HEADER shared_ptr<SparseMatrix<__VA_ARGS__>>         \
+  MatMult (const SparseMatrixTM<__VA_ARGS__> &, const SparseMatrixTM<__VA_ARGS__> &); \
+  template NGS_DLL_HEADER void                                          \
+  MatMult (const SparseMatrixTM<__VA_ARGS__> &, const SparseMatrixTM<__VA_ARGS__> &, \
+           SparseMatrixTM<__VA_ARGS__> &);                              \
+  template NGS_DLL_HEADER shared_ptr<SparseMatrix<__VA_ARGS__>>         \
+  RAP (const SparseMatrixTM<double> &, const SparseMatrixTM<__VA_ARGS__> &, \
+       const SparseMatrixTM<double> &);                                 \
+  template NGS_DLL_HEADER void                                          \
+  RAP (const SparseMatrixTM<double> &, const SparseMatrixTM<__VA_ARGS__> &, \
+       const SparseMatrixTM<double> &, SparseMatrixTM<__VA_ARGS__> &);
+
+  // products of a scalar with a non-scalar matrix
+#define INST_SPARSE_PRODUCTS_MIXED(...)                                 \
+  template NGS_DLL_HEADER shared_ptr<SparseMatrix<__VA_ARGS__>>         \
+  MatMult (const SparseMatrixTM<double> &, const SparseMatrixTM<__VA_ARGS__> &); \
+  template NGS_DLL_HEADER shared_ptr<SparseMatrix<__VA_ARGS__>>         \
+  MatMult (const SparseMatrixTM<__VA_ARGS__> &, const SparseMatrixTM<double> &); \
+  template NGS_DLL_HEADER void                                          \
+  MatMult (const SparseMatrixTM<double> &, const SparseMatrixTM<__VA_ARGS__> &, \
+           SparseMatrixTM<__VA_ARGS__> &);                              \
+  template NGS_DLL_HEADER void                                          \
+  MatMult (const SparseMatrixTM<__VA_ARGS__> &, const SparseMatrixTM<double> &, \
+           SparseMatrixTM<__VA_ARGS__> &);
+
+  INST_SPARSE_PRODUCTS(double)
+  INST_SPARSE_PRODUCTS(Complex)
+  INST_SPARSE_PRODUCTS_MIXED(Complex)
+#if MAX_SYS_DIM >= 1
+  INST_SPARSE_PRODUCTS(Mat<1,1,double>)
+  INST_SPARSE_PRODUCTS_MIXED(Mat<1,1,double>)
+#endif
+#if MAX_SYS_DIM >= 2
+  INST_SPARSE_PRODUCTS(Mat<2,2,double>)
+  INST_SPARSE_PRODUCTS_MIXED(Mat<2,2,double>)
+#endif
+#if MAX_SYS_DIM >= 3
+  INST_SPARSE_PRODUCTS(Mat<3,3,double>)
+  INST_SPARSE_PRODUCTS_MIXED(Mat<3,3,double>)
+#endif
+
+
+
+
   //  template class SparseMatrix<double>;
 #define NONExx
 #ifdef NONExx
@@ -1815,38 +2195,57 @@ namespace ngla
   template class SparseMatrixTM<double>;
   template class SparseMatrixTM<Complex>;
 
+  template class SparseMatrixAssemblyBuffer<double>;
+  template class SparseMatrixAssemblyBuffer<Complex>;
+
 
 #if MAX_SYS_DIM >= 1
   template class SparseMatrixTM<Mat<1,1,double> >;
   template class SparseMatrixTM<Mat<1,1,Complex> >;
+  template class SparseMatrixAssemblyBuffer<Mat<1,1,double> >;
+  template class SparseMatrixAssemblyBuffer<Mat<1,1,Complex> >;
 #endif
 #if MAX_SYS_DIM >= 2
   template class SparseMatrixTM<Mat<2,2,double> >;
   template class SparseMatrixTM<Mat<2,2,Complex> >;
+  template class SparseMatrixAssemblyBuffer<Mat<2,2,double> >;
+  template class SparseMatrixAssemblyBuffer<Mat<2,2,Complex> >;
 #endif
 #if MAX_SYS_DIM >= 3
   template class SparseMatrixTM<Mat<3,3,double> >;
   template class SparseMatrixTM<Mat<3,3,Complex> >;
+  template class SparseMatrixAssemblyBuffer<Mat<3,3,double> >;
+  template class SparseMatrixAssemblyBuffer<Mat<3,3,Complex> >;
 #endif
 #if MAX_SYS_DIM >= 4
   template class SparseMatrixTM<Mat<4,4,double> >;
   template class SparseMatrixTM<Mat<4,4,Complex> >;
+  template class SparseMatrixAssemblyBuffer<Mat<4,4,double> >;
+  template class SparseMatrixAssemblyBuffer<Mat<4,4,Complex> >;
 #endif
 #if MAX_SYS_DIM >= 5
   template class SparseMatrixTM<Mat<5,5,double> >;
   template class SparseMatrixTM<Mat<5,5,Complex> >;
+  template class SparseMatrixAssemblyBuffer<Mat<5,5,double> >;
+  template class SparseMatrixAssemblyBuffer<Mat<5,5,Complex> >;
 #endif
 #if MAX_SYS_DIM >= 6
   template class SparseMatrixTM<Mat<6,6,double> >;
   template class SparseMatrixTM<Mat<6,6,Complex> >;
+  template class SparseMatrixAssemblyBuffer<Mat<6,6,double> >;
+  template class SparseMatrixAssemblyBuffer<Mat<6,6,Complex> >;
 #endif
 #if MAX_SYS_DIM >= 7
   template class SparseMatrixTM<Mat<7,7,double> >;
   template class SparseMatrixTM<Mat<7,7,Complex> >;
+  template class SparseMatrixAssemblyBuffer<Mat<7,7,double> >;
+  template class SparseMatrixAssemblyBuffer<Mat<7,7,Complex> >;
 #endif
 #if MAX_SYS_DIM >= 8
   template class SparseMatrixTM<Mat<8,8,double> >;
   template class SparseMatrixTM<Mat<8,8,Complex> >;
+  template class SparseMatrixAssemblyBuffer<Mat<8,8,double> >;
+  template class SparseMatrixAssemblyBuffer<Mat<8,8,Complex> >;
 #endif
 
 
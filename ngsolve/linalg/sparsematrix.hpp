@@ -135,6 +135,11 @@ namespace ngla
 
     size_t First (int i) const { return firsti[i]; }
 
+    /// the compressed row storage: row i uses the positions First(i) ... First(i+1)-1
+    FlatArray<size_t> GetFirstArray () const { return FlatArray<size_t> (size+1, firsti.Data()); }
+    /// column numbers of all non-zero positions
+    FlatArray<int,size_t> GetColIndices () const { return FlatArray<int,size_t> (nze, colnr.Data()); }
+
     void FindSameNZE();
     void CalcBalancing ();
 
@@ -233,6 +238,16 @@ namespace ngla
       throw Exception ("BaseSparseMatrix::Restrict");
     }
 
+    /**
+       y += s A x, restricted to the given rows. For symmetric storage
+       the transposed part of these rows is added as well.
+    */
+    virtual void MultAddRows (double s, const BaseVector & x, BaseVector & y,
+                              FlatArray<int> rows) const
+    {
+      throw Exception ("BaseSparseMatrix::MultAddRows");
+    }
+
     virtual INVERSETYPE SetInverseType ( INVERSETYPE ainversetype ) const
     {
 
@@ -328,11 +343,28 @@ namespace ngla
     FlatVector<TM> GetRowValues(int i) const
     { return FlatVector<TM> (firsti[i+1]-firsti[i], &data[firsti[i]]); }
 
+    /// the values of all non-zero positions, ordered as the column numbers
+    FlatArray<TM,size_t> GetValues () const
+    { return FlatArray<TM,size_t> (nze, data.Data()); }
+
 
     virtual void AddElementMatrix(const FlatArray<int> & dnums1, 
 				  const FlatArray<int> & dnums2, 
 				  const FlatMatrix<TSCAL> & elmat);
 
+    /// AddElementMatrix for concurrent calls, entries are added atomically
+    virtual void AddElementMatrixAtomic(const FlatArray<int> & dnums1, 
+                                        const FlatArray<int> & dnums2, 
+                                        const FlatMatrix<TSCAL> & elmat);
+
+    /**
+       Adds the element matrix at precomputed positions in the value array, 
+       pos(i*dnums2.Size()+j) belongs to elmat(i,j), -1 .. entry is skipped.
+     */
+    void AddElementMatrixAt (FlatArray<int> pos,
+                             FlatArray<int> dnums1, FlatArray<int> dnums2, 
+                             const FlatMatrix<TSCAL> & elmat, bool atomic = false);
+
     virtual BaseVector & AsVector() 
     {
       asvec.AssignMemory (nze*sizeof(TM)/sizeof(TSCAL), (void*)&data[0]);
@@ -422,8 +454,7 @@ namespace ngla
     virtual shared_ptr<BaseMatrix> InverseMatrix (const Array<int> * clusters) const;
 
     virtual BaseSparseMatrix * Restrict (const SparseMatrixTM<double> & prol,
-					 BaseSparseMatrix* cmat = NULL ) const
-    { return 0; }
+					 BaseSparseMatrix* cmat = NULL ) const;
 
 
   
@@ -495,6 +526,9 @@ namespace ngla
     virtual void MultAdd (Complex s, const BaseVector & x, BaseVector & y) const;
     virtual void MultTransAdd (Complex s, const BaseVector & x, BaseVector & y) const;
 
+    virtual void MultAddRows (double s, const BaseVector & x, BaseVector & y,
+                              FlatArray<int> rows) const;
+
     virtual void DoArchive (Archive & ar);
   };
 
@@ -532,6 +566,49 @@ namespace ngla
     {
       AddElementMatrix (dnums1, elmat);
     }
+
+    /// adds the lower triangle atomically
+    virtual void AddElementMatrixAtomic(const FlatArray<int> & dnums1, 
+                                        const FlatArray<int> & dnums2, 
+                                        const FlatMatrix<TSCAL> & elmat);
+  };
+
+
+
+  /**
+     Colouring-free concurrent assembly into a sparse matrix.
+     Every thread collects the entries of its element matrices in a
+     private buffer. A full buffer is sorted and merged into the matrix, 
+     locking one block of rows at a time. For symmetric matrices only 
+     the lower triangle is added.
+   */
+  template <class TM>
+  class NGS_DLL_HEADER SparseMatrixAssemblyBuffer
+  {
+    typedef typename mat_traits<TM>::TSCAL TSCAL;
+    enum { ROWBLOCK = 64 };
+
+    struct ThreadBuffer
+    {
+      Array<size_t> keys;   // row * width + col
+      Array<TM> vals;
+    };
+
+    SparseMatrixTM<TM> & mat;
+    bool lower;
+    size_t maxentries;
+    Array<atomic<int>> locks;
+    Array<ThreadBuffer> buffers;
+
+  public:
+    SparseMatrixAssemblyBuffer (SparseMatrixTM<TM> & amat, size_t amaxentries = 1 << 16);
+
+    /// may be called concurrently, buffers in the calling thread's buffer
+    void AddElementMatrix (FlatArray<int> dnums1, FlatArray<int> dnums2,
+                           FlatMatrix<TSCAL> elmat);
+
+    /// merges the buffer of the calling thread into the matrix
+    void Flush ();
   };
 
 
@@ -646,6 +723,9 @@ namespace ngla
       MultAdd (s, x, y);
     }
 
+    virtual void MultAddRows (double s, const BaseVector & x, BaseVector & y,
+                              FlatArray<int> rows) const;
+
 
     /*
       y += s L * x
@@ -733,6 +813,51 @@ namespace ngla
   };
 
 
+  /// entry type of the product of matrices with entries TMA and TMB
+  template <typename TMA, typename TMB>
+  struct SparseProductEntry { typedef TMA TM; };
+  template <typename TMB>
+  struct SparseProductEntry<double,TMB> { typedef TMB TM; };
+
+  /*
+    Sparse matrix products, computed in parallel by a symbolic and a
+    numeric pass. Matrices in symmetric storage are used as full
+    matrices, results are in full storage. Instantiated for double and
+    Complex entries and for real blocks up to MAX_SYS_DIM (also mixed
+    with double matrices).
+  */
+
+  /// the transposed matrix
+  template <typename TM>
+  NGS_DLL_HEADER shared_ptr<SparseMatrix<TM>> 
+  TransposeMatrix (const SparseMatrixTM<TM> & mat);
+
+  /// the product mata * matb
+  template <typename TMA, typename TMB>
+  NGS_DLL_HEADER shared_ptr<SparseMatrix<typename SparseProductEntry<TMA,TMB>::TM>> 
+  MatMult (const SparseMatrixTM<TMA> & mata, const SparseMatrixTM<TMB> & matb);
+
+  /**
+     Numeric pass only: recomputes the values of prod = mata * matb in
+     the graph of prod, e.g. from a previous MatMult with other values.
+     For symmetric storage only the lower triangle is computed.
+  */
+  template <typename TMA, typename TMB>
+  NGS_DLL_HEADER void
+  MatMult (const SparseMatrixTM<TMA> & mata, const SparseMatrixTM<TMB> & matb,
+           SparseMatrixTM<typename SparseProductEntry<TMA,TMB>::TM> & prod);
+
+  /// the Galerkin product restr * mat * prol, without forming mat * prol
+  template <typename TM>
+  NGS_DLL_HEADER shared_ptr<SparseMatrix<TM>> 
+  RAP (const SparseMatrixTM<double> & restr, const SparseMatrixTM<TM> & mat,
+       const SparseMatrixTM<double> & prol);
+
+  /// numeric pass of RAP, in the graph of cmat
+  template <typename TM>
+  NGS_DLL_HEADER void
+  RAP (const SparseMatrixTM<double> & restr, const SparseMatrixTM<TM> & mat,
+       const SparseMatrixTM<double> & prol, SparseMatrixTM<TM> & cmat);
 
   
 #ifdef FILE_SPARSEMATRIX_CPP
@@ -35,6 +35,7 @@ namespace ngmg
     SetOwnCoarseGridPreconditioner (1);
     SetUpdateAll (biform.UseGalerkin());
     SetUpdateAlways (0);
+    SetExplicitProlongation (0);
     checksumcgpre = -17;
     //    Update ();
   }
@@ -120,6 +121,17 @@ namespace ngmg
     if (prolongation)
       prolongation->Update();
 
+    // the prolongation depends on the meshes only, new levels are added
+    if (prolongation && explicit_prolongation)
+      while (prol_matrices.Size() < ma.GetNLevels())
+	{
+	  int level = prol_matrices.Size();
+	  shared_ptr<SparseMatrix<double>> prol;
+	  if (level > 0)
+	    prol = shared_ptr<SparseMatrix<double>> (prolongation->CreateProlongationMatrix (level));
+	  prol_matrices.Append (prol);
+	  restr_matrices.Append (prol ? TransposeMatrix (*prol) : nullptr);
+	}
 
     //  coarsegridpre = biform.GetMatrix(1).CreateJacobiPrecond();
     // InverseMatrix();
@@ -144,14 +156,8 @@ namespace ngmg
 	    // delete coarsegridpre;
 
 	    const BitArray * freedofs = fespace.GetFreeDofs(); // change to const BitArray * 
-	    if (!freedofs)
-	      coarsegridpre =
-		dynamic_cast<const BaseSparseMatrix&> (biform.GetMatrix(0)) .InverseMatrix();
-	    else
-	      {
-		coarsegridpre =
-		  dynamic_cast<const BaseSparseMatrix&> (biform.GetMatrix(0)) .InverseMatrix(freedofs);
-	      }
+	    // also for a ParallelMatrix, which chooses the (distributed) coarse solver
+	    coarsegridpre = biform.GetMatrix(0).InverseMatrix(freedofs);
 
 	    /*
 	      }
@@ -223,6 +229,8 @@ namespace ngmg
   MGM (int level, BaseVector & u, 
        const BaseVector & f, int incsm) const
   {
+    static Timer timer_transfer ("Multigrid preconditioner - transfer");
+
     if (level <= 0 )
       {
 	switch (coarsetype)
@@ -291,14 +299,36 @@ namespace ngmg
 	    smoother->Residuum (level, u, f, d);
 	    */
 
-	    prolongation->RestrictInline (level, d);
+	    // the matrices apply to scalar vectors of fitting size only
+	    shared_ptr<SparseMatrix<double>> prol;
+	    if (level < prol_matrices.Size() && prol_matrices[level] && d.EntrySize() == 1 &&
+		prol_matrices[level]->Height() == d.Size() &&
+		prol_matrices[level]->Width() == dt.Size())
+	      prol = prol_matrices[level];
+
+	    timer_transfer.Start();
+	    if (prol)
+	      {
+		restr_matrices[level]->Mult (d, wt);
+		dt = wt;
+	      }
+	    else
+	      prolongation->RestrictInline (level, d);
+	    timer_transfer.Stop();
 
 	    w = 0;
 	    for (int j = 1; j <= cycle; j++)
 	      MGM (level-1, wt, dt, incsm * incsmooth);
 	    
-	    prolongation->ProlongateInline (level, w);
-	    u += w;
+	    timer_transfer.Start();
+	    if (prol)
+	      prol->MultAdd (1, wt, u);
+	    else
+	      {
+		prolongation->ProlongateInline (level, w);
+		u += w;
+	      }
+	    timer_transfer.Stop();
 
 	    /*
 	    smoother->Residuum (level, u, f, d);
@@ -57,6 +57,10 @@ namespace ngmg
     int updateall;
     /// creates a new smoother for each update
     bool update_always; 
+    /// grid transfers by the assembled prolongation matrices
+    bool explicit_prolongation;
+    /// prolongation and restriction matrices per fine level, if explicit
+    Array<shared_ptr<SparseMatrix<double>>> prol_matrices, restr_matrices;
     /// for robust prolongation
     // Array<BaseMatrix*> prol_projection;
   public:
@@ -95,6 +99,8 @@ namespace ngmg
     void SetUpdateAll (int ua = 1);
     ///
     void SetUpdateAlways (bool ua = 1) { update_always = ua; }
+    /// store the prolongation as SparseMatrix, transfers by matrix-vector products
+    void SetExplicitProlongation (bool ep = 1) { explicit_prolongation = ep; }
     ///
     virtual void Update ();
 
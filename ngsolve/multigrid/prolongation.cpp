@@ -24,74 +24,405 @@ namespace ngmg
   }
 
 
-  LinearProlongation :: ~LinearProlongation() { ; }
+  TransferSchedule ::
+  TransferSchedule (int anc, int anf, Table<int> && aparents, Table<double> && aweights)
+    : nc(anc), nf(anf), parents(move(aparents)), weights(move(aweights))
+  {
+    static Timer t("TransferSchedule - setup");
+    RegionTimer reg(t);
+
+    int n = nf-nc;
+
+    // depth in the parent hierarchy, parents are not necessarily numbered first
+    Array<int> depth(n);
+    depth = 0;
+    for (bool changed = true; changed; )
+      {
+        changed = false;
+        for (int i = 0; i < n; i++)
+          for (int p : parents[i])
+            if (p >= nc && p < nf && depth[p-nc]+1 > depth[i])
+              {
+                depth[i] = depth[p-nc]+1;
+                changed = true;
+                if (depth[i] > n)
+                  throw Exception ("TransferSchedule: cyclic parent relation");
+              }
+      }
+
+    int nlayers = 0;
+    for (int d : depth)
+      nlayers = max2 (nlayers, d+1);
+
+    Array<int> cnt(nlayers);
+    cnt = 0;
+    for (int d : depth)
+      cnt[d]++;
+    layers = Table<int> (cnt);
+    cnt = 0;
+    for (int i = 0; i < n; i++)
+      layers[depth[i]][cnt[depth[i]]++] = nc+i;
+
+    // restriction rows: the distinct parents of every layer
+    Array<int> npa(n);
+    for (int i = 0; i < n; i++)
+      npa[i] = parents[i].Size();
+    Table<int> prow(npa);
+
+    Array<int> rowof(nf), rowcnt;
+    rowof = -1;
+    firstrow.SetSize (nlayers+1);
+    for (int l = 0; l < nlayers; l++)
+      {
+        firstrow[l] = rowparent.Size();
+        for (int c : layers[l])
+          for (int k = 0; k < parents[c-nc].Size(); k++)
+            {
+              int p = parents[c-nc][k];
+              prow[c-nc][k] = -1;
+              if (p == -1) continue;
+              if (rowof[p] < firstrow[l])
+                {
+                  rowof[p] = rowparent.Size();
+                  rowparent.Append (p);
+                  rowcnt.Append (0);
+                }
+              prow[c-nc][k] = rowof[p];
+              rowcnt[rowof[p]]++;
+            }
+      }
+    firstrow[nlayers] = rowparent.Size();
+
+    children = Table<int> (rowcnt);
+    childweights = Table<double> (rowcnt);
+    rowcnt = 0;
+    for (int i = 0; i < n; i++)
+      for (int k = 0; k < prow[i].Size(); k++)
+        {
+          int r = prow[i][k];
+          if (r == -1) continue;
+          children[r][rowcnt[r]] = nc+i;
+          childweights[r][rowcnt[r]] = weights[i][k];
+          rowcnt[r]++;
+        }
+  }
 
 
-  SparseMatrix< double >* LinearProlongation :: CreateProlongationMatrix( int finelevel ) const
+  void TransferSchedule :: Prolongate (FlatSysVector<> fv) const
   {
-    int i, nc, nf;
-    int parents[2];
-    Array< int > indicesPerRow( space.GetNDof() );
-
-    if ( &( space.LowOrderFESpace() ) )
-      {
-        nf = space.LowOrderFESpace().GetNDofLevel( finelevel );
-        nc = space.LowOrderFESpace().GetNDofLevel( finelevel-1 );
+    for (int l = 0; l < layers.Size(); l++)
+      {
+        FlatArray<int> layer = layers[l];
+#pragma omp parallel for
+        for (int j = 0; j < layer.Size(); j++)
+          {
+            int i = layer[j];
+            FlatArray<int> pa = parents[i-nc];
+            FlatArray<double> w = weights[i-nc];
+
+            FlatVector<> fi = fv(i);
+            fi = 0.0;
+            for (int k = 0; k < pa.Size(); k++)
+              if (pa[k] != -1)
+                fi += w[k] * fv(pa[k]);
+          }
       }
-    else
+  }
+
+  void TransferSchedule :: Restrict (FlatSysVector<> fv) const
+  {
+    for (int l = layers.Size()-1; l >= 0; l--)
       {
-        nf = space.GetNDofLevel( finelevel );
-        nc = space.GetNDofLevel( finelevel-1 );
+#pragma omp parallel for
+        for (int r = firstrow[l]; r < firstrow[l+1]; r++)
+          {
+            FlatArray<int> ch = children[r];
+            FlatArray<double> w = childweights[r];
+
+            FlatVector<> fp = fv(rowparent[r]);
+            for (int k = 0; k < ch.Size(); k++)
+              fp += w[k] * fv(ch[k]);
+          }
       }
-    
-    // count entries per row
-    indicesPerRow = 0;
-    for( i=0; i<nc; i++ )
-      indicesPerRow[ i ]++;
-    for( i=nc; i<nf; i++ )
-      {
-        ma->GetParentNodes( i, parents );
-        if ( parents[ 0 ] != -1 )
-          indicesPerRow[ i ]++;
-        if ( parents[ 1 ] != -1 )
-          indicesPerRow[ i ]++;
+  }
+
+  void TransferSchedule ::
+  CoarseRow (int i, double w, Array<int> & cols, Array<double> & vals) const
+  {
+    if (i < nc)
+      {
+        int pos = cols.Pos(i);
+        if (pos == -1)
+          {
+            cols.Append (i);
+            vals.Append (w);
+          }
+        else
+          vals[pos] += w;
+        return;
+      }
+
+    for (int k = 0; k < parents[i-nc].Size(); k++)
+      if (parents[i-nc][k] != -1)
+        CoarseRow (parents[i-nc][k], w * weights[i-nc][k], cols, vals);
+  }
+
+  SparseMatrix<double> * TransferSchedule :: CreateMatrix () const
+  {
+    static Timer t("TransferSchedule - create matrix");
+    RegionTimer reg(t);
+
+    Array<int> cnt(nf);
+#pragma omp parallel
+    {
+      Array<int> cols;
+      Array<double> vals;
+#pragma omp for
+      for (int i = 0; i < nf; i++)
+        {
+          cols.SetSize(0);
+          vals.SetSize(0);
+          CoarseRow (i, 1, cols, vals);
+          cnt[i] = cols.Size();
+        }
+    }
+
+    SparseMatrix<double> * prol = new SparseMatrix<double> (cnt, nc);
+
+#pragma omp parallel
+    {
+      Array<int> cols, index;
+      Array<double> vals;
+#pragma omp for
+      for (int i = 0; i < nf; i++)
+        {
+          cols.SetSize(0);
+          vals.SetSize(0);
+          CoarseRow (i, 1, cols, vals);
+
+          index.SetSize (cols.Size());
+          for (int j = 0; j < index.Size(); j++) index[j] = j;
+          QuickSortI (cols, index);
+
+          FlatVector<> rv = prol->GetRowValues(i);
+          for (int j = 0; j < index.Size(); j++)
+            {
+              prol->CreatePosition (i, cols[index[j]]);
+              rv(j) = vals[index[j]];
+            }
+        }
+    }
+    return prol;
+  }
+
+
+
+  LinearProlongation :: ~LinearProlongation() { ; }
+
+  void LinearProlongation :: Update ()
+  {
+    if (ma->GetNLevels() > nvlevel.Size())
+      nvlevel.Append (ma->GetNV());
+
+    while (schedules.Size() < nvlevel.Size())
+      {
+        int level = schedules.Size();
+        if (level == 0)
+          {
+            schedules.Append (nullptr);
+            continue;
+          }
+
+        int nc = nvlevel[level-1];
+        int nf = nvlevel[level];
+
+        Table<int> parents(nf-nc, 2);
+        Table<double> weights(nf-nc, 2);
+#pragma omp parallel for
+        for (int i = nc; i < nf; i++)
+          {
+            ma->GetParentNodes (i, &parents[i-nc][0]);
+            weights[i-nc] = 0.5;
+          }
+        schedules.Append (make_shared<TransferSchedule> (nc, nf, move(parents), move(weights)));
       }
+  }
 
-    // create matrix graph
-    MatrixGraph mg( indicesPerRow, nc );
-    for( i=0; i<nc; i++ )
-      mg.CreatePosition( i, i );
-    for( i=nc; i<nf; i++ )
-      {
-        ma->GetParentNodes( i, parents );
-        if ( parents[ 0 ] != -1 )
-          mg.CreatePosition( i, parents[ 0 ] ); 
-        if ( parents[ 1 ] != -1 )
-          mg.CreatePosition( i, parents[ 1 ] ); 
+  SparseMatrix< double >* LinearProlongation :: CreateProlongationMatrix( int finelevel ) const
+  {
+    return schedules[finelevel]->CreateMatrix();
+  }
+
+  void LinearProlongation :: ProlongateInline (int finelevel, BaseVector & v) const
+  {
+    static Timer t("LinearProlongation::ProlongateInline");
+    RegionTimer reg(t);
+
+    int nf = nvlevel[finelevel];
+    FlatSysVector<> fv (v.Size(), v.EntrySize(), static_cast<double*>(v.Memory()));
+
+#pragma omp parallel for
+    for (int i = nf; i < fv.Size(); i++)
+      fv(i) = 0;
+
+    schedules[finelevel]->Prolongate (fv);
+  }
+
+  void LinearProlongation :: RestrictInline (int finelevel, BaseVector & v) const
+  {
+    static Timer t("LinearProlongation::RestrictInline");
+    RegionTimer reg(t);
+
+    int nf = nvlevel[finelevel];
+    FlatSysVector<> fv (v.Size(), v.EntrySize(), static_cast<double*>(v.Memory()));
+
+    schedules[finelevel]->Restrict (fv);
+
+#pragma omp parallel for
+    for (int i = nf; i < fv.Size(); i++)
+      fv(i) = 0;
+  }
+
+
+
+  void ElementProlongation :: Update ()
+  {
+    while (schedules.Size() < ma->GetNLevels())
+      {
+        int level = schedules.Size();
+        if (level == 0)
+          {
+            schedules.Append (nullptr);
+            continue;
+          }
+
+        int nc = space.GetNDofLevel (level-1);
+        int nf = space.GetNDofLevel (level);
+
+        Table<int> parents(nf-nc, 1);
+        Table<double> weights(nf-nc, 1);
+#pragma omp parallel for
+        for (int i = nc; i < nf; i++)
+          {
+            parents[i-nc][0] = ma->GetParentElement (i);
+            weights[i-nc][0] = 1;
+          }
+        schedules.Append (make_shared<TransferSchedule> (nc, nf, move(parents), move(weights)));
       }
+  }
 
-    // write prolongation matrix
-    SparseMatrix< double >* prol = new SparseMatrix< double >( mg, 1 );
-    for( i=0; i<nc; i++ )
-      (*prol)( i, i ) = 1;
-    for( i=nc; i<nf; i++ )
-      {
-        ma->GetParentNodes( i, parents );
-        if ( parents[ 0 ] != -1 )
-          (*prol)( i, parents[ 0 ] ) = 0.5; 
-        if ( parents[ 1 ] != -1 )
-          (*prol)( i, parents[ 1 ] ) = 0.5; 
+  SparseMatrix< double >* ElementProlongation :: CreateProlongationMatrix( int finelevel ) const
+  {
+    return schedules[finelevel]->CreateMatrix();
+  }
+
+  void ElementProlongation :: ProlongateInline (int finelevel, BaseVector & v) const
+  {
+    static Timer t("ElementProlongation::ProlongateInline");
+    RegionTimer reg(t);
+
+    int nf = space.GetNDofLevel (finelevel);
+    FlatSysVector<> fv (v.Size(), v.EntrySize(), static_cast<double*>(v.Memory()));
+
+    schedules[finelevel]->Prolongate (fv);
+
+#pragma omp parallel for
+    for (int i = nf; i < fv.Size(); i++)
+      fv(i) = 0;
+  }
+
+  void ElementProlongation :: RestrictInline (int finelevel, BaseVector & v) const
+  {
+    static Timer t("ElementProlongation::RestrictInline");
+    RegionTimer reg(t);
+
+    int nc = space.GetNDofLevel (finelevel-1);
+    int nf = space.GetNDofLevel (finelevel);
+    FlatSysVector<> fv (v.Size(), v.EntrySize(), static_cast<double*>(v.Memory()));
+
+    schedules[finelevel]->Restrict (fv);
+
+#pragma omp parallel for
+    for (int i = nc; i < nf; i++)
+      fv(i) = 0;
+  }
+
+
+
+  void EdgeProlongation :: Update ()
+  {
+    while (schedules.Size() < ma->GetNLevels())
+      {
+        int level = schedules.Size();
+        if (level == 0)
+          {
+            schedules.Append (nullptr);
+            continue;
+          }
+
+        int nc = space.GetNDofLevel (level-1);
+        int nf = space.GetNDofLevel (level);
+
+        // parent edge numbers carry the orientation in the lowest bit
+        Table<int> parents(nf-nc, 2);
+        Table<double> weights(nf-nc, 2);
+#pragma omp parallel for
+        for (int i = nc; i < nf; i++)
+          {
+            int pa[2] = { space.ParentEdge1 (i), space.ParentEdge2 (i) };
+            for (int k = 0; k < 2; k++)
+              {
+                parents[i-nc][k] = (pa[k] != -1) ? pa[k]/2 : -1;
+                weights[i-nc][k] = (pa[k] & 1) ? 0.5 : -0.5;
+              }
+          }
+        schedules.Append (make_shared<TransferSchedule> (nc, nf, move(parents), move(weights)));
       }
+  }
 
-    return prol;
+  void EdgeProlongation :: ProlongateInline (int finelevel, BaseVector & v) const
+  {
+    static Timer t("EdgeProlongation::ProlongateInline");
+    RegionTimer reg(t);
+
+    int nf = space.GetNDofLevel (finelevel);
+    FlatSysVector<> fv (v.Size(), v.EntrySize(), static_cast<double*>(v.Memory()));
+
+#pragma omp parallel for
+    for (int i = nf; i < fv.Size(); i++)
+      fv(i) = 0;
+
+    schedules[finelevel]->Prolongate (fv);
+
+#pragma omp parallel for
+    for (int i = 0; i < nf; i++)
+      if (space.FineLevelOfEdge(i) < finelevel)
+	fv(i) = 0;
   }
 
+  void EdgeProlongation :: RestrictInline (int finelevel, BaseVector & v) const
+  {
+    static Timer t("EdgeProlongation::RestrictInline");
+    RegionTimer reg(t);
+
+    int nc = space.GetNDofLevel (finelevel-1);
+    int nf = space.GetNDofLevel (finelevel);
+    FlatSysVector<> fv (v.Size(), v.EntrySize(), static_cast<double*>(v.Memory()));
+
+#pragma omp parallel for
+    for (int i = 0; i < nf; i++)
+      if (space.FineLevelOfEdge(i) < finelevel)
+	fv(i) = 0;
 
+    schedules[finelevel]->Restrict (fv);
 
+#pragma omp parallel for
+    for (int i = nc; i < fv.Size(); i++)
+      fv(i) = 0;
+  }
 
 
 
-  
 
 
 #ifdef OLD
@@ -496,12 +827,17 @@ namespace ngmg
     
     int ne = ma->GetNE();
     int ndel = first_dofs[1];
-    
+
+    // the value is inherited from the coarsest ancestor, whose entry is not modified
+#pragma omp parallel for
     for (int i = 0; i <ne; i++)
       {
-        int parent = ma->GetParentElement (i);
-        if(parent!=-1)
-          fv(ndel*i) = fv(ndel*parent);
+        int anc = i;
+        for (int parent = ma->GetParentElement (anc); parent != -1; 
+             parent = ma->GetParentElement (anc))
+          anc = parent;
+        if (anc != i)
+          fv(ndel*i) = fv(ndel*anc);
         for(int j = 1; j<ndel; j++)
           fv(ndel*i+j) = 0;
       }
@@ -35,6 +35,56 @@ namespace ngmg
   };
 
 
+  /**
+     Parallel schedule of the transfer between two refinement levels.
+
+     Every new dof i in [nc,nf) is a weighted sum of its parents, which
+     may be new dofs themselves. The new dofs are grouped into layers of
+     equal depth in the parent hierarchy: the prolongation runs through
+     the layers upwards, the restriction downwards. For the restriction,
+     the children of a layer are collected per parent, so every thread
+     accumulates into its own parents.
+  */
+  class NGS_DLL_HEADER TransferSchedule
+  {
+    ///
+    int nc, nf;
+    /// parents and weights of the new dof nc+i, parent -1 is ignored
+    Table<int> parents;
+    ///
+    Table<double> weights;
+    /// new dofs, grouped by depth
+    Table<int> layers;
+    /// restriction rows of layer l are [firstrow[l], firstrow[l+1])
+    Array<int> firstrow;
+    /// the parent of a restriction row
+    Array<int> rowparent;
+    /// children and weights of a restriction row
+    Table<int> children;
+    ///
+    Table<double> childweights;
+  public:
+    ///
+    TransferSchedule (int anc, int anf, Table<int> && aparents, Table<double> && aweights);
+
+    ///
+    int GetNC () const { return nc; }
+    ///
+    int GetNF () const { return nf; }
+
+    /// new dofs from their parents
+    void Prolongate (FlatSysVector<> fv) const;
+    /// adds the new dofs to their parents, the new dofs are not modified
+    void Restrict (FlatSysVector<> fv) const;
+    /// the nf x nc matrix of the prolongation
+    SparseMatrix<double> * CreateMatrix () const;
+
+  private:
+    /// adds w times the representation of dof i by coarse dofs
+    void CoarseRow (int i, double w, Array<int> & cols, Array<double> & vals) const;
+  };
+
+
   /**
      Standard Prolongation.
      Child nodes between 2 parent nodes.
@@ -48,6 +98,8 @@ namespace ngmg
     const FESpace & space;
     ///
     Array<int> nvlevel;
+    /// transfer schedules, per fine level
+    Array<shared_ptr<TransferSchedule>> schedules;
   public:
     ///
     LinearProlongation(shared_ptr<MeshAccess> ama,
@@ -59,77 +111,17 @@ namespace ngmg
     
     virtual ~LinearProlongation(); 
     
-                      ///
-    virtual void Update () 
-    { 
-      if (ma->GetNLevels() > nvlevel.Size())
-	nvlevel.Append (ma->GetNV());
-    }
-
+    ///
+    virtual void Update ();
 
     /// 
     virtual SparseMatrix< double >* CreateProlongationMatrix( int finelevel ) const;
 
-
     ///
-    virtual void ProlongateInline (int finelevel, BaseVector & v) const
-    {
-      int parents[2];
-
-      int nc = nvlevel[finelevel-1];
-      int nf = nvlevel[finelevel];
-    
-      //    FlatVector<TV> & fv = 
-      //      dynamic_cast<VFlatVector<TV> &> (v).FV();
-      //    FlatVector<TV> fv = 
-      //      dynamic_cast<T_BaseVector<TV> &> (v).FV();
-
-      FlatSysVector<> fv (v.Size(), v.EntrySize(), static_cast<double*>(v.Memory()));
-
-
-      int i;
-      for (i = nf; i < fv.Size(); i++)
-	fv(i) = 0;
-
-      for (i = nc; i < nf; i++)
-	{
-	  ma->GetParentNodes (i, parents);
-	  fv(i) = 0.5 * (fv(parents[0]) + fv(parents[1]));
-	}
-    }
-
+    virtual void ProlongateInline (int finelevel, BaseVector & v) const;
 
     ///
-    virtual void RestrictInline (int finelevel, BaseVector & v) const
-    {
-      int parents[2];
-      // int nc = space.GetNDofLevel (finelevel-1);
-      // int nf = space.GetNDofLevel (finelevel);
-      int nc = nvlevel[finelevel-1];
-      int nf = nvlevel[finelevel];
-
-      /*
-	cout << "rest, h1, typeid(v) = " << typeid(v).name() << endl;
-	cout << "nvlevel = " << nvlevel << ", level = " << finelevel << endl;
-	cout << "nc = " << nc << ", nf = " << nf << endl;
-	cout << "v.size = " << v.Size() << ", entrysize = " << v.EntrySize() << endl;
-      */
-
-      // FlatVector<TV> fv = dynamic_cast<T_BaseVector<TV> &> (v).FV();
-
-      FlatSysVector<> fv (v.Size(), v.EntrySize(), static_cast<double*>(v.Memory()));
-
-      int i;
-      for (i = nf-1; i >= nc; i--)
-	{
-	  ma->GetParentNodes (i, parents);
-	  fv(parents[0]) += 0.5 * fv(i);
-	  fv(parents[1]) += 0.5 * fv(i);
-	}
-
-      for (i = nf; i < fv.Size(); i++)
-	fv(i) = 0;  
-    }
+    virtual void RestrictInline (int finelevel, BaseVector & v) const;
   };
 
 
@@ -169,6 +161,8 @@ namespace ngmg
     shared_ptr<MeshAccess> ma;
     ///
     const ElementFESpace & space;
+    /// transfer schedules, per fine level
+    Array<shared_ptr<TransferSchedule>> schedules;
   public:
     ///
     ElementProlongation(const ElementFESpace & aspace)
@@ -177,50 +171,16 @@ namespace ngmg
     virtual ~ElementProlongation();
   
     ///
-    virtual void Update ()
-    { ; }
+    virtual void Update ();
 
     ///
-    virtual SparseMatrix< double >* CreateProlongationMatrix( int finelevel ) const
-    { return NULL; }
+    virtual SparseMatrix< double >* CreateProlongationMatrix( int finelevel ) const;
 
     ///
-    virtual void ProlongateInline (int finelevel, BaseVector & v) const
-    {
-      // FlatVector<TV> fv = dynamic_cast<T_BaseVector<TV> &> (v).FV();    
-
-      FlatSysVector<> fv (v.Size(), v.EntrySize(), static_cast<double*>(v.Memory()));
-    
-      int nc = space.GetNDofLevel (finelevel-1);
-      int nf = space.GetNDofLevel (finelevel);
-
-      for (int i = nc; i < nf; i++)
-	{
-	  int parent = ma->GetParentElement (i);
-	  fv(i) = fv(parent);
-	}
-    
-      for (int i = nf; i < fv.Size(); i++)
-	fv(i) = 0;
-    }
+    virtual void ProlongateInline (int finelevel, BaseVector & v) const;
 
     ///
-    virtual void RestrictInline (int finelevel, BaseVector & v) const
-    {
-      //    FlatVector<TV> fv = dynamic_cast<T_BaseVector<TV> &> (v).FV();    
-
-      FlatSysVector<> fv (v.Size(), v.EntrySize(), static_cast<double*>(v.Memory()));
-    
-      int nc = space.GetNDofLevel (finelevel-1);
-      int nf = space.GetNDofLevel (finelevel);
-
-      for (int i = nf-1; i >= nc; i--)
-	{
-	  int parent = ma->GetParentElement (i);
-	  fv(parent) += fv(i);
-	  fv(i) = 0;
-	}
-    }
+    virtual void RestrictInline (int finelevel, BaseVector & v) const;
   };
 
 
@@ -261,6 +221,8 @@ namespace ngmg
     shared_ptr<MeshAccess> ma;
     ///
     const NedelecFESpace & space;
+    /// transfer schedules, per fine level
+    Array<shared_ptr<TransferSchedule>> schedules;
   public:
     ///
     EdgeProlongation(const NedelecFESpace & aspace)
@@ -269,100 +231,17 @@ namespace ngmg
     virtual ~EdgeProlongation() { ; }
   
     ///
-    virtual void Update () { ; }
+    virtual void Update ();
 
     ///
     virtual SparseMatrix< double >* CreateProlongationMatrix( int finelevel ) const
     { return NULL; }
 
     ///
-    virtual void ProlongateInline (int finelevel, BaseVector & v) const
-    {
-      int nc = space.GetNDofLevel (finelevel-1);
-      int nf = space.GetNDofLevel (finelevel);
-      /*    
-	    FlatVector<TV> & fv = 
-	    dynamic_cast<VFlatVector<TV> &> (v).FV();
-      */
-      //    FlatVector<TV> fv = dynamic_cast<T_BaseVector<TV> &> (v).FV();
-      FlatSysVector<> fv (v.Size(), v.EntrySize(), static_cast<double*>(v.Memory()));
-
-      int i, k;
-
-      for (i = nf; i < fv.Size(); i++)
-	fv(i) = 0;
-
-      for (k = 1; k <= 10; k++)
-	for (i = nc; i < nf; i++)
-	  {
-	    int pa1 = space.ParentEdge1 (i);
-	    int pa2 = space.ParentEdge2 (i);
-	  
-	    fv(i) = 0;
-	    if (pa1 != -1)
-	      {
-		if (pa1 & 1)
-		  fv(i) += 0.5 * fv(pa1/2);
-		else
-		  fv(i) -= 0.5 * fv(pa1/2);
-	      }
-	    if (pa2 != -1)
-	      {
-		if (pa2 & 1)
-		  fv(i) += 0.5 * fv(pa2/2);
-		else
-		  fv(i) -= 0.5 * fv(pa2/2);
-	      }
-	  }
-
-      for (i = 0; i < nf; i++)
-	if (space.FineLevelOfEdge(i) < finelevel)
-	  fv(i) = 0;
-    }
-
+    virtual void ProlongateInline (int finelevel, BaseVector & v) const;
 
     ///
-    virtual void RestrictInline (int finelevel, BaseVector & v) const
-    {
-      int nc = space.GetNDofLevel (finelevel-1);
-      int nf = space.GetNDofLevel (finelevel);
-
-      //    FlatVector<TV> & fv = 
-      //      dynamic_cast<VFlatVector<TV> &> (v).FV();
-      //    FlatVector<TV> fv = dynamic_cast<T_BaseVector<TV> &> (v).FV();
-
-      FlatSysVector<> fv (v.Size(), v.EntrySize(), static_cast<double*>(v.Memory()));
-
-      for (int i = 0; i < nf; i++)
-	if (space.FineLevelOfEdge(i) < finelevel)
-	  fv(i) = 0;
-	
-      for (int k = 1; k <= 10; k++)
-	for (int i = nf-1; i >= nc; i--)
-	  {
-	    int pa1 = space.ParentEdge1 (i);
-	    int pa2 = space.ParentEdge2 (i);
-	  
-	    if (pa1 != -1)
-	      {
-		if (pa1 & 1)
-		  fv(pa1/2) += 0.5 * fv(i);
-		else
-		  fv(pa1/2) -= 0.5 * fv(i);
-	      }
-	    if (pa2 != -1)
-	      {
-		if (pa2 & 1)
-		  fv(pa2/2) += 0.5 * fv(i);
-		else
-		  fv(pa2/2) -= 0.5 * fv(i);
-	      }
-	    fv(i) = 0;
-	  }
-
-      for (int i = nf; i < fv.Size(); i++)
-	fv(i) = 0;  
-    }
+    virtual void RestrictInline (int finelevel, BaseVector & v) const;
 
     ///
     void ApplyGradient (int level, const BaseVector & pot, BaseVector & grad) const
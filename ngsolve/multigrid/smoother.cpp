@@ -927,6 +927,181 @@ namespace ngmg
 
 
 
+
+
+
+  ChebyshevSmoother :: 
+  ChebyshevSmoother  (const MeshAccess & ama,
+		      const BilinearForm & abiform, const Flags & aflags)
+    : Smoother(aflags), ma(ama), biform(abiform)
+  {
+    blockjacobi = flags.GetDefineFlag ("blockjacobi");
+    ratio = flags.GetNumFlag ("chebyshevratio", 30);
+    powersteps = int (flags.GetNumFlag ("powersteps", 10));
+    Update();
+  }
+
+  ChebyshevSmoother :: ~ChebyshevSmoother()
+  {
+    ;
+  }
+
+  void ChebyshevSmoother :: Update (bool force_update)
+  {
+    static Timer t("ChebyshevSmoother::Update");
+    RegionTimer reg(t);
+
+    int nlevels = biform.GetNLevels();
+    jac.SetSize (nlevels);
+    lam_max.SetSize (nlevels);
+
+    for (int level = 0; level < nlevels; level++)
+      {
+	bool finest = (level == nlevels-1);
+	// coarse levels are kept from previous updates
+	if (jac[level] && !finest && !updateall && !force_update)
+	  continue;
+
+	if (!&biform.GetMatrix(level))
+	  {
+	    jac[level] = NULL;
+	    continue;
+	  }
+
+	const BaseSparseMatrix & mat = 
+	  dynamic_cast<const BaseSparseMatrix&> (biform.GetMatrix(level));
+
+	// the block-Jacobi preconditioner takes ownership of the blocks
+	if (blockjacobi && finest)
+	  {
+	    if (biform.UsesEliminateInternal())
+	      flags.SetFlag("eliminate_internal");
+	    Table<int> * blocks = biform.GetFESpace()->CreateSmoothingBlocks(flags);
+	    jac[level] = mat.CreateBlockJacobiPrecond (*blocks);
+	  }
+	else
+	  jac[level] = mat.CreateJacobiPrecond (biform.GetFESpace()->GetFreeDofs());
+
+	lam_max[level] = EstimateLambdaMax (level);
+	cout << IM(3) << "Chebyshev smoother, level " << level 
+	     << ", lam_max = " << lam_max[level] << endl;
+      }
+  }
+
+
+  static double RealInnerProduct (const BaseVector & x, const BaseVector & y)
+  {
+    if (x.IsComplex())
+      return S_InnerProduct<ComplexConjugate> (x, y).real();
+    return InnerProduct (x, y);
+  }
+
+  double ChebyshevSmoother :: EstimateLambdaMax (int level) const
+  {
+    const BaseMatrix & mat = biform.GetMatrix(level);
+    const BaseMatrix & pre = *jac[level];
+
+    AutoVector x = mat.CreateVector();
+    AutoVector y = mat.CreateVector();
+    AutoVector z = mat.CreateVector();
+
+    // pseudo-random start vector, projected to the range of C^{-1}
+    FlatVector<double> fy = y.FVDouble();
+    for (int i = 0; i < fy.Size(); i++)
+      fy(i) = double ((unsigned(i) * 2654435761u) >> 8) / 16777216.0 - 0.5;
+    pre.Mult (y, x);
+
+    // Rayleigh quotient of C^{-1} A in the A-inner product
+    double lam = 0;
+    for (int k = 0; k < powersteps; k++)
+      {
+	mat.Mult (x, y);
+	pre.Mult (y, z);
+	double xax = RealInnerProduct (x, y);
+	if (xax <= 0) break;
+	lam = RealInnerProduct (z, y) / xax;
+	double norm = L2Norm (z);
+	if (norm == 0) break;
+	x.Set (1.0/norm, z);
+      }
+    return lam;
+  }
+
+  void ChebyshevSmoother :: 
+  Smooth (int level, BaseVector & u, const BaseVector & f, 
+	  BaseVector * res, int steps) const
+  {
+    static Timer t("ChebyshevSmoother::Smooth");
+    RegionTimer reg(t);
+
+    const BaseMatrix & mat = biform.GetMatrix(level);
+    const BaseMatrix & pre = *jac[level];
+
+    // Chebyshev polynomial on [upper/ratio, upper]
+    double upper = 1.1 * lam_max[level], lower = upper / ratio;
+    double theta = 0.5 * (upper+lower), delta = 0.5 * (upper-lower);
+    double sigma = theta / delta, rho = 1/sigma;
+
+    AutoVector hr = mat.CreateVector();
+    BaseVector & r = res ? *res : hr;
+    AutoVector z = mat.CreateVector();
+    AutoVector d = mat.CreateVector();
+    AutoVector ad = mat.CreateVector();
+
+    r = f - mat * u;
+    pre.Mult (r, z);
+    d.Set (1.0/theta, z);
+
+    for (int k = 0; k < steps; k++)
+      {
+	u += d;
+	if (k == steps-1 && !res) break;
+
+	mat.Mult (d, ad);
+	r -= ad;
+	if (k == steps-1) break;
+
+	double rhonew = 1.0 / (2*sigma - rho);
+	pre.Mult (r, z);
+	d.Scale (rhonew * rho);
+	d.Add (2*rhonew/delta, z);
+	rho = rhonew;
+      }
+  }
+
+  void ChebyshevSmoother :: PreSmooth (int level, BaseVector & u, 
+				       const BaseVector & f, int steps) const
+  {
+    Smooth (level, u, f, NULL, steps);
+  }
+
+  void ChebyshevSmoother :: 
+  PreSmoothResiduum (int level, BaseVector & u, 
+		     const BaseVector & f, BaseVector & res, int steps) const
+  {
+    Smooth (level, u, f, &res, steps);
+  }
+
+  void ChebyshevSmoother :: PostSmooth (int level, BaseVector & u, 
+					const BaseVector & f, int steps) const
+  {
+    Smooth (level, u, f, NULL, steps);
+  }
+
+  void ChebyshevSmoother :: Residuum (int level, BaseVector & u, 
+				      const BaseVector & f, 
+				      BaseVector & d) const
+  {
+    d = f - biform.GetMatrix (level) * u;
+  }
+  
+  AutoVector ChebyshevSmoother :: CreateVector(int level) const
+  {
+    return biform.GetMatrix(level).CreateVector();
+  }
+
+
+
 
 
 
@@ -219,6 +219,71 @@ namespace ngmg
 
 
 
+  /**
+     Chebyshev smoother.
+     Polynomial in C^{-1} A, where C is the Jacobi or block-Jacobi 
+     preconditioner. Uses only matrix-vector products and vector updates.
+     The largest eigenvalue of C^{-1} A is estimated at Update by 
+     power iteration.
+  */
+  class ChebyshevSmoother : public Smoother
+  {
+    ///
+    const MeshAccess & ma;
+    ///
+    const BilinearForm & biform;
+    /// C^{-1} per level
+    Array<shared_ptr<BaseMatrix>> jac;
+    /// estimated largest eigenvalue of C^{-1} A per level
+    Array<double> lam_max;
+    /// block-Jacobi scaling on the finest level
+    bool blockjacobi;
+    /// smoothing interval is [1.1 lam_max / ratio, 1.1 lam_max] 
+    double ratio;
+    /// power iteration steps
+    int powersteps;
+  
+  public:
+    ///
+    ChebyshevSmoother (const MeshAccess & ama,
+		       const BilinearForm & abiform, const Flags & aflags);
+    ///
+    virtual ~ChebyshevSmoother();
+  
+    ///
+    virtual void Update (bool force_update = 0);
+    ///
+    virtual void PreSmooth (int level, ngla::BaseVector & u, 
+			    const ngla::BaseVector & f, int steps) const;
+    ///
+    virtual void PreSmoothResiduum (int level, ngla::BaseVector & u, 
+				    const ngla::BaseVector & f, 
+				    ngla::BaseVector & res, 
+				    int steps) const;
+    ///
+    virtual void PostSmooth (int level, ngla::BaseVector & u, 
+			     const ngla::BaseVector & f, int steps) const;
+    ///
+    virtual void Residuum (int level, ngla::BaseVector & u, 
+			   const ngla::BaseVector & f, ngla::BaseVector & d) const;
+    ///
+    virtual AutoVector CreateVector(int level) const;
+
+    ///
+    double GetLambdaMax (int level) const { return lam_max[level]; }
+
+  protected:
+    /// steps Chebyshev steps, res (if given) gets the final residuum 
+    void Smooth (int level, BaseVector & u, const BaseVector & f, 
+		 BaseVector * res, int steps) const;
+    ///
+    double EstimateLambdaMax (int level) const;
+  };
+
+
+
+
+
   /**
      Matrix - vector multiplication by smoothing step.
   */
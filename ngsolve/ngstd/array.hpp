@@ -400,6 +400,9 @@ namespace ngstd
     }
 
 
+    /// the data pointer
+    INLINE T * Data () const { return data; }
+
     /// Access array. range check by macro CHECK_RANGE
     INLINE T & operator[] (TSIZE i) const
     {
@@ -13,6 +13,12 @@
 #include <ngstd.hpp>
 // #include <evalfunc.hpp>
 
+#ifdef HAVE_DLFCN_H 
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
 
 namespace ngstd
 {
@@ -28,6 +34,7 @@ namespace ngstd
 
   EvalFunction :: EvalFunction () : eps(1e-14)
   {
+    compiled = NULL;
     DefineConstant ("pi", M_PI);
     DefineArgument ("x", 0);
     DefineArgument ("y", 1);
@@ -37,6 +44,7 @@ namespace ngstd
 
   EvalFunction :: EvalFunction (istream & aist) : eps(1e-14)
   {
+    compiled = NULL;
     DefineConstant ("pi", M_PI);
     DefineArgument ("x", 0);
     DefineArgument ("y", 1);
@@ -48,6 +56,7 @@ namespace ngstd
 
   EvalFunction :: EvalFunction (const string & str) : eps(1e-14)
   {
+    compiled = NULL;
     DefineConstant ("pi", M_PI);
     DefineArgument ("x", 0);
     DefineArgument ("y", 1);
@@ -65,6 +74,9 @@ namespace ngstd
     globvariables = eval2.globvariables;
     arguments = eval2.arguments;
     num_arguments = eval2.num_arguments;
+    compiled = eval2.compiled;
+    compiled_globvars = eval2.compiled_globvars;
+    compiled_funs = eval2.compiled_funs;
   }
 
   EvalFunction :: ~EvalFunction ()
@@ -74,6 +86,7 @@ namespace ngstd
 
   bool EvalFunction :: Parse (istream & aist)
   {
+    compiled = NULL;
     ist = &aist;
     ReadNext();
     res_type = ParseExpression ();
@@ -128,6 +141,14 @@ namespace ngstd
 	return;
       }
 
+    if (compiled)
+      {
+        (*compiled) (x, y, 
+                     compiled_globvars.Size() ? &compiled_globvars[0] : NULL,
+                     compiled_funs.Size() ? &compiled_funs[0] : NULL);
+        return;
+      }
+
     ArrayMem<double, 100> stack(program.Size());
     Eval<double,double> (x, &stack[0]);
 
@@ -493,6 +514,275 @@ namespace ngstd
   }
   */
 
+  string EvalFunction :: GenerateCode () const
+  {
+    Array<const double*> globvars;
+    Array<TFUNP> funs;
+    return GenerateCode (globvars, funs);
+  }
+
+  /*
+    The stack positions are known at compile time, so every stack
+    entry becomes an element of a local array with constant index,
+    which the compiler keeps in registers.
+  */
+  string EvalFunction :: GenerateCode (Array<const double*> & globvars, 
+                                       Array<TFUNP> & funs) const
+  {
+    globvars.SetSize(0);
+    funs.SetSize(0);
+    if (res_type.iscomplex || IsComplex()) return "";
+
+    stringstream body;
+    body.precision(17);
+
+    int sp = -1, maxsp = 0;
+    for (int i = 0; i < program.Size(); i++)
+      {
+        int dim = program[i].vecdim;
+	switch (program[i].op)
+	  {
+	  case ADD: case SUB: case MULT: case DIV:
+            body << "  s[" << sp-1 << "] " << char(program[i].op) 
+                 << "= s[" << sp << "];\n";
+            sp--;
+            break;
+
+	  case VEC_ADD: case VEC_SUB:
+            for (int j = 0; j < dim; j++)
+              body << "  s[" << sp-2*dim+j+1 << "] " 
+                   << ((program[i].op == VEC_ADD) ? '+' : '-')
+                   << "= s[" << sp-dim+j+1 << "];\n";
+            sp -= dim;
+            break;
+
+	  case SCAL_VEC_MULT:
+            body << "  { double scal = s[" << sp-dim << "];\n";
+            for (int j = 0; j < dim; j++)
+              body << "    s[" << sp-dim+j << "] = scal * s[" << sp-dim+j+1 << "];\n";
+            body << "  }\n";
+            sp--;
+            break;
+
+	  case VEC_VEC_MULT:
+            body << "  { double scal = 0;\n";
+            for (int j = 0; j < dim; j++)
+              body << "    scal += s[" << sp-2*dim+j+1 << "] * s[" << sp-dim+j+1 << "];\n";
+            sp -= 2*dim-1;
+            body << "    s[" << sp << "] = scal;\n  }\n";
+            break;
+
+	  case VEC_ELEM:
+            dim = program[i-1].vecdim;
+            body << "  s[" << sp-dim << "] = s[" << sp-dim-1 << " + int(s[" << sp << "])];\n";
+            sp -= dim;
+            break;
+
+	  case VEC_DIM:
+            dim = program[i-1].vecdim;
+            sp -= dim-1;
+            body << "  s[" << sp << "] = " << dim << ";\n";
+            break;
+
+	  case NEG:
+            body << "  s[" << sp << "] = -s[" << sp << "];\n";
+            break;
+
+	  case AND: case OR:
+            body << "  s[" << sp-1 << "] = (s[" << sp-1 << "] > " << eps 
+                 << ((program[i].op == AND) ? ") && (" : ") || (") 
+                 << "s[" << sp << "] > " << eps << ") ? 1 : 0;\n";
+            sp--;
+            break;
+
+	  case NOT:
+            body << "  s[" << sp << "] = (s[" << sp << "] > " << eps << ") ? 0 : 1;\n";
+            break;
+
+	  case GREATER: case GREATEREQUAL: case LESSEQUAL: case LESS:
+            {
+              const char * cmp = 
+                (program[i].op == GREATER) ? ">" : 
+                (program[i].op == GREATEREQUAL) ? ">=" : 
+                (program[i].op == LESSEQUAL) ? "<=" : "<";
+              body << "  s[" << sp-1 << "] = (s[" << sp-1 << "] " << cmp 
+                   << " s[" << sp << "]) ? 1 : 0;\n";
+              sp--;
+              break;
+            }
+
+	  case EQUAL:
+            body << "  s[" << sp-1 << "] = (fabs(s[" << sp-1 << "]-s[" << sp 
+                 << "]) < " << eps << ") ? 1 : 0;\n";
+            sp--;
+            break;
+
+	  case CONSTANT:
+            sp++;
+            body << "  s[" << sp << "] = " << program[i].operand.val << ";\n";
+	    break;
+
+	  case VARIABLE:
+	    for (int j = 0; j < dim; j++)
+	      {
+		sp++;
+		body << "  s[" << sp << "] = x[" << program[i].operand.varnum+j << "];\n";
+	      }
+	    break;
+
+	  case GLOBVAR:
+	    sp++;
+            body << "  s[" << sp << "] = *gv[" << globvars.Size() << "];\n";
+            globvars.Append (program[i].operand.globvar);
+	    break;
+
+	  case FUNCTION: case BESSELJ0: case BESSELJ1: case BESSELY0: case BESSELY1:
+            body << "  s[" << sp << "] = (*fp[" << funs.Size() << "]) (s[" << sp << "]);\n";
+            switch (program[i].op)
+              {
+              case BESSELJ0: funs.Append (bessj0); break;
+              case BESSELJ1: funs.Append (bessj1); break;
+              case BESSELY0: funs.Append (bessy0); break;
+              case BESSELY1: funs.Append (bessy1); break;
+              default: funs.Append (program[i].operand.fun);
+              }
+	    break;
+
+	  case SIN: case COS: case TAN: case ATAN: case EXP: case LOG: case SQRT:
+            {
+              const char * name = 
+                (program[i].op == SIN) ? "sin" : 
+                (program[i].op == COS) ? "cos" : 
+                (program[i].op == TAN) ? "tan" : 
+                (program[i].op == ATAN) ? "atan" : 
+                (program[i].op == EXP) ? "exp" : 
+                (program[i].op == LOG) ? "log" : "sqrt";
+              body << "  s[" << sp << "] = " << name << " (s[" << sp << "]);\n";
+              break;
+            }
+
+	  case ATAN2:
+            body << "  s[" << sp-1 << "] = atan2 (s[" << sp-1 << "], s[" << sp << "]);\n";
+	    sp--;
+	    break;
+
+	  case ABS:
+	    if (dim == 1)
+              body << "  s[" << sp << "] = fabs (s[" << sp << "]);\n";
+	    else
+              {
+                body << "  { double sum = 0;\n";
+                for (int j = 0; j < dim; j++)
+                  body << "    sum += s[" << sp-j << "] * s[" << sp-j << "];\n";
+                sp -= dim-1;
+                body << "    s[" << sp << "] = sqrt (sum);\n  }\n";
+              }
+            break;
+
+	  case SIGN: 
+            body << "  s[" << sp << "] = (s[" << sp << "] > 0) ? 1 : ((s[" 
+                 << sp << "] < 0) ? -1 : 0);\n";
+	    break;
+
+	  case STEP:
+            body << "  s[" << sp << "] = (s[" << sp << "] >= 0) ? 1 : 0;\n";
+	    break;
+	    
+	  case COMMA:
+	    break;
+
+	  default:   // IMAG, GLOBGENVAR, ...  are left to the interpreter
+            return "";
+	  }
+        maxsp = max2 (maxsp, sp);
+      }
+
+    stringstream code;
+    code << "#include <cmath>\n"
+         << "using namespace std;\n"
+         << "extern \"C\" void ngs_evalfunc (const double * x, double * y,\n"
+         << "                                const double * const * gv, double (* const * fp) (double))\n"
+         << "{\n"
+         << "  double s[" << maxsp+1 << "];\n"
+         << body.str();
+    for (int i = 0; i < res_type.vecdim; i++)
+      code << "  y[" << i << "] = s[" << i << "];\n";
+    code << "}\n";
+    return code.str();
+  }
+
+
+  bool EvalFunction :: Compile (bool verbose)
+  {
+#ifdef HAVE_DLFCN_H 
+    Array<const double*> globvars;
+    Array<TFUNP> funs;
+    string code = GenerateCode (globvars, funs);
+    if (code == "") return false;
+
+    const char * cxx = getenv ("NGS_JIT_CXX");
+    string compiler = cxx ? cxx : "c++ -O2 -fPIC -shared";
+
+    string cachedir;
+    if (getenv ("NGS_JIT_CACHE"))
+      cachedir = getenv ("NGS_JIT_CACHE");
+    else if (getenv ("HOME"))
+      {
+        cachedir = string(getenv("HOME")) + "/.ngsolve";
+        mkdir (cachedir.c_str(), 0755);
+        cachedir += "/jit";
+      }
+    else
+      cachedir = "/tmp/ngsolve_jit";
+    mkdir (cachedir.c_str(), 0755);
+
+    stringstream libname;
+    libname << cachedir << "/evalfunc_" << hex 
+            << std::hash<string>() (compiler + code) << ".so";
+
+    struct stat buf;
+    if (stat (libname.str().c_str(), &buf) != 0)
+      {
+        // compile to a private name first, other processes may build the same library
+        stringstream tmpname;
+        tmpname << libname.str() << "." << getpid();
+        {
+          ofstream out(tmpname.str() + ".cpp");
+          out << code;
+        }
+        string cmd = compiler + " -o " + tmpname.str() + " " + tmpname.str() + ".cpp";
+        if (verbose) cout << IM(3) << "compile evalfunction: " << cmd << endl;
+        int err = system (cmd.c_str());
+        remove ((tmpname.str() + ".cpp").c_str());
+        if (err || rename (tmpname.str().c_str(), libname.str().c_str()) != 0)
+          {
+            if (verbose) cout << IM(1) << "compiling evalfunction failed, use interpreter" << endl;
+            remove (tmpname.str().c_str());
+            return false;
+          }
+      }
+    else
+      if (verbose) cout << IM(3) << "use cached evalfunction " << libname.str() << endl;
+
+    void * handle = dlopen (libname.str().c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle)
+      {
+        if (verbose) cout << IM(1) << "cannot load " << libname.str() << ": " << dlerror() << endl;
+        return false;
+      }
+    compiled = (TCOMPILED) dlsym (handle, "ngs_evalfunc");
+    if (!compiled) return false;
+
+    compiled_globvars = globvars;
+    compiled_funs = funs;
+    return true;
+#else
+    return false;
+#endif
+  }
+
+
+
   void EvalFunction :: Print (ostream & ost) const
   {
     for (int i = 0; i < program.Size(); i++)
@@ -217,6 +217,19 @@ public:
 
   /// print expression
   void Print (ostream & ost) const;
+
+  /**
+     Translate the program to C++, build it with the system compiler
+     and load it. The shared library is cached by a hash of the
+     generated code (directory NGS_JIT_CACHE, compiler NGS_JIT_CXX).
+     Returns false if the expression cannot be compiled, then Eval
+     keeps using the interpreter.
+  */
+  bool Compile (bool verbose = false);
+  /// is a compiled version used for real evaluation ?
+  bool IsCompiled () const { return compiled != NULL; }
+  /// the C++ code for the compiled version, empty if not supported
+  string GenerateCode () const;
 protected:
    
   /// one step of evaluation
@@ -334,6 +347,16 @@ protected:
   /// registerd functions
   static SymbolTable<TFUNP> functions;
 
+  /// the compiled program: x, y, global variables, functions
+  typedef void (*TCOMPILED) (const double *, double *, 
+                             const double * const *, const TFUNP *);
+  TCOMPILED compiled;
+  /// addresses of global variables and functions used by compiled code
+  Array<const double*> compiled_globvars;
+  Array<TFUNP> compiled_funs;
+  ///
+  string GenerateCode (Array<const double*> & globvars, Array<TFUNP> & funs) const;
+
   /// registerd constants
   SymbolTable<double> constants;
 
@@ -19,6 +19,23 @@ namespace ngstd
   }
   
 
+
+  /// atomic x += y, by a compare-and-swap loop
+  INLINE void AtomicAdd (double & x, double y)
+  {
+    auto & ax = reinterpret_cast<atomic<double>&> (x);
+    double current = ax.load (memory_order_relaxed);
+    while (!ax.compare_exchange_weak (current, current+y, memory_order_relaxed))
+      ;
+  }
+
+  /// atomic x += y, returns the old value of x
+  INLINE int AtomicAdd (int & x, int y)
+  {
+    return reinterpret_cast<atomic<int>&> (x).fetch_add (y, memory_order_relaxed);
+  }
+
+
   //////////////////////////////////////////////////////////////////////
   // Lambda to function pointer conversion,  M. Hochsteger
   
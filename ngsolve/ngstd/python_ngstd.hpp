@@ -567,6 +567,65 @@ template <> inline void PyExportSymbolTable<shared_ptr<double>> ()
 
 
 
+//////////////////////////////////////////////////////////////////////
+// numpy array interface: numpy arrays refer to our memory and vice versa, without copying
+
+template <typename T> struct PyArrayKind;
+template <> struct PyArrayKind<int> { static char Kind() { return 'i'; } };
+// row offsets of sparse matrices, shown as signed integers as scipy expects them
+template <> struct PyArrayKind<size_t> { static char Kind() { return 'i'; } };
+template <> struct PyArrayKind<double> { static char Kind() { return 'f'; } };
+template <> struct PyArrayKind<std::complex<double>> { static char Kind() { return 'c'; } };
+
+/// array type string, e.g. "<f8" for double
+template <typename T>
+inline string PyArrayTypeStr ()
+{
+  int one = 1;
+  char order = *reinterpret_cast<char*> (&one) ? '<' : '>';
+  return string(1, order) + PyArrayKind<T>::Kind() + ToString (sizeof(T));
+}
+
+/// __array_interface__ of contiguous, row-major memory
+template <typename T>
+inline bp::dict PyArrayInterface (T * data, bp::tuple shape)
+{
+  bp::dict ai;
+  ai["version"] = 3;
+  ai["shape"] = shape;
+  ai["typestr"] = PyArrayTypeStr<T>();
+  ai["data"] = bp::make_tuple (size_t(data), false);
+  return ai;
+}
+
+/// memory of a writable, contiguous array providing __array_interface__, its shape goes to dims
+template <typename T>
+inline T * PyArrayData (bp::object array, Array<int> & dims)
+{
+  bp::dict ai = bp::extract<bp::dict> (array.attr("__array_interface__"));
+  string typestr = bp::extract<string> (ai["typestr"]);
+  if (typestr != PyArrayTypeStr<T>())
+    throw Exception ("array of type " + PyArrayTypeStr<T>() + " expected, got " + typestr);
+  if (ai.has_key("strides") && !bp::object(ai["strides"]).is_none())
+    throw Exception ("contiguous array expected");
+  bp::tuple data = bp::extract<bp::tuple> (ai["data"]);
+  if (bp::extract<bool> (data[1]))
+    throw Exception ("writable array expected");
+
+  bp::tuple shape = bp::extract<bp::tuple> (ai["shape"]);
+  dims.SetSize (bp::len(shape));
+  for (int i = 0; i < dims.Size(); i++)
+    dims[i] = bp::extract<int> (shape[i]);
+  return reinterpret_cast<T*> (size_t (bp::extract<size_t> (data[0])));
+}
+
+/// the scalar type of an array providing __array_interface__
+inline bool PyArrayIsComplex (bp::object array)
+{
+  string typestr = bp::extract<string> (array.attr("__array_interface__")["typestr"]);
+  return typestr == PyArrayTypeStr<std::complex<double>>();
+}
+
 
 #endif // NGS_PYTHON
 #endif // PYTHON_NGSTD_HPP___
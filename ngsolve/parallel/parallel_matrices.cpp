@@ -332,6 +332,551 @@ namespace ngla
 
   }
 
+  static void StartAll (Array<MPI_Request> & requests)
+  {
+    if (requests.Size())
+      MPI_Startall (requests.Size(), &requests[0]);
+  }
+
+  static void FreeAll (Array<MPI_Request> & requests)
+  {
+    for (MPI_Request & r : requests)
+      MPI_Request_free (&r);
+    requests.SetSize (0);
+  }
+
+  // position of val in the sorted array a
+  static int SortedPos (FlatArray<int> a, int val)
+  {
+    int lo = 0, hi = a.Size();
+    while (hi > lo+1)
+      {
+        int mid = (lo+hi) / 2;
+        if (a[mid] <= val) lo = mid; else hi = mid;
+      }
+    return lo;
+  }
+
+
+  template <typename TM>
+  DistributedInverse<TM> :: 
+  DistributedInverse (const SparseMatrixTM<TM> & mat, const BitArray * subset, 
+                      const ParallelDofs * apardofs, int nsolvers)
+    : pardofs(apardofs), comm(apardofs->GetCommunicator()), 
+      subcomm(MPI_COMM_NULL), nrows(0)
+  {
+    static Timer t("DistributedInverse - setup");
+    RegionTimer reg(t);
+
+    int id = MyMPI_GetId (comm);
+    int ntasks = MyMPI_GetNTasks (comm);
+    int ndof = pardofs->GetNDofLocal();
+    MPI_Datatype type = MyGetMPIType<TV>();
+
+    Array<int> global_nums;
+    int nglob;
+    pardofs -> EnumerateGlobally (subset, global_nums, nglob);
+
+    if (nsolvers < 1)
+      nsolvers = max2 (1, int (sqrt (double (ntasks)) + 0.5));
+    nsolvers = min2 (nsolvers, ntasks);
+
+    solvers.SetSize (nsolvers);
+    firstrow.SetSize (nsolvers+1);
+    for (int k = 0; k < nsolvers; k++)
+      solvers[k] = (long(k) * ntasks) / nsolvers;
+    for (int k = 0; k <= nsolvers; k++)
+      firstrow[k] = (long(k) * nglob) / nsolvers;
+    mysolver = solvers.Pos (id);
+
+    MPI_Comm_split (comm, (mysolver != -1) ? 0 : MPI_UNDEFINED, id, &subcomm);
+
+    if (id == 0)
+      cout << IM(3) << "distributed inverse, " << nglob << " dofs on "
+           << nsolvers << " processes" << endl;
+
+    // the solver holding a global row
+    auto owner = [&] (int row) -> int
+      {
+        int k = (long(row) * nsolvers) / max2 (nglob, 1);
+        while (firstrow[k+1] <= row) k++;
+        while (firstrow[k] > row) k--;
+        return k;
+      };
+
+
+    // local dofs and matrix entries, grouped by the solvers
+
+    Array<int> cnt(nsolvers);
+    cnt = 0;
+    for (int i = 0; i < ndof; i++)
+      if (global_nums[i] != -1)
+        cnt[owner(global_nums[i])]++;
+
+    exdofs = Table<int> (cnt);
+    Table<int> exglob (cnt);
+    xsend = Table<TV> (cnt);
+
+    // the solutions carry one more entry, the convergence flag. Every 
+    // process gets it, processes without dofs from the first solver
+    Array<int> ycnt(nsolvers);
+    bool linked = false;
+    for (int k = 0; k < nsolvers; k++)
+      {
+        ycnt[k] = cnt[k] ? cnt[k]+1 : 0;
+        if (cnt[k]) linked = true;
+      }
+    if (nsolvers && !linked)
+      ycnt[0] = 1;
+    yrecv = Table<TV> (ycnt);
+    cnt = 0;
+    for (int i = 0; i < ndof; i++)
+      if (global_nums[i] != -1)
+        {
+          int k = owner(global_nums[i]);
+          exglob[k][cnt[k]] = global_nums[i];
+          exdofs[k][cnt[k]++] = i;
+        }
+
+    // symmetric storage: the upper triangle is sent explicitly
+    bool symmetric = dynamic_cast<const SparseMatrixSymmetricTM<TM>*> (&mat) != NULL;
+
+    Array<int> ntrip(nsolvers);
+    Table<int> trows, tcols;
+    Table<TM> tvals;
+    for (int pass = 1; pass <= 2; pass++)
+      {
+        if (pass == 2)
+          {
+            trows = Table<int> (ntrip);
+            tcols = Table<int> (ntrip);
+            tvals = Table<TM> (ntrip);
+          }
+        ntrip = 0;
+
+        for (int r = 0; r < mat.Height(); r++)
+          {
+            int gr = global_nums[r];
+            if (gr == -1) continue;
+
+            FlatArray<int> rcols = mat.GetRowIndices(r);
+            FlatVector<TM> rvals = mat.GetRowValues(r);
+            for (int j = 0; j < rcols.Size(); j++)
+              {
+                int gc = global_nums[rcols[j]];
+                if (gc == -1) continue;
+
+                int k = owner(gr);
+                if (pass == 2)
+                  {
+                    trows[k][ntrip[k]] = gr;
+                    tcols[k][ntrip[k]] = gc;
+                    tvals[k][ntrip[k]] = rvals(j);
+                  }
+                ntrip[k]++;
+
+                if (!symmetric || gr == gc) continue;
+
+                k = owner(gc);
+                if (pass == 2)
+                  {
+                    trows[k][ntrip[k]] = gc;
+                    tcols[k][ntrip[k]] = gr;
+                    tvals[k][ntrip[k]] = Trans (rvals(j));
+                  }
+                ntrip[k]++;
+              }
+          }
+      }
+
+    Array<int> nsend(ntasks), nrecv(ntasks), nexsend(ntasks), nexrecv(ntasks);
+    nsend = 0;
+    nexsend = 0;
+    for (int k = 0; k < nsolvers; k++)
+      {
+        nsend[solvers[k]] = ntrip[k];
+        nexsend[solvers[k]] = ycnt[k];
+      }
+    MyMPI_AllToAll (nsend, nrecv, comm);
+    MyMPI_AllToAll (nexsend, nexrecv, comm);
+
+    // number of rows, without the flag
+    Array<int> nrowsof(ntasks);
+    for (int src = 0; src < ntasks; src++)
+      nrowsof[src] = max2 (nexrecv[src]-1, 0);
+
+    Table<int> rrows(nrecv), rcols(nrecv);
+    Table<TM> rvals(nrecv);
+    rowsof = Table<int> (nrowsof);
+
+    Array<MPI_Request> requests;
+    for (int k = 0; k < nsolvers; k++)
+      {
+        if (ntrip[k])
+          {
+            requests.Append (MyMPI_ISend (trows[k], solvers[k], MPI_TAG_SOLVE, comm));
+            requests.Append (MyMPI_ISend (tcols[k], solvers[k], MPI_TAG_SOLVE, comm));
+            requests.Append (MyMPI_ISend (tvals[k], solvers[k], MPI_TAG_SOLVE, comm));
+          }
+        if (exglob[k].Size())
+          requests.Append (MyMPI_ISend (exglob[k], solvers[k], MPI_TAG_SOLVE, comm));
+      }
+    for (int src = 0; src < ntasks; src++)
+      {
+        if (nrecv[src])
+          {
+            requests.Append (MyMPI_IRecv (rrows[src], src, MPI_TAG_SOLVE, comm));
+            requests.Append (MyMPI_IRecv (rcols[src], src, MPI_TAG_SOLVE, comm));
+            requests.Append (MyMPI_IRecv (rvals[src], src, MPI_TAG_SOLVE, comm));
+          }
+        if (nrowsof[src])
+          requests.Append (MyMPI_IRecv (rowsof[src], src, MPI_TAG_SOLVE, comm));
+      }
+    MyMPI_WaitAll (requests);
+
+    // persistent requests for right hand sides and solutions
+    for (int k = 0; k < nsolvers; k++)
+      if (yrecv[k].Size())
+        {
+          MPI_Request request;
+          MPI_Send_init (xsend[k].Data(), xsend[k].Size(), type, solvers[k], 
+                         MPI_TAG_SOLVE, comm, &request);
+          sendreq_x.Append (request);
+          MPI_Recv_init (yrecv[k].Data(), yrecv[k].Size(), type, solvers[k], 
+                         MPI_TAG_SOLVE, comm, &request);
+          recvreq_y.Append (request);
+        }
+
+    if (mysolver == -1) return;
+
+
+    // the solver processes set up the block rows
+
+    int first = firstrow[mysolver];
+    nrows = firstrow[mysolver+1] - first;
+
+    for (int src = 0; src < ntasks; src++)
+      for (int & row : rowsof[src])
+        row -= first;
+
+    xrecv = Table<TV> (nrowsof);
+    ysend = Table<TV> (nexrecv);
+    for (int src = 0; src < ntasks; src++)
+      if (nexrecv[src])
+        {
+          MPI_Request request;
+          MPI_Recv_init (xrecv[src].Data(), xrecv[src].Size(), type, src, 
+                         MPI_TAG_SOLVE, comm, &request);
+          recvreq_x.Append (request);
+          MPI_Send_init (ysend[src].Data(), ysend[src].Size(), type, src, 
+                         MPI_TAG_SOLVE, comm, &request);
+          sendreq_y.Append (request);
+        }
+
+    // ghost columns, sorted global numbers are grouped by their solvers
+    Array<int> ghosts;
+    for (int src = 0; src < ntasks; src++)
+      for (int c : rcols[src])
+        if (c < first || c >= first+nrows)
+          ghosts.Append (c);
+    QuickSort (ghosts);
+    int nghost = 0;
+    for (int j = 0; j < ghosts.Size(); j++)
+      if (j == 0 || ghosts[j] != ghosts[j-1])
+        ghosts[nghost++] = ghosts[j];
+    ghosts.SetSize (nghost);
+
+    auto loccol = [&] (int c) -> int
+      {
+        if (c >= first && c < first+nrows) return c-first;
+        return nrows + SortedPos (ghosts, c);
+      };
+
+    Array<int> rcnt(nrows);
+    rcnt = 0;
+    for (int src = 0; src < ntasks; src++)
+      for (int r : rrows[src])
+        rcnt[r-first]++;
+
+    Table<int> ecols(rcnt);
+    Table<TM> evals(rcnt);
+    rcnt = 0;
+    for (int src = 0; src < ntasks; src++)
+      for (int j = 0; j < rrows[src].Size(); j++)
+        {
+          int r = rrows[src][j]-first;
+          ecols[r][rcnt[r]] = loccol (rcols[src][j]);
+          evals[r][rcnt[r]++] = rvals[src][j];
+        }
+
+    // sum up the entries of the processes, rows sorted by the columns
+    Array<int> index, hcols;
+    Array<TM> hvals;
+    for (int r = 0; r < nrows; r++)
+      {
+        index.SetSize (ecols[r].Size());
+        for (int j = 0; j < index.Size(); j++) index[j] = j;
+        QuickSortI (ecols[r], index);
+
+        hcols.SetSize (0);
+        hvals.SetSize (0);
+        for (int j : index)
+          if (hcols.Size() && hcols.Last() == ecols[r][j])
+            hvals.Last() += evals[r][j];
+          else
+            {
+              hcols.Append (ecols[r][j]);
+              hvals.Append (evals[r][j]);
+            }
+
+        for (int j = 0; j < hcols.Size(); j++)
+          {
+            ecols[r][j] = hcols[j];
+            evals[r][j] = hvals[j];
+          }
+        rcnt[r] = hcols.Size();
+      }
+
+    locmat = make_shared<SparseMatrix<TM>> (rcnt, nrows+nghost);
+    for (int r = 0; r < nrows; r++)
+      {
+        FlatVector<TM> rv = locmat->GetRowValues(r);
+        for (int j = 0; j < rcnt[r]; j++)
+          {
+            locmat->CreatePosition (r, ecols[r][j]);
+            rv(j) = evals[r][j];
+          }
+      }
+
+    // the diagonal block, lower triangle, for the preconditioner
+    Array<int> dcnt(nrows);
+    for (int r = 0; r < nrows; r++)
+      {
+        dcnt[r] = 0;
+        for (int j = 0; j < rcnt[r]; j++)
+          if (ecols[r][j] <= r) dcnt[r]++;
+      }
+    if (nrows)
+      {
+        auto diag = make_shared<SparseMatrixSymmetric<TM>> (dcnt);
+        for (int r = 0; r < nrows; r++)
+          {
+            FlatVector<TM> rv = diag->GetRowValues(r);
+            for (int j = 0; j < dcnt[r]; j++)
+              {
+                diag->CreatePosition (r, ecols[r][j]);
+                rv(j) = evals[r][j];
+              }
+          }
+        blockinv = diag->InverseMatrix();
+      }
+
+    // exchange plan for the ghost values of the search direction
+    int nsub = solvers.Size();
+    Array<int> nghostof(nsub), nrowsfor(nsub), firstghost(nsub+1);
+    nghostof = 0;
+    for (int g : ghosts)
+      nghostof[owner(g)]++;
+    firstghost[0] = 0;
+    for (int k = 0; k < nsub; k++)
+      firstghost[k+1] = firstghost[k] + nghostof[k];
+    MyMPI_AllToAll (nghostof, nrowsfor, subcomm);
+
+    ghostrows = Table<int> (nrowsfor);
+    ghostsend = Table<TV> (nrowsfor);
+    requests.SetSize (0);
+    for (int k = 0; k < nsub; k++)
+      {
+        if (nghostof[k])
+          requests.Append (MyMPI_ISend (ghosts.Range (firstghost[k], firstghost[k+1]),
+                                        k, MPI_TAG_SOLVE, subcomm));
+        if (nrowsfor[k])
+          requests.Append (MyMPI_IRecv (ghostrows[k], k, MPI_TAG_SOLVE, subcomm));
+      }
+    MyMPI_WaitAll (requests);
+
+    for (int k = 0; k < nsub; k++)
+      for (int & row : ghostrows[k])
+        row -= first;
+
+    pext.SetSize (nrows+nghost);
+    for (int k = 0; k < nsub; k++)
+      {
+        MPI_Request request;
+        if (nrowsfor[k])
+          {
+            MPI_Send_init (&ghostsend[k][0], nrowsfor[k], type, k, 
+                           MPI_TAG_SOLVE, subcomm, &request);
+            ghostreq.Append (request);
+          }
+        if (nghostof[k])
+          {
+            MPI_Recv_init (pext.Addr(nrows+firstghost[k]), nghostof[k], type, k, 
+                           MPI_TAG_SOLVE, subcomm, &request);
+            ghostreq.Append (request);
+          }
+      }
+  }
+
+
+  template <typename TM>
+  DistributedInverse<TM> :: ~DistributedInverse ()
+  {
+    int finalized;
+    MPI_Finalized (&finalized);
+    if (finalized) return;
+
+    FreeAll (sendreq_x);
+    FreeAll (recvreq_y);
+    FreeAll (recvreq_x);
+    FreeAll (sendreq_y);
+    FreeAll (ghostreq);
+    if (subcomm != MPI_COMM_NULL)
+      MPI_Comm_free (&subcomm);
+  }
+
+
+  /*
+    CG on the solver processes, preconditioned by the inverses of the
+    diagonal blocks
+  */
+  template <typename TM>
+  bool DistributedInverse<TM> :: Solve (FlatVector<TV> b, FlatVector<TV> x) const
+  {
+    static Timer t("DistributedInverse - solve");
+    RegionTimer reg(t);
+
+    int n = nrows;
+    Vector<TV> r(n), w(n), ap(n);
+    FlatVector<TV> p = pext.Range (0, n);
+
+    auto inner = [&] (FlatVector<TV> a, FlatVector<TV> b) -> TSCAL
+      {
+        enum { ES = sizeof(TV) / sizeof(TSCAL) };
+        FlatVector<TSCAL> sa(ES*n, reinterpret_cast<TSCAL*> (a.Addr(0)));
+        FlatVector<TSCAL> sb(ES*n, reinterpret_cast<TSCAL*> (b.Addr(0)));
+        return MyMPI_AllReduce (ngbla::InnerProduct (sa, sb), MPI_SUM, subcomm);
+      };
+
+    auto precond = [&] ()
+      {
+        if (!n) return;
+        VFlatVector<TV> vr(n, r.Addr(0)), vw(n, w.Addr(0));
+        blockinv -> Mult (vr, vw);
+      };
+
+    auto apply = [&] ()
+      {
+        for (int k = 0; k < ghostrows.Size(); k++)
+          for (int j = 0; j < ghostrows[k].Size(); j++)
+            ghostsend[k][j] = p(ghostrows[k][j]);
+        StartAll (ghostreq);
+        MyMPI_WaitAll (ghostreq);
+
+        if (!n) return;
+        VFlatVector<TV> vp(pext.Size(), pext.Addr(0)), vap(n, ap.Addr(0));
+        locmat -> Mult (vp, vap);
+      };
+
+    x = 0.0;
+    r = b;
+    precond();
+    p = w;
+    TSCAL wr = inner (w, r);
+    double wr0 = std::abs (wr);
+
+    int it = 0;
+    for ( ; it < maxsteps && std::abs (wr) > sqr(prec) * wr0; it++)
+      {
+        apply();
+        TSCAL alpha = wr / inner (p, ap);
+        x += alpha * p;
+        r -= alpha * ap;
+        precond();
+        TSCAL wrn = inner (w, r);
+        TSCAL beta = wrn / wr;
+        wr = wrn;
+        p = w + beta * p;
+      }
+
+    if (mysolver == 0)
+      cout << IM(5) << "distributed inverse: " << it << " CG steps" << endl;
+
+    // also a breakdown (nan) counts as failure
+    return std::abs (wr) <= sqr(prec) * wr0;
+  }
+
+
+  template <typename TM>
+  void DistributedInverse<TM> :: MultAdd (double s, const BaseVector & x, BaseVector & y) const
+  {
+    static Timer t("DistributedInverse - mult");
+    RegionTimer reg(t);
+
+    bool is_x_cum = (dynamic_cast_ParallelBaseVector(x) . Status() == CUMULATED);
+    x.Distribute();
+    y.Cumulate();
+
+    FlatVector<TV> fx = x.FV<TV> ();
+    FlatVector<TV> fy = y.FV<TV> ();
+
+    if (mysolver != -1)
+      StartAll (recvreq_x);
+
+    for (int k = 0; k < exdofs.Size(); k++)
+      for (int j = 0; j < exdofs[k].Size(); j++)
+        xsend[k][j] = fx(exdofs[k][j]);
+    StartAll (sendreq_x);
+
+    int failed = 0;
+    if (mysolver != -1)
+      {
+        Vector<TV> b(nrows), sol(nrows);
+        b = 0.0;
+        MyMPI_WaitAll (recvreq_x);
+        for (int src = 0; src < rowsof.Size(); src++)
+          for (int j = 0; j < rowsof[src].Size(); j++)
+            b(rowsof[src][j]) += xrecv[src][j];
+
+        failed = !Solve (b, sol);
+
+        for (int src = 0; src < rowsof.Size(); src++)
+          if (ysend[src].Size())
+            {
+              for (int j = 0; j < rowsof[src].Size(); j++)
+                ysend[src][j] = sol(rowsof[src][j]);
+              ysend[src][rowsof[src].Size()] = failed ? 1.0 : 0.0;
+            }
+        StartAll (sendreq_y);
+      }
+
+    // the receive buffers of the solutions are not used before the sends finished
+    MyMPI_WaitAll (sendreq_x);
+    StartAll (recvreq_y);
+    MyMPI_WaitAll (recvreq_y);
+
+    for (int k = 0; k < exdofs.Size(); k++)
+      {
+        for (int j = 0; j < exdofs[k].Size(); j++)
+          fy(exdofs[k][j]) += s * yrecv[k][j];
+        if (yrecv[k].Size() && L2Norm2 (yrecv[k][exdofs[k].Size()]) != 0)
+          failed = 1;
+      }
+
+    if (mysolver != -1)
+      MyMPI_WaitAll (sendreq_y);
+
+    if (is_x_cum)
+      dynamic_cast_ParallelBaseVector(x) . Cumulate();
+
+    // all processes throw, the solvers sent the flag with the solution
+    if (failed)
+      throw Exception ("DistributedInverse: CG did not converge in " + ToString (maxsteps) + 
+                       " steps, the matrix must be symmetric positive definite");
+  }
+
+
+
   ParallelMatrix :: ParallelMatrix (shared_ptr<BaseMatrix> amat, const ParallelDofs * apardofs)
     : BaseMatrix(apardofs), mat(amat)
   { 
@@ -349,11 +894,48 @@ namespace ngla
     ; // delete &mat;
   }
 
+  void ParallelMatrix :: SetupRowSplit (const BaseSparseMatrix & spmat) const
+  {
+    if (rowsplit_ready) return;
+
+    for (int i = 0; i < spmat.Height(); i++)
+      {
+        bool interior = paralleldofs->GetDistantProcs(i).Size() == 0;
+        for (int j : spmat.GetRowIndices(i))
+          if (paralleldofs->GetDistantProcs(j).Size())
+            interior = false;
+
+        if (interior)
+          interior_rows.Append (i);
+        else
+          interface_rows.Append (i);
+      }
+    rowsplit_ready = true;
+  }
+
   void ParallelMatrix :: MultAdd (double s, const BaseVector & x, BaseVector & y) const
   {
-    x.Cumulate();
+    const ParallelBaseVector * parx = dynamic_cast_ParallelBaseVector (&x);
+    const BaseSparseMatrix * spmat = dynamic_cast<const BaseSparseMatrix*> (mat.get());
+
+    if (!overlap || !spmat || !parx || parx->Status() != DISTRIBUTED)
+      {
+        x.Cumulate();
+        y.Distribute();
+        mat->MultAdd (s, x, y);
+        return;
+      }
+
+    static Timer t("ParallelMatrix::MultAdd - overlapped");
+    RegionTimer reg(t);
+
+    // interior rows use unshared values of x only, which the exchange does not touch
+    SetupRowSplit (*spmat);
     y.Distribute();
-    mat->MultAdd (s, x, y);
+    parx->CumulateBegin();
+    spmat->MultAddRows (s, x, y, interior_rows);
+    parx->CumulateEnd();
+    spmat->MultAddRows (s, x, y, interface_rows);
   }
 
   void ParallelMatrix :: MultTransAdd (double s, const BaseVector & x, BaseVector & y) const
@@ -419,6 +1001,9 @@ namespace ngla
     const SparseMatrixTM<TM> * dmat = dynamic_cast<const SparseMatrixTM<TM>*> (mat.get());
     if (!dmat) return NULL;
 
+    if (mat->GetInverseType() == DISTRIBUTEDINVERSE)
+      return make_shared<DistributedInverse<TM>> (*dmat, subset, paralleldofs);
+
 #ifdef USE_MUMPS
     bool symmetric = dynamic_cast<const SparseMatrixSymmetricTM<TM>*> (mat.get()) != NULL;
     if (mat->GetInverseType() == MUMPS)
@@ -458,18 +1043,26 @@ namespace ngla
 
   template class MasterInverse<double>;
   template class MasterInverse<Complex>;
+  template class DistributedInverse<double>;
+  template class DistributedInverse<Complex>;
 
 #if MAX_SYS_DIM >= 1
   template class MasterInverse<Mat<1,1,double> >;
+  template class DistributedInverse<Mat<1,1,double> >;
   template class MasterInverse<Mat<1,1,Complex> >;
+  template class DistributedInverse<Mat<1,1,Complex> >;
 #endif
 #if MAX_SYS_DIM >= 2
   template class MasterInverse<Mat<2,2,double> >;
+  template class DistributedInverse<Mat<2,2,double> >;
   template class MasterInverse<Mat<2,2,Complex> >;
+  template class DistributedInverse<Mat<2,2,Complex> >;
 #endif
 #if MAX_SYS_DIM >= 3
   template class MasterInverse<Mat<3,3,double> >;
+  template class DistributedInverse<Mat<3,3,double> >;
   template class MasterInverse<Mat<3,3,Complex> >;
+  template class DistributedInverse<Mat<3,3,Complex> >;
 #endif
 
 
@@ -34,10 +34,81 @@ namespace ngla
   };
 
 
+  /**
+     Coarse grid solver on about sqrt(P) processes. The globally
+     enumerated matrix is agglomerated row-wise in contiguous blocks
+     onto the solver processes. It is solved there by a CG iteration
+     preconditioned with the inverses of the diagonal blocks. Right
+     hand sides and solutions are exchanged with persistent requests.
+     The matrix must be symmetric positive definite on the subset.
+   */
+  template <typename TM>
+  class DistributedInverse : public BaseMatrix
+  {
+    typedef typename mat_traits<TM>::TV_ROW TV;
+    typedef typename mat_traits<TM>::TSCAL TSCAL;
+
+    const ParallelDofs * pardofs;
+    MPI_Comm comm;
+    /// the solver processes, MPI_COMM_NULL on the others
+    MPI_Comm subcomm;
+    /// solver processes (ranks in comm), and their first global rows
+    Array<int> solvers, firstrow;
+    /// my number among the solvers, or -1
+    int mysolver;
+
+    /// local dofs exchanged with every solver
+    Table<int> exdofs;
+    mutable Table<TV> xsend, yrecv;
+    mutable Array<MPI_Request> sendreq_x, recvreq_y;
+
+    /// solver: rows of my block, received from every process
+    int nrows;
+    Table<int> rowsof;
+    mutable Table<TV> xrecv, ysend;
+    mutable Array<MPI_Request> recvreq_x, sendreq_y;
+
+    /// solver: my rows, columns are own rows followed by the ghosts
+    shared_ptr<SparseMatrix<TM>> locmat;
+    shared_ptr<BaseMatrix> blockinv;
+    /// rows of mine needed by the other solvers
+    Table<int> ghostrows;
+    mutable Table<TV> ghostsend;
+    /// search direction with ghost values, the ghosts are received in place
+    mutable Vector<TV> pext;
+    mutable Array<MPI_Request> ghostreq;
+
+    double prec = 1e-12;
+    int maxsteps = 1000;
+
+    /// false if the CG iteration did not converge
+    bool Solve (FlatVector<TV> b, FlatVector<TV> x) const;
+  public:
+    DistributedInverse (const SparseMatrixTM<TM> & mat, const BitArray * subset, 
+                        const ParallelDofs * apardofs, int nsolvers = -1);
+    virtual ~DistributedInverse ();
+    virtual void MultAdd (double s, const BaseVector & x, BaseVector & y) const;
+
+    void SetPrecision (double aprec) { prec = aprec; }
+    void SetMaxSteps (int amaxsteps) { maxsteps = amaxsteps; }
+
+    virtual int VHeight() const { return pardofs->GetNDofLocal(); }
+    virtual int VWidth() const { return pardofs->GetNDofLocal(); }
+  };
+
+
   class ParallelMatrix : public BaseMatrix
   {
     shared_ptr<BaseMatrix> mat;
     // const ParallelDofs & pardofs;
+
+    /// overlap the cumulate of x with the product of the interior rows
+    bool overlap = true;
+    /// rows not coupling to shared dofs, and the remaining rows
+    mutable Array<int> interior_rows, interface_rows;
+    mutable bool rowsplit_ready = false;
+
+    void SetupRowSplit (const BaseSparseMatrix & spmat) const;
   public:
     ParallelMatrix (shared_ptr<BaseMatrix> amat, const ParallelDofs * apardofs);
     // : mat(*amat), pardofs(*apardofs) 
@@ -51,6 +122,9 @@ namespace ngla
     virtual const BaseVector & AsVector() const { return mat->AsVector(); }
 
     BaseMatrix & GetMatrix() const { return const_cast<BaseMatrix&> (*mat); }
+
+    /// interior/interface split of MultAdd, on by default for sparse matrices
+    void SetOverlapCommunication (bool aoverlap) { overlap = aoverlap; }
     virtual shared_ptr<BaseMatrix> CreateMatrix () const;
     virtual AutoVector CreateVector () const;
 
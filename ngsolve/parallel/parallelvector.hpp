@@ -21,11 +21,26 @@ namespace ngla
   {
   protected:
     mutable PARALLEL_STATUS status;
+
+    /// persistent requests for Cumulate, set up at the first exchange
+    mutable Array<int> exprocs;
+    mutable Array<MPI_Request> sendrequests, recvrequests;
+    /// the memory the send requests refer to
+    mutable void * exchangememory = nullptr;
+    /// CumulateBegin called, CumulateEnd pending
+    mutable bool exchanging = false;
+
+    /// creates the persistent requests
+    void InitExchange () const;
+    /// releases the persistent requests
+    void FreeExchange () const;
     
   public:
     ParallelBaseVector ()
     { ; }
 
+    virtual ~ParallelBaseVector ();
+
     template <typename T> 
     BaseVector & operator= (const VVecExpr<T> & v)
     {
@@ -64,10 +79,24 @@ namespace ngla
     virtual BaseVector & Add (double scal, const BaseVector & v);
     virtual BaseVector & Add (Complex scal, const BaseVector & v);
 
+    virtual void InnerProducts (FlatArray<const BaseVector*> x, FlatArray<const BaseVector*> y,
+                                FlatVector<double> ips) const;
+    virtual void InnerProducts (FlatArray<const BaseVector*> x, FlatArray<const BaseVector*> y,
+                                FlatVector<Complex> ips) const;
+
     void PrintStatus ( ostream & ost ) const;
 
 
     virtual void Cumulate () const; 
+
+    /**
+       Starts the exchange of a distributed vector, the vector must not
+       be modified before CumulateEnd. Computations not depending on
+       the shared dofs can overlap the communication.
+     */
+    void CumulateBegin () const;
+    /// waits for the exchange and adds the received values
+    void CumulateEnd () const;
     
     virtual void Distribute() const = 0;
     // { cerr << "ERROR -- Distribute called for BaseVector, is not parallel" << endl; }
@@ -76,6 +105,9 @@ namespace ngla
     // virtual void Send ( int dest ) const;
     
     virtual void IRecvVec ( int dest, MPI_Request & request ) = 0;
+
+    /// persistent receive request into the receive buffer of dest
+    virtual void RecvInit ( int dest, MPI_Request & request ) const = 0;
     // { cerr << "ERROR -- IRecvVec called for BaseVector, is not parallel" << endl; }
 
     // virtual void RecvVec ( int dest )
@@ -175,6 +207,7 @@ namespace ngla
     virtual ostream & Print (ostream & ost) const;
 
     virtual void  IRecvVec ( int dest, MPI_Request & request );
+    virtual void RecvInit ( int dest, MPI_Request & request ) const;
     // virtual void  RecvVec ( int dest );
     virtual void AddRecvValues( int sender );
     virtual AutoVector CreateVector () const;
@@ -103,36 +103,89 @@ namespace ngla
   }
   
 
+  ParallelBaseVector :: ~ParallelBaseVector ()
+  {
+    FreeExchange();
+  }
+
+  void ParallelBaseVector :: InitExchange () const
+  {
+    FreeExchange();
+
+    MPI_Comm comm = paralleldofs->GetCommunicator();
+    for (int p : paralleldofs->GetDistantProcs())
+      if (paralleldofs->GetExchangeDofs(p).Size())
+        exprocs.Append (p);
+
+    sendrequests.SetSize (exprocs.Size());
+    recvrequests.SetSize (exprocs.Size());
+    for (int i = 0; i < exprocs.Size(); i++)
+      {
+        MPI_Send_init (const_cast<void*> (Memory()), 1, 
+                       paralleldofs->MyGetMPI_Type(exprocs[i]),
+                       exprocs[i], MPI_TAG_SOLVE, comm, &sendrequests[i]);
+        RecvInit (exprocs[i], recvrequests[i]);
+      }
+    exchangememory = Memory();
+  }
+
+  void ParallelBaseVector :: FreeExchange () const
+  {
+    int finalized;
+    MPI_Finalized (&finalized);
+    if (!finalized)
+      {
+        for (MPI_Request & r : sendrequests) MPI_Request_free (&r);
+        for (MPI_Request & r : recvrequests) MPI_Request_free (&r);
+      }
+    sendrequests.SetSize (0);
+    recvrequests.SetSize (0);
+    exprocs.SetSize (0);
+    exchangememory = nullptr;
+  }
+
   void ParallelBaseVector :: Cumulate () const
   {
-    if (status != DISTRIBUTED) return;
-    
-    int ntasks = paralleldofs->GetNTasks();
-    Array<int> exprocs;
-    for (int i = 0; i < ntasks; i++)
-      if (paralleldofs -> GetExchangeDofs (i).Size())
-	exprocs.Append(i);
-    
-    int nexprocs = exprocs.Size();
-    
-    ParallelBaseVector * constvec = const_cast<ParallelBaseVector * > (this);
-    
-    Array<MPI_Request> sendrequest(nexprocs), recvrequest(nexprocs);
+    CumulateBegin();
+    CumulateEnd();
+  }
 
-    for (int idest = 0; idest < nexprocs; idest ++ ) 
-      constvec->ISend (exprocs[idest], sendrequest[idest] );
-    for (int isender=0; isender < nexprocs; isender++)
-      constvec -> IRecvVec (exprocs[isender], recvrequest[isender] );
-    
-    MyMPI_WaitAll (sendrequest);
-    
-    // cumulate
-    for (int cntexproc=0; cntexproc < nexprocs; cntexproc++)
+  void ParallelBaseVector :: CumulateBegin () const
+  {
+    static Timer t("ParallelBaseVector::CumulateBegin");
+    RegionTimer reg(t);
+
+    if (status != DISTRIBUTED || exchanging) return;
+
+    if (exchangememory != Memory())
+      InitExchange();
+
+    if (exprocs.Size())
       {
-	int isender = MyMPI_WaitAny (recvrequest);
+        MPI_Startall (sendrequests.Size(), &sendrequests[0]);
+        MPI_Startall (recvrequests.Size(), &recvrequests[0]);
+      }
+    exchanging = true;
+  }
+
+  void ParallelBaseVector :: CumulateEnd () const
+  {
+    static Timer t("ParallelBaseVector::CumulateEnd");
+    RegionTimer reg(t);
+
+    if (!exchanging) return;
+
+    // the values are added into the sent memory, all sends have to be finished
+    MyMPI_WaitAll (sendrequests);
+
+    ParallelBaseVector * constvec = const_cast<ParallelBaseVector * > (this);
+    for (int cnt = 0; cnt < exprocs.Size(); cnt++)
+      {
+	int isender = MyMPI_WaitAny (recvrequests);
 	constvec->AddRecvValues(exprocs[isender]);
       } 
 
+    exchanging = false;
     SetStatus(CUMULATED);
   }
 
@@ -156,6 +209,78 @@ namespace ngla
 
 
 
+  /*
+    All pairs in one pass: distributed pairs are cumulated with overlapping
+    exchanges, pairs of cumulated vectors count the master dofs only, and
+    the local sums of all parallel pairs go into one MPI_Allreduce.
+  */
+  template <typename SCAL>
+  static void ParallelInnerProducts (FlatArray<const BaseVector*> x, FlatArray<const BaseVector*> y,
+                                     FlatVector<SCAL> ips)
+  {
+    static Timer t("ParallelBaseVector::InnerProducts");
+    RegionTimer reg(t);
+
+    int n = x.Size();
+    if (y.Size() != n || ips.Size() != n)
+      throw Exception ("InnerProducts: sizes do not fit");
+
+    Array<const ParallelBaseVector*> px(n), py(n);
+    Array<bool> parallel(n), cumulate(n);
+    const ParallelDofs * pardofs = NULL;
+    for (int i = 0; i < n; i++)
+      {
+        px[i] = dynamic_cast_ParallelBaseVector (x[i]);
+        py[i] = dynamic_cast_ParallelBaseVector (y[i]);
+        parallel[i] = px[i] && py[i] &&
+          px[i]->Status() != NOT_PARALLEL && py[i]->Status() != NOT_PARALLEL;
+        cumulate[i] = parallel[i] && 
+          px[i]->Status() == DISTRIBUTED && py[i]->Status() == DISTRIBUTED;
+        if (parallel[i]) pardofs = px[i]->GetParallelDofs();
+      }
+
+    // start all exchanges before waiting for any
+    for (int i = 0; i < n; i++)
+      if (cumulate[i])
+        px[i]->CumulateBegin();
+    for (int i = 0; i < n; i++)
+      if (cumulate[i])
+        px[i]->CumulateEnd();
+
+    Array<const BitArray*> masks(n);
+    for (int i = 0; i < n; i++)
+      masks[i] = (parallel[i] && px[i]->Status() == CUMULATED && py[i]->Status() == CUMULATED)
+        ? &px[i]->GetParallelDofs()->MasterDofs() : NULL;
+
+    LocalInnerProducts (x, y, masks, ips);
+
+    if (!pardofs) return;
+
+    Array<SCAL> sums;
+    for (int i = 0; i < n; i++)
+      if (parallel[i]) sums.Append (ips(i));
+
+    MPI_Allreduce (MPI_IN_PLACE, &sums[0], sums.Size(), MyGetMPIType<SCAL>(), 
+                   MPI_SUM, pardofs->GetCommunicator());
+
+    for (int i = 0, j = 0; i < n; i++)
+      if (parallel[i]) ips(i) = sums[j++];
+  }
+
+  void ParallelBaseVector :: InnerProducts (FlatArray<const BaseVector*> x, FlatArray<const BaseVector*> y,
+                                            FlatVector<double> ips) const
+  {
+    ParallelInnerProducts (x, y, ips);
+  }
+
+  void ParallelBaseVector :: InnerProducts (FlatArray<const BaseVector*> x, FlatArray<const BaseVector*> y,
+                                            FlatVector<Complex> ips) const
+  {
+    ParallelInnerProducts (x, y, ips);
+  }
+
+
+
   template <class SCAL>
   SCAL S_ParallelBaseVector<SCAL> :: InnerProduct (const BaseVector & v2) const
   {
@@ -259,6 +384,7 @@ namespace ngla
   {
     if (this->paralleldofs == aparalleldofs) return;
 
+    this -> FreeExchange();
     this -> paralleldofs = aparalleldofs;
     if ( this -> paralleldofs == 0 ) return;
     
@@ -303,6 +429,16 @@ namespace ngla
 	       MPI_TAG_SOLVE, ngs_comm, &request);
   }
 
+  template <typename SCAL>
+  void S_ParallelBaseVectorPtr<SCAL> :: RecvInit ( int dest, MPI_Request & request ) const
+  {
+    MPI_Datatype MPI_TS = MyGetMPIType<TSCAL> ();
+    MPI_Recv_init( &( (*recvvalues)[dest][0]), 
+                   (*recvvalues)[dest].Size(), 
+                   MPI_TS, dest, 
+                   MPI_TAG_SOLVE, paralleldofs->GetCommunicator(), &request);
+  }
+
   /*
   template <typename SCAL>
   void S_ParallelBaseVectorPtr<SCAL> :: RecvVec ( int dest)
@@ -11,5 +11,5 @@ from . import ngstd
 
 from ngslib.bla import *
 
-__all__ = ['Matrix', 'Vector', 'InnerProduct']
+__all__ = ['Matrix', 'Vector', 'FlatMatrix', 'FlatVector', 'InnerProduct']
 